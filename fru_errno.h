@@ -6,6 +6,8 @@
  */
 #pragma once
 
+#include <stddef.h>
+
 /**
  * @addtogroup common
  * @brief Common definitions for the library
@@ -51,6 +53,10 @@ typedef enum {
     FEAENABLED,      /**< Area is (already) enabled */
     FEADISABLED,     /**< Area is (already) disabled */
     FELIB,           /**< Internal library error (bug) */
+    FEBADARCH,       /**< Not a FRU archive, or the archive is damaged */
+    FEBADTMPL,       /**< Not a compiled template, or it is damaged or incompatible */
+    FENOSPACE,       /**< No room left in the caller-provided storage */
+    FEAREAGROW,      /**< The area has to grow to fit the data */
     FETOTALCOUNT,    /**< The total count of possible libfru error codes */
 } fru_error_code_t;
 
@@ -134,4 +140,27 @@ const char * fru_strerr(fru_errno_t);
  */
 void fru_clearerr(void);
 
+/**
+ * @brief Get the error left in a context by the last `_r` function
+ *
+ * Unlike \ref fru_errno, this follows the context to whichever
+ * thread uses it next. See fru_ctx_t in fru.h.
+ *
+ * @param[in] ctx The context, can't be NULL
+ *
+ * @returns The error, \ref FENONE if there was none
+ */
+struct fru_ctx_s;
+fru_errno_t fru_ctx_errno(const struct fru_ctx_s * ctx);
+
+/**
+ * @brief An issue found in a FRU image by fru_loadbuffer_diag()
+ */
+typedef struct fru_diag_s {
+	fru_errno_t err; /**< The error, as \ref fru_errno would be set for it */
+	int errnum; /**< The value of `errno` for \ref FEGENERIC, 0 otherwise */
+	size_t offset; /**< Offset in the image of the offending header byte,
+	                *   area, field, or MR record */
+} fru_diag_t;
+
 /* @} */
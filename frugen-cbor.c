@@ -0,0 +1,218 @@
+/** @file
+ *  @brief FRU generator utility CBOR support code
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "frugen-cbor.h"
+
+/* Tokenizer states, what is expected next */
+enum {
+	CB_VALUE, // The top-level data item
+	CB_DONE,  // Nothing but the end of input
+};
+
+static
+jstream_tok_t fail(jstream_t * js, const char * fmt, ...)
+{
+	size_t len;
+	va_list ap;
+
+	len = snprintf(js->err, sizeof(js->err), "offset %zu: ",
+	               (size_t)(js->pos - js->start));
+	va_start(ap, fmt);
+	vsnprintf(js->err + len, sizeof(js->err) - len, fmt, ap);
+	va_end(ap);
+
+	/* Any further calls fail too, see jstream_next_cbor() */
+	js->depth = 0;
+
+	return JSTREAM_ERROR;
+}
+
+/*
+ * Read a data item head, \a val gets the argument, that is the value
+ * for integers, or the length for strings and containers
+ */
+static
+bool get_head(jstream_t * js, uint8_t * major, uint8_t * info, uint64_t * val)
+{
+	size_t n;
+
+	if (js->pos >= js->end) {
+		fail(js, "unexpected end of data");
+		return false;
+	}
+
+	*major = (uint8_t)*js->pos >> 5;
+	*info = *js->pos & 0x1F;
+	if (*info < 24 || CBOR_INDEFINITE == *info) {
+		*val = *info;
+		js->pos++;
+		return true;
+	}
+	if (*info > 27) {
+		fail(js, "reserved additional information value %u", *info);
+		return false;
+	}
+
+	n = 1 << (*info - 24);
+	if ((size_t)(js->end - js->pos) <= n) {
+		fail(js, "unexpected end of data");
+		return false;
+	}
+
+	js->pos++;
+	for (*val = 0; n; n--)
+		*val = *val << 8 | (uint8_t)*js->pos++;
+
+	return true;
+}
+
+/*
+ * Check if the innermost container ends here, consume its break code
+ */
+static
+bool container_end(jstream_t * js)
+{
+	unsigned top = js->depth - 1;
+
+	if (!js->cbor_stack[top].indefinite)
+		return !js->cbor_stack[top].left;
+
+	if (js->pos < js->end && 0xFF == (uint8_t)*js->pos) {
+		js->pos++;
+		return true;
+	}
+	return false;
+}
+
+// See frugen-cbor.h
+void jstream_init_cbor(jstream_t * js, char * buf, size_t len)
+{
+	js->start = js->pos = buf;
+	js->end = buf + len;
+	js->depth = 0;
+	js->expect = CB_VALUE;
+	js->str = NULL;
+	js->len = 0;
+	js->err[0] = 0;
+	js->cbor = true;
+}
+
+// See frugen-cbor.h
+jstream_tok_t jstream_next_cbor(jstream_t * js)
+{
+	bool key = false;
+	uint8_t major, info;
+	uint64_t val;
+	char * data;
+	char * str;
+
+	if (js->err[0])
+		return JSTREAM_ERROR;
+
+	if (js->depth) {
+		unsigned top = js->depth - 1;
+		bool map = ('{' == js->stack[top]);
+
+		if (container_end(js)) {
+			if (map && js->cbor_stack[top].value)
+				return fail(js, "map key without a value");
+			js->depth--;
+			return map ? JSTREAM_OBJECT_END : JSTREAM_ARRAY_END;
+		}
+
+		if (!js->cbor_stack[top].indefinite)
+			js->cbor_stack[top].left--;
+		if (map) {
+			key = !js->cbor_stack[top].value;
+			js->cbor_stack[top].value = key;
+		}
+	}
+	else if (CB_DONE == js->expect) {
+		if (js->pos != js->end)
+			return fail(js, "extra data after the top-level item");
+		return JSTREAM_END;
+	}
+	js->expect = CB_DONE;
+
+	/* Tags carry no meaning for FRU data, take the tagged item as is */
+	do {
+		if (!get_head(js, &major, &info, &val))
+			return JSTREAM_ERROR;
+	} while (CBOR_TAG == major && CBOR_INDEFINITE != info);
+
+	if (CBOR_INDEFINITE == info && CBOR_ARRAY != major && CBOR_MAP != major)
+		return fail(js, "indefinite length is not supported for major type %u",
+		            major);
+
+	if (key && CBOR_TSTR != major)
+		return fail(js, "map keys must be text strings");
+
+	switch (major) {
+	case CBOR_UINT:
+		if (val > INT64_MAX)
+			return fail(js, "integer %" PRIu64 " is too big", val);
+		js->len = snprintf(js->num, sizeof(js->num), "%" PRIu64, val);
+		js->str = js->num;
+		return JSTREAM_NUMBER;
+	case CBOR_NEGINT:
+		if (val > INT64_MAX)
+			return fail(js, "integer -1-%" PRIu64 " is too small", val);
+		js->len = snprintf(js->num, sizeof(js->num), "-%" PRIu64, val + 1);
+		js->str = js->num;
+		return JSTREAM_NUMBER;
+	case CBOR_BSTR:
+	case CBOR_TSTR:
+		if ((uint64_t)(js->end - js->pos) < val)
+			return fail(js, "unexpected end of data");
+		data = js->pos;
+		js->pos += val;
+		js->len = val;
+		if (CBOR_BSTR == major) {
+			js->str = data;
+			return JSTREAM_BYTES;
+		}
+		/* The head takes a byte at least, move the text over it to terminate */
+		str = data - 1;
+		memmove(str, data, val);
+		str[val] = 0;
+		js->str = str;
+		return key ? JSTREAM_KEY : JSTREAM_STRING;
+	case CBOR_ARRAY:
+	case CBOR_MAP:
+		if (js->depth >= JSTREAM_MAXDEPTH)
+			return fail(js, "nesting is too deep");
+		/* Each item takes a byte at least, so the length can't be bogus */
+		if (CBOR_INDEFINITE != info && (uint64_t)(js->end - js->pos) < val)
+			return fail(js, "unexpected end of data");
+		js->cbor_stack[js->depth].indefinite = (CBOR_INDEFINITE == info);
+		js->cbor_stack[js->depth].left = (CBOR_MAP == major) ? 2 * val : val;
+		js->cbor_stack[js->depth].value = false;
+		js->stack[js->depth++] = (CBOR_MAP == major) ? '{' : '[';
+		return (CBOR_MAP == major) ? JSTREAM_OBJECT : JSTREAM_ARRAY;
+	default: // CBOR_SIMPLE, the tags are skipped above
+		switch (info) {
+		case 20: return JSTREAM_FALSE;
+		case 21: return JSTREAM_TRUE;
+		case 22: // null
+		case 23: // undefined
+			return JSTREAM_NULL;
+		case 25:
+		case 26:
+		case 27:
+			return fail(js, "floating point numbers are not supported");
+		default:
+			return fail(js, "unexpected simple value %" PRIu64, val);
+		}
+	}
+}
@@ -0,0 +1,50 @@
+/** @file
+ *  @brief FRU generator utility CBOR support header file
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frugen-json-stream.h"
+
+/*
+ * CBOR (RFC 8949) is the binary counterpart of the JSON format.
+ * It uses the same schema, only binary data are byte strings instead
+ * of hex strings, so it's written by the same jsout_t writer, and read
+ * by the same loader through the jstream_t tokenizer interface.
+ */
+
+/* Major types, shifted right by 5 bits */
+#define CBOR_UINT   0
+#define CBOR_NEGINT 1
+#define CBOR_BSTR   2
+#define CBOR_TSTR   3
+#define CBOR_ARRAY  4
+#define CBOR_MAP    5
+#define CBOR_TAG    6
+#define CBOR_SIMPLE 7
+
+/// Additional information value for indefinite-length items
+#define CBOR_INDEFINITE 31
+
+/**
+ * Start tokenizing a CBOR buffer of \a len bytes with jstream_next().
+ * Text strings are moved in place to get NUL-terminated, so the buffer
+ * is modified. Byte strings are JSTREAM_BYTES tokens, integers are
+ * JSTREAM_NUMBER ones with the decimal text, tags are ignored, and
+ * `undefined` is JSTREAM_NULL. Floating point numbers,
+ * indefinite-length strings, and non-string map keys aren't supported.
+ */
+void jstream_init_cbor(jstream_t * js, char * buf, size_t len);
+
+/**
+ * Get the next token from CBOR input, called by jstream_next()
+ */
+jstream_tok_t jstream_next_cbor(jstream_t * js);
@@ -0,0 +1,434 @@
+/** @file
+ *  @brief FRU generator utility daemon mode
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "fru_errno.h"
+#include "frugen-daemon.h"
+
+/// Maximum length of a request frame, that is the length and the payload
+#define MAX_FRAME (sizeof(uint32_t) + FRUGEN_DAEMON_MAX_REQ)
+
+/*
+ * Maximum output queued for a client. Past that, no more requests are
+ * read from it until the client reads the responses, so a client that
+ * only ever writes can't make the daemon grow without limit.
+ */
+#define MAX_QUEUED (256 * 1024)
+
+typedef struct {
+	int fd;
+	uint8_t * in;
+	size_t inlen; ///< Never more than MAX_FRAME
+	uint8_t * out;
+	size_t outlen;
+	size_t outpos;
+	bool closing; ///< Close as soon as the output is flushed
+} client_t;
+
+static volatile sig_atomic_t stop;
+
+static
+void on_signal(int sig __attribute__((unused)))
+{
+	stop = 1;
+}
+
+static
+bool set_nonblock(int fd)
+{
+	int flags = fcntl(fd, F_GETFL);
+
+	return flags >= 0 && !fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+static inline
+bool client_throttled(const client_t * c)
+{
+	return c->outlen - c->outpos >= MAX_QUEUED;
+}
+
+/*
+ * Append a response to the client output buffer
+ */
+static
+bool respond(client_t * c, frugen_daemon_status_t status,
+             const void * data, size_t len)
+{
+	frugen_daemon_resp_t resp = {
+		.len = htonl(len),
+		.status = status,
+	};
+	uint8_t * out;
+
+	if (FRUGEN_DAEMON_EFRU == status) {
+		resp.code = fru_errno.code;
+		resp.src = fru_errno.src;
+		resp.index = htonl(fru_errno.index);
+	}
+
+	/* Drop what has been sent already, only the queue is kept */
+	if (c->outpos) {
+		memmove(c->out, c->out + c->outpos, c->outlen - c->outpos);
+		c->outlen -= c->outpos;
+		c->outpos = 0;
+	}
+
+	out = realloc(c->out, c->outlen + sizeof(resp) + len);
+	if (!out) {
+		warn("Out of memory, dropping client");
+		c->closing = true;
+		return false;
+	}
+	c->out = out;
+	memcpy(c->out + c->outlen, &resp, sizeof(resp));
+	memcpy(c->out + c->outlen + sizeof(resp), data, len);
+	c->outlen += sizeof(resp) + len;
+
+	return true;
+}
+
+static
+bool respond_str(client_t * c, frugen_daemon_status_t status, const char * msg)
+{
+	debug(1, "Client %d: %s", c->fd, msg);
+	return respond(c, status, msg, strlen(msg));
+}
+
+static
+const frugen_template_t * find_template(const frugen_template_t * templates,
+                                        size_t count, const char * name)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (!strcmp(templates[i].name, name))
+			return &templates[i];
+	}
+	return NULL;
+}
+
+/*
+ * Apply a single override from a request to \a fru
+ */
+static
+bool apply_override(client_t * c, fru_t * fru, const char * s)
+{
+	char err[256];
+	fieldopt_t fieldopt;
+	const char * failure;
+	char * arg;
+	bool rc = false;
+
+	if (!strncmp(s, "uuid=", 5)) {
+		if (frugen_set_uuid(fru, s + 5))
+			return true;
+		respond_str(c, FRUGEN_DAEMON_EFRU, "Couldn't set UUID");
+		return false;
+	}
+
+	if (!strncmp(s, "date=", 5)) {
+		if (!datestr_to_tv(&fru->board.tv, s + 5)) {
+			respond_str(c, FRUGEN_DAEMON_EOVERRIDE,
+			            "Invalid date/time format, use \"DD/MM/YYYY HH:MM\"");
+			return false;
+		}
+		fru->board.tv_auto = false;
+		fru_enable_area(fru, FRU_BOARD_INFO, FRU_APOS_AUTO);
+		return true;
+	}
+
+	/* frugen_parse_fieldopt() modifies its argument */
+	arg = strdup(s);
+	if (!arg) {
+		respond_str(c, FRUGEN_DAEMON_EOVERRIDE, "Out of memory");
+		return false;
+	}
+	if (!frugen_parse_fieldopt(&fieldopt, arg, err, sizeof(err))) {
+		respond_str(c, FRUGEN_DAEMON_EOVERRIDE, err);
+		goto out;
+	}
+	if (!frugen_apply_fieldopt(fru, &fieldopt, &failure)) {
+		respond_str(c, FRUGEN_DAEMON_EFRU, failure);
+		goto out;
+	}
+	rc = true;
+out:
+	free(arg);
+	return rc;
+}
+
+/*
+ * Process a complete request payload and queue the response
+ */
+static
+void handle_request(client_t * c, const char * payload, size_t len,
+                    const frugen_template_t * templates, size_t count)
+{
+	const frugen_template_t * t;
+	const char * s = payload;
+	uint8_t * image = NULL;
+	size_t size = 0;
+	fru_t * fru;
+
+	if (!len || payload[len - 1]) {
+		respond_str(c, FRUGEN_DAEMON_EPROTO, "Request is not NUL-terminated");
+		return;
+	}
+
+	t = find_template(templates, count, s);
+	if (!t) {
+		respond_str(c, FRUGEN_DAEMON_ENOTEMPLATE, "No such template");
+		return;
+	}
+
+	fru = fru_derive(t->fru);
+	if (!fru) {
+		respond_str(c, FRUGEN_DAEMON_EFRU, "Failed to derive from the template");
+		return;
+	}
+
+	for (s += strlen(s) + 1; s < payload + len; s += strlen(s) + 1) {
+		if (!apply_override(c, fru, s))
+			goto out;
+	}
+
+	if (!fru_savebuffer((void **)&image, &size, fru)) {
+		respond_str(c, FRUGEN_DAEMON_EFRU, "Failed to encode the FRU data");
+		goto out;
+	}
+
+	respond(c, FRUGEN_DAEMON_OK, image, size);
+	fru_mem_free(image);
+out:
+	fru_free(fru);
+}
+
+/*
+ * Process the complete requests received from the client,
+ * until the output queue is full
+ */
+static
+void client_process(client_t * c, const frugen_template_t * templates,
+                    size_t count)
+{
+	size_t pos = 0;
+
+	while (c->inlen - pos >= sizeof(uint32_t) && !client_throttled(c)) {
+		uint32_t len;
+
+		memcpy(&len, c->in + pos, sizeof(len));
+		len = ntohl(len);
+		if (len > FRUGEN_DAEMON_MAX_REQ) {
+			respond_str(c, FRUGEN_DAEMON_EPROTO, "Request is too big");
+			c->closing = true;
+			/* Nothing that follows can be trusted */
+			c->inlen = pos;
+			break;
+		}
+		if (c->inlen - pos - sizeof(len) < len)
+			break;
+
+		handle_request(c, (const char *)c->in + pos + sizeof(len), len,
+		               templates, count);
+		pos += sizeof(len) + len;
+	}
+
+	memmove(c->in, c->in + pos, c->inlen - pos);
+	c->inlen -= pos;
+}
+
+/*
+ * Read whatever is available from the client and process
+ * all complete requests. No more than a frame is buffered,
+ * and nothing is read while the output queue is full.
+ */
+static
+void client_read(client_t * c, const frugen_template_t * templates, size_t count)
+{
+	uint8_t buf[4096];
+	ssize_t rc;
+
+	while (!c->closing && !client_throttled(c) && c->inlen < MAX_FRAME) {
+		uint8_t * in;
+
+		rc = read(c->fd, buf, FRU_MIN(sizeof(buf), MAX_FRAME - c->inlen));
+		if (rc <= 0) {
+			if (!rc || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+				debug(1, "Client %d disconnected", c->fd);
+				c->closing = true;
+			}
+			break;
+		}
+
+		in = realloc(c->in, c->inlen + rc);
+		if (!in) {
+			warn("Out of memory, dropping client");
+			c->closing = true;
+			return;
+		}
+		c->in = in;
+		memcpy(c->in + c->inlen, buf, rc);
+		c->inlen += rc;
+
+		client_process(c, templates, count);
+	}
+}
+
+static
+void client_write(client_t * c)
+{
+	while (c->outpos < c->outlen) {
+		ssize_t rc = send(c->fd, c->out + c->outpos, c->outlen - c->outpos,
+		                  MSG_NOSIGNAL);
+		if (rc < 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				c->closing = true;
+				c->outlen = c->outpos = 0;
+			}
+			return;
+		}
+		c->outpos += rc;
+	}
+	c->outlen = c->outpos = 0;
+}
+
+static
+void client_free(client_t * c)
+{
+	close(c->fd);
+	free(c->in);
+	free(c->out);
+}
+
+static
+int listen_on(const char * path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	struct stat st;
+	int fd;
+
+	if (strlen(path) >= sizeof(addr.sun_path))
+		fatal("Socket path '%s' is too long", path);
+	strcpy(addr.sun_path, path);
+
+	/* Remove a stale socket, but nothing else */
+	if (!lstat(path, &st) && S_ISSOCK(st.st_mode))
+		unlink(path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		fatal("Failed to create a socket: %m");
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)))
+		fatal("Failed to bind to '%s': %m", path);
+	if (listen(fd, SOMAXCONN))
+		fatal("Failed to listen on '%s': %m", path);
+	if (!set_nonblock(fd))
+		fatal("Failed to make the socket non-blocking: %m");
+
+	return fd;
+}
+
+// See frugen-daemon.h
+int frugen_daemon(const char * path, const frugen_template_t * templates,
+                  size_t count)
+{
+	struct sigaction sa = { .sa_handler = on_signal };
+	client_t * clients = NULL;
+	struct pollfd * pfds = NULL;
+	size_t nclients = 0;
+	int lfd;
+
+	/* No SA_RESTART, let poll() return on signals */
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	lfd = listen_on(path);
+	debug(1, "Serving %zu templates on %s", count, path);
+
+	while (!stop) {
+		struct pollfd * p = realloc(pfds, (nclients + 1) * sizeof(*pfds));
+		if (!p)
+			fatal("Out of memory");
+		pfds = p;
+
+		pfds[0] = (struct pollfd){ .fd = lfd, .events = POLLIN };
+		for (size_t i = 0; i < nclients; i++) {
+			pfds[i + 1] = (struct pollfd){
+				.fd = clients[i].fd,
+				.events = (clients[i].closing || client_throttled(&clients[i])
+				           ? 0 : POLLIN)
+				          | (clients[i].outlen ? POLLOUT : 0),
+			};
+		}
+
+		if (poll(pfds, nclients + 1, -1) < 0) {
+			if (EINTR == errno)
+				continue;
+			fatal("poll() failed: %m");
+		}
+
+		for (size_t i = 0; i < nclients; i++) {
+			client_t * c = &clients[i];
+
+			if (pfds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))
+				client_read(c, templates, count);
+			if (c->outlen)
+				client_write(c);
+			/* The requests held back while the output queue was full */
+			if (c->inlen)
+				client_process(c, templates, count);
+		}
+
+		/* Drop the closed clients, compact the array */
+		size_t n = 0;
+		for (size_t i = 0; i < nclients; i++) {
+			if (clients[i].closing && !clients[i].outlen) {
+				client_free(&clients[i]);
+				continue;
+			}
+			clients[n++] = clients[i];
+		}
+		nclients = n;
+
+		if (pfds[0].revents & POLLIN) {
+			int fd;
+
+			while ((fd = accept(lfd, NULL, NULL)) >= 0) {
+				client_t * c = realloc(clients, (nclients + 1) * sizeof(*clients));
+				if (!c || !set_nonblock(fd)) {
+					warn("Failed to accept a client");
+					close(fd);
+					if (c)
+						clients = c;
+					continue;
+				}
+				clients = c;
+				clients[nclients++] = (client_t){ .fd = fd };
+				debug(1, "Client %d connected", fd);
+			}
+		}
+	}
+
+	debug(1, "Shutting down");
+	for (size_t i = 0; i < nclients; i++)
+		client_free(&clients[i]);
+	free(clients);
+	free(pfds);
+	close(lfd);
+	unlink(path);
+
+	return 0;
+}
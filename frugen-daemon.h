@@ -0,0 +1,66 @@
+/** @file
+ *  @brief FRU generator utility daemon mode header file
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "frugen.h"
+
+/*
+ * The daemon protocol is a simple binary framing over a UNIX stream socket.
+ * Any number of requests may be sent over a single connection, responses
+ * come in the same order.
+ *
+ * Request:
+ *   uint32_t length of the payload, network byte order
+ *   payload: a sequence of NUL-terminated strings:
+ *     - the template name, as given to `--preload`
+ *     - zero or more overrides, each one of:
+ *       - `[<encoding>:]<area>.<field>=<value>`, same as for `--set`
+ *       - `uuid=<uuid>`, same as `--mr-uuid`
+ *       - `date=<date>`, same as `--board-date`
+ *
+ * Response: frugen_daemon_resp_t followed by `len` bytes of data,
+ * which is the encoded FRU image on success, or a human-readable
+ * error message (not NUL-terminated) on failure.
+ */
+
+/// Maximum request payload length
+#define FRUGEN_DAEMON_MAX_REQ (64 * 1024)
+
+typedef enum {
+	FRUGEN_DAEMON_OK,          ///< Success, the data is the FRU image
+	FRUGEN_DAEMON_EPROTO,      ///< Malformed request
+	FRUGEN_DAEMON_ENOTEMPLATE, ///< No such template
+	FRUGEN_DAEMON_EOVERRIDE,   ///< Malformed override
+	FRUGEN_DAEMON_EFRU,        ///< libfru failure, see `code`, `src` and `index`
+} frugen_daemon_status_t;
+
+typedef struct {
+	uint32_t len; ///< Length of the data following the header, network byte order
+	uint8_t status; ///< One of frugen_daemon_status_t
+	uint8_t code; ///< fru_errno.code for FRUGEN_DAEMON_EFRU
+	uint8_t src; ///< fru_errno.src for FRUGEN_DAEMON_EFRU
+	uint8_t rsvd;
+	int32_t index; ///< fru_errno.index for FRUGEN_DAEMON_EFRU, network byte order
+} __attribute__((packed)) frugen_daemon_resp_t;
+
+/// A preloaded template, the responses are derived from it with fru_derive()
+typedef struct {
+	char * name;
+	fru_t * fru; ///< Decoded back from the encoded form, never modified
+} frugen_template_t;
+
+/**
+ * Serve requests on a UNIX socket at \a path until SIGINT or SIGTERM
+ *
+ * @returns The program exit code
+ */
+int frugen_daemon(const char * path, const frugen_template_t * templates,
+                  size_t count);
@@ -0,0 +1,341 @@
+/** @file
+ *  @brief FRU generator utility columnar export
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "frugen-export.h"
+
+/* A growing byte buffer */
+typedef struct {
+	uint8_t * data;
+	size_t len;
+	size_t size;
+} buf_t;
+
+/*
+ * A column being written. STRINGS keep the offsets in `data` and the
+ * bytes in `blob`, the rest keep the values in `data`.
+ */
+typedef struct {
+	char name[FRUGEN_EXPORT_NAMELEN];
+	frugen_export_kind_t kind;
+	size_t rows;
+	buf_t data;
+	buf_t blob;
+} column_t;
+
+enum {
+	COL_FILE,
+	COL_AREAS,
+	COL_CHASSIS_TYPE,
+	COL_BOARD_LANG,
+	COL_BOARD_DATE,
+	COL_PRODUCT_LANG,
+	COL_CUSTOM_UNIT,
+	COL_CUSTOM_AREA,
+	COL_CUSTOM_VALUE,
+	COL_MR_UNIT,
+	COL_MR_TYPE,
+	COL_MR_DATA,
+	COL_DICT,
+	COL_FIXED_COUNT, // The standard field columns follow
+};
+
+/*
+ * The decoded units are kept in an inventory table that interns
+ * the field values, the columns are filled from it on saving.
+ * Only the file names and the languages that the table doesn't
+ * keep are collected as the units are added.
+ */
+struct frugen_export_s {
+	fru_table_t * table;
+	size_t ncols;
+	column_t cols[COL_FIXED_COUNT + FRU_CHASSIS_FIELD_COUNT
+	              + FRU_BOARD_FIELD_COUNT + FRU_PROD_FIELD_COUNT];
+};
+
+static
+void put(buf_t * b, const void * data, size_t len)
+{
+	if (b->len + len > b->size) {
+		size_t size = b->size ? b->size : 1024;
+		uint8_t * p;
+
+		while (size < b->len + len)
+			size *= 2;
+		p = realloc(b->data, size);
+		if (!p)
+			fatal("Out of memory");
+		b->data = p;
+		b->size = size;
+	}
+	memcpy(b->data + b->len, data, len);
+	b->len += len;
+}
+
+static
+void put_le(buf_t * b, uint64_t val, size_t width)
+{
+	uint8_t le[8];
+
+	for (size_t i = 0; i < width; i++)
+		le[i] = val >> (8 * i);
+	put(b, le, width);
+}
+
+static
+column_t * add_column(frugen_export_t * ex, const char * name,
+                      frugen_export_kind_t kind)
+{
+	column_t * col = &ex->cols[ex->ncols++];
+
+	snprintf(col->name, sizeof(col->name), "%s", name);
+	col->kind = kind;
+	if (FRUGEN_COL_STRINGS == kind)
+		put_le(&col->data, 0, 4);
+
+	return col;
+}
+
+static
+void add_string(column_t * col, const void * str, size_t len)
+{
+	if (col->blob.len + len > UINT32_MAX)
+		fatal("Column '%s' is too big", col->name);
+	put(&col->blob, str, len);
+	put_le(&col->data, col->blob.len, 4);
+	col->rows++;
+}
+
+static
+void add_num(column_t * col, uint64_t val)
+{
+	static const size_t width[] = {
+		[FRUGEN_COL_U8] = 1,
+		[FRUGEN_COL_U32] = 4,
+		[FRUGEN_COL_I64] = 8,
+		[FRUGEN_COL_DICT] = 4,
+	};
+
+	put_le(&col->data, val, width[col->kind]);
+	col->rows++;
+}
+
+// See frugen-export.h
+frugen_export_t * frugen_export_new(void)
+{
+	frugen_export_t * ex = calloc(1, sizeof(*ex));
+	fru_area_type_t atype;
+
+	if (!ex)
+		fatal("Out of memory");
+
+	ex->table = fru_table_new();
+	if (!ex->table)
+		fru_fatal("Failed to create the inventory table");
+
+	add_column(ex, "file", FRUGEN_COL_STRINGS);
+	add_column(ex, "areas", FRUGEN_COL_U8);
+	add_column(ex, "chassis.type", FRUGEN_COL_U8);
+	add_column(ex, "board.lang", FRUGEN_COL_U8);
+	add_column(ex, "board.date", FRUGEN_COL_I64);
+	add_column(ex, "product.lang", FRUGEN_COL_U8);
+	add_column(ex, "custom.unit", FRUGEN_COL_U32);
+	add_column(ex, "custom.area", FRUGEN_COL_U8);
+	add_column(ex, "custom.value", FRUGEN_COL_DICT);
+	add_column(ex, "mr.unit", FRUGEN_COL_U32);
+	add_column(ex, "mr.type", FRUGEN_COL_U8);
+	add_column(ex, "mr.data", FRUGEN_COL_STRINGS);
+	add_column(ex, "dict", FRUGEN_COL_STRINGS);
+
+	FRU_FOREACH_AREA(atype) {
+		if (!FRU_IS_INFO_AREA(atype))
+			continue;
+		for (size_t i = 0; i < field_max[atype]; i++) {
+			char name[FRUGEN_EXPORT_NAMELEN];
+
+			snprintf(name, sizeof(name), "%s.%s",
+			         area_names[atype].json, field_name[atype][i].json);
+			add_column(ex, name, FRUGEN_COL_DICT);
+		}
+	}
+
+	return ex;
+}
+
+// See frugen-export.h
+bool frugen_export_add(frugen_export_t * ex, const char * name,
+                       const void * image, size_t len, fru_flags_t flags)
+{
+	fru_t * fru;
+
+	if (fru_table_rows(ex->table) >= UINT32_MAX)
+		fatal("Too many units to export");
+
+	fru = fru_loadbuffer(NULL, image, len, flags);
+	if (!fru)
+		return false;
+
+	if (!fru_table_add_fru(ex->table, fru))
+		fru_fatal("Failed to add '%s' to the export", name);
+
+	add_string(&ex->cols[COL_FILE], name, strlen(name));
+	add_num(&ex->cols[COL_BOARD_LANG], fru->board.lang);
+	add_num(&ex->cols[COL_PRODUCT_LANG], fru->product.lang);
+
+	fru_free(fru);
+
+	return true;
+}
+
+/*
+ * Fill the columns that come from the inventory table
+ */
+static
+void fill_columns(frugen_export_t * ex)
+{
+	const fru_table_t * t = ex->table;
+	size_t rows = fru_table_rows(t);
+	const uint8_t * areas = fru_table_areas(t);
+	const uint8_t * chassis_types = fru_table_chassis_types(t);
+	const time_t * dates = fru_table_dates(t);
+	const uint32_t * units;
+	const uint8_t * types;
+	const fru_strid_t * values;
+	const fru_mr_rec_t * recs;
+	column_t * col = &ex->cols[COL_FIXED_COUNT];
+	fru_area_type_t atype;
+	size_t count;
+
+	for (size_t row = 0; row < rows; row++) {
+		add_num(&ex->cols[COL_AREAS], areas[row]);
+		add_num(&ex->cols[COL_CHASSIS_TYPE], chassis_types[row]);
+		add_num(&ex->cols[COL_BOARD_DATE], dates[row]);
+	}
+
+	FRU_FOREACH_AREA(atype) {
+		if (!FRU_IS_INFO_AREA(atype))
+			continue;
+		for (size_t i = 0; i < field_max[atype]; i++, col++) {
+			const fru_strid_t * ids = fru_table_column(t, atype, i);
+
+			for (size_t row = 0; row < rows; row++)
+				add_num(col, ids[row]);
+		}
+	}
+
+	count = fru_table_custom(t, &units, &types, &values);
+	for (size_t i = 0; i < count; i++) {
+		add_num(&ex->cols[COL_CUSTOM_UNIT], units[i]);
+		add_num(&ex->cols[COL_CUSTOM_AREA], types[i]);
+		add_num(&ex->cols[COL_CUSTOM_VALUE], values[i]);
+	}
+
+	count = fru_table_mr(t, &units, &types, &recs);
+	for (size_t i = 0; i < count; i++) {
+		uint8_t data[FRU__FILE_MRR_MAXDATA];
+		size_t size;
+
+		if (!fru_mr_encode(&recs[i], data, &size))
+			fru_fatal("Failed to encode MR record %zu of unit %u",
+			          i, units[i]);
+		add_num(&ex->cols[COL_MR_UNIT], units[i]);
+		add_num(&ex->cols[COL_MR_TYPE], types[i]);
+		add_string(&ex->cols[COL_MR_DATA], data, size);
+	}
+
+	/* The string IDs are the rows of the shared dictionary */
+	count = fru_table_strcount(t);
+	for (fru_strid_t id = 0; id < count; id++) {
+		const char * str = fru_table_str(t, id);
+
+		add_string(&ex->cols[COL_DICT], str, strlen(str));
+	}
+}
+
+static
+void write_col(FILE * fp, const column_t * col, uint32_t dict, uint64_t * offset)
+{
+	uint8_t entry[sizeof(frugen_export_col_t)] = {};
+	uint64_t size = col->data.len + col->blob.len;
+	buf_t b = { entry, 0, sizeof(entry) };
+
+	put(&b, col->name, sizeof(col->name));
+	put_le(&b, col->kind, 4);
+	put_le(&b, dict, 4);
+	put_le(&b, col->rows, 8);
+	put_le(&b, *offset, 8);
+	put_le(&b, size, 8);
+	if (fwrite(entry, sizeof(entry), 1, fp) != 1)
+		fatal("Failed to write the export: %m");
+
+	*offset += (size + 7) & ~7ULL;
+}
+
+static
+void write_data(FILE * fp, const column_t * col)
+{
+	static const uint8_t pad[8];
+	size_t size = col->data.len + col->blob.len;
+
+	if (fwrite(col->data.data, 1, col->data.len, fp) != col->data.len
+	    || fwrite(col->blob.data, 1, col->blob.len, fp) != col->blob.len
+	    || fwrite(pad, 1, -size & 7, fp) != (-size & 7))
+	{
+		fatal("Failed to write the export: %m");
+	}
+}
+
+// See frugen-export.h
+void frugen_export_save(frugen_export_t * ex, const char * fname)
+{
+	FILE * fp = fopen(fname, "w");
+	uint8_t hdr[sizeof(frugen_export_hdr_t)];
+	buf_t b = { hdr, 0, sizeof(hdr) };
+	uint64_t offset;
+
+	if (!fp)
+		fatal("Failed to open file '%s' for writing: %m", fname);
+
+	fill_columns(ex);
+
+	put(&b, FRUGEN_EXPORT_MAGIC, 8);
+	put_le(&b, FRUGEN_EXPORT_VERSION, 4);
+	put_le(&b, ex->ncols, 4);
+	if (fwrite(hdr, sizeof(hdr), 1, fp) != 1)
+		fatal("Failed to write the export to '%s': %m", fname);
+
+	offset = sizeof(frugen_export_hdr_t) + ex->ncols * sizeof(frugen_export_col_t);
+	for (size_t i = 0; i < ex->ncols; i++) {
+		const column_t * col = &ex->cols[i];
+
+		write_col(fp, col, FRUGEN_COL_DICT == col->kind ? COL_DICT : 0, &offset);
+	}
+
+	for (size_t i = 0; i < ex->ncols; i++)
+		write_data(fp, &ex->cols[i]);
+
+	if (fclose(fp))
+		fatal("Failed to write the export to '%s': %m", fname);
+
+	debug(1, "Exported %zu units into %zu columns of %s",
+	      fru_table_rows(ex->table), ex->ncols, fname);
+}
+
+// See frugen-export.h
+void frugen_export_free(frugen_export_t * ex)
+{
+	for (size_t i = 0; i < ex->ncols; i++) {
+		free(ex->cols[i].data.data);
+		free(ex->cols[i].blob.data);
+	}
+	fru_table_free(ex->table);
+	free(ex);
+}
@@ -0,0 +1,109 @@
+/** @file
+ *  @brief FRU generator utility columnar export header file
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frugen.h"
+
+/*
+ * The columnar export file is meant to be mapped into memory and read
+ * in place by analysis tools, so that only the columns of interest are
+ * ever touched. All the numbers are little-endian, all the offsets are
+ * from the start of the file, and every column starts at an 8-byte
+ * boundary.
+ *
+ * The file starts with frugen_export_hdr_t followed by `ncols` entries
+ * of frugen_export_col_t (the directory). The column data follow the
+ * directory. The columns form three tables, all the columns of a table
+ * have the same number of rows, and a dictionary:
+ *
+ * Units, one row per decoded FRU image:
+ *   file          - STRINGS, the file name, or <archive>:<key>
+ *   areas         - U8, bit mask of the present areas, (1 << fru_area_type_t)
+ *   chassis.type  - U8
+ *   board.lang    - U8
+ *   board.date    - I64, seconds since the UNIX epoch (UTC), 0 if unspecified
+ *   product.lang  - U8
+ *   <area>.<field> - DICT, one column per standard field of the chassis,
+ *                   board and product areas, named as in JSON
+ *                   (e.g. `board.pname`), empty strings for missing areas
+ *
+ * Custom fields, one row per field:
+ *   custom.unit   - U32, the row in the units table
+ *   custom.area   - U8, fru_area_type_t
+ *   custom.value  - DICT
+ *
+ * Multirecord area records, one row per record:
+ *   mr.unit       - U32, the row in the units table
+ *   mr.type       - U8, the record type ID as per IPMI FRU spec
+ *   mr.data       - STRINGS, the binary record data as encoded by libfru,
+ *                   the same as in the image saved by frugen
+ *
+ * Dictionary, shared by all the DICT columns:
+ *   dict          - STRINGS, the distinct field values, row 0 is always
+ *                   the empty string
+ *
+ * The field values are the decoded text, binary fields are hex strings.
+ */
+
+#define FRUGEN_EXPORT_MAGIC "FRUCOLS1"
+#define FRUGEN_EXPORT_VERSION 1
+#define FRUGEN_EXPORT_NAMELEN 32
+
+typedef enum {
+	FRUGEN_COL_U8 = 1,   ///< `rows` bytes
+	FRUGEN_COL_U32,      ///< `rows` uint32_t
+	FRUGEN_COL_I64,      ///< `rows` int64_t
+	FRUGEN_COL_STRINGS,  /**< `rows + 1` uint32_t offsets followed by the
+	                      *   string bytes, row N spans from offsets[N] to
+	                      *   offsets[N + 1] relative to the end of the
+	                      *   offsets. Strings are not NUL-terminated. */
+	FRUGEN_COL_DICT,     /**< `rows` uint32_t codes, which are rows of
+	                      *   the STRINGS column with index `dict` */
+} frugen_export_kind_t;
+
+typedef struct {
+	char magic[8]; ///< FRUGEN_EXPORT_MAGIC, not NUL-terminated
+	uint32_t version; ///< FRUGEN_EXPORT_VERSION
+	uint32_t ncols; ///< Number of entries in the directory
+} frugen_export_hdr_t;
+
+typedef struct {
+	char name[FRUGEN_EXPORT_NAMELEN]; ///< NUL-padded
+	uint32_t kind; ///< One of frugen_export_kind_t
+	uint32_t dict; ///< Directory index of the dictionary for FRUGEN_COL_DICT
+	uint64_t rows;
+	uint64_t offset; ///< Offset of the column data
+	uint64_t size; ///< Size of the column data in bytes
+} frugen_export_col_t;
+
+typedef struct frugen_export_s frugen_export_t;
+
+/**
+ * Create an empty export, exits on failures
+ */
+frugen_export_t * frugen_export_new(void);
+
+/**
+ * Decode a binary FRU image and add it as a unit named \a name
+ *
+ * @returns false if the image fails to decode, \ref fru_errno is set
+ */
+bool frugen_export_add(frugen_export_t * ex, const char * name,
+                       const void * image, size_t len, fru_flags_t flags);
+
+/**
+ * Write the export to \a fname, exits on failures
+ */
+void frugen_export_save(frugen_export_t * ex, const char * fname);
+
+void frugen_export_free(frugen_export_t * ex);
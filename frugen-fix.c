@@ -0,0 +1,255 @@
+/** @file
+ *  @brief FRU generator utility checksum repair
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+
+#define _GNU_SOURCE // For struct FTW
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fru_errno.h"
+#include "frugen-fix.h"
+
+/* Same as the FRU file size limit of libfru */
+#define MAX_IMAGE_SIZE (64 * 1024)
+/* Checksums to report individually per file, the rest are only counted */
+#define MAX_FIXES 64
+/* Open file descriptors for nftw() */
+#define WALK_FDS 16
+
+/* A file to process */
+typedef struct {
+	char * name;
+	bool walked; ///< Found in a directory, may be not a FRU image
+} file_t;
+
+/* The files to process, collected before starting the threads */
+static file_t * files;
+static size_t file_count;
+static size_t file_size;
+
+/* The next file for a thread to take */
+static size_t next_file;
+static size_t failed;
+
+static
+void add_file(const char * name, bool walked)
+{
+	if (file_count == file_size) {
+		file_size = file_size ? file_size * 2 : 64;
+		files = realloc(files, file_size * sizeof(*files));
+		if (!files)
+			fatal("Failed to allocate the file list: %m");
+	}
+
+	files[file_count].name = strdup(name);
+	if (!files[file_count].name)
+		fatal("Failed to allocate the file list: %m");
+	files[file_count].walked = walked;
+	file_count++;
+}
+
+static
+int walk_entry(const char * name, const struct stat * st __attribute__((unused)),
+               int type, struct FTW * ftw __attribute__((unused)))
+{
+	if (FTW_F == type)
+		add_file(name, true);
+	else if (FTW_DNR == type || FTW_NS == type)
+		warn("Failed to read %s", name);
+
+	return 0;
+}
+
+static
+void print_fix(const char * name, const fru_checksum_fix_t * fix)
+{
+	printf("%s: ", name);
+	switch (fix->kind) {
+	case FRU_CHECKSUM_HEADER:
+		printf("FRU header");
+		break;
+	case FRU_CHECKSUM_AREA:
+		printf("%s Area", area_names[fix->atype].human);
+		break;
+	case FRU_CHECKSUM_MR_HEADER:
+		printf("%s Area (record %zu) header",
+		       area_names[FRU_MR].human, LIST_INDEX_FRUGEN(fix->index));
+		break;
+	case FRU_CHECKSUM_MR_DATA:
+		printf("%s Area (record %zu) data",
+		       area_names[FRU_MR].human, LIST_INDEX_FRUGEN(fix->index));
+		break;
+	}
+	printf(" checksum at 0x%zX: 0x%02X -> 0x%02X\n",
+	       fix->offset, fix->was, fix->now);
+}
+
+/*
+ * Read an image, fix it and write the fixed checksums back
+ *
+ * @returns false if the file failed to be processed,
+ *          the files found in directories that aren't
+ *          FRU images are only reported as skipped
+ */
+static
+bool fix_file(const file_t * file)
+{
+	const char * name = file->name;
+	fru_checksum_fix_t fixes[MAX_FIXES];
+	size_t count = MAX_FIXES;
+	uint8_t * buf;
+	size_t len = 0;
+	bool rc = false;
+	ssize_t n;
+	int fd;
+
+	fd = open(name, O_RDWR);
+	if (fd < 0) {
+		warn("Failed to open %s: %m", name);
+		return false;
+	}
+
+	/* One extra byte to tell a too big file */
+	buf = malloc(MAX_IMAGE_SIZE + 1);
+	if (!buf) {
+		warn("Failed to read %s: %m", name);
+		goto out;
+	}
+
+	while ((n = read(fd, buf + len, MAX_IMAGE_SIZE + 1 - len)) > 0)
+		len += n;
+	if (n < 0) {
+		warn("Failed to read %s: %m", name);
+		goto out;
+	}
+	if (len > MAX_IMAGE_SIZE) {
+		warn("Failed to read %s: File is too big", name);
+		goto out;
+	}
+
+	/*
+	 * Nothing is changed in the buffer if this fails,
+	 * it only fails for the images with a broken layout
+	 */
+	if (!fru_fix_checksums(buf, len, fixes, &count)) {
+		if (file->walked) {
+			printf("%s: Skipped, not a FRU image (%s)\n",
+			       name, fru_strerr(fru_errno));
+			rc = true;
+			goto out;
+		}
+		flockfile(stderr);
+		fru_warn("%s", name);
+		funlockfile(stderr);
+		goto out;
+	}
+
+	if (count) {
+		flockfile(stdout);
+		for (size_t i = 0; i < count && i < MAX_FIXES; i++)
+			print_fix(name, &fixes[i]);
+		if (count > MAX_FIXES)
+			printf("%s: %zu more checksums\n", name, count - MAX_FIXES);
+		funlockfile(stdout);
+
+		/*
+		 * Only write the fixed checksum bytes, so that any other
+		 * changes made to the file since it was read survive.
+		 * The whole image is written only if there are too many
+		 * of them to know all the offsets.
+		 */
+		for (size_t i = 0; i < count && count <= MAX_FIXES; i++) {
+			size_t offset = fixes[i].offset;
+
+			if (pwrite(fd, buf + offset, 1, offset) != 1) {
+				warn("Failed to write %s: %m", name);
+				goto out;
+			}
+		}
+		if (count > MAX_FIXES && pwrite(fd, buf, len, 0) != (ssize_t)len) {
+			warn("Failed to write %s: %m", name);
+			goto out;
+		}
+	}
+
+	rc = true;
+out:
+	free(buf);
+	close(fd);
+	return rc;
+}
+
+static
+void * fix_thread(void * arg __attribute__((unused)))
+{
+	size_t i;
+
+	while ((i = __atomic_fetch_add(&next_file, 1, __ATOMIC_RELAXED)) < file_count) {
+		if (!fix_file(&files[i]))
+			__atomic_add_fetch(&failed, 1, __ATOMIC_RELAXED);
+	}
+
+	return NULL;
+}
+
+// See frugen-fix.h
+size_t frugen_fix_checksums(char * const paths[], size_t count)
+{
+	pthread_t * threads;
+	long nthreads;
+
+	for (size_t i = 0; i < count; i++) {
+		struct stat st;
+
+		if (stat(paths[i], &st)) {
+			warn("Failed to open %s: %m", paths[i]);
+			failed++;
+		}
+		else if (S_ISDIR(st.st_mode)) {
+			if (nftw(paths[i], walk_entry, WALK_FDS, FTW_PHYS))
+				fatal("Failed to walk %s: %m", paths[i]);
+		}
+		else {
+			add_file(paths[i], false);
+		}
+	}
+
+	nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nthreads < 1)
+		nthreads = 1;
+	if ((size_t)nthreads > file_count)
+		nthreads = file_count;
+	debug(1, "Fixing %zu files with %ld threads", file_count, nthreads);
+
+	threads = calloc(nthreads, sizeof(*threads));
+	if (nthreads && !threads)
+		fatal("Failed to allocate the threads: %m");
+
+	for (long i = 0; i < nthreads; i++) {
+		errno = pthread_create(&threads[i], NULL, fix_thread, NULL);
+		if (errno)
+			fatal("Failed to start a thread: %m");
+	}
+	for (long i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+
+	free(threads);
+	for (size_t i = 0; i < file_count; i++)
+		free(files[i].name);
+	free(files);
+
+	return failed;
+}
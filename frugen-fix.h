@@ -0,0 +1,23 @@
+/** @file
+ *  @brief FRU generator utility checksum repair header file
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+#pragma once
+
+#include <stddef.h>
+
+#include "frugen.h"
+
+/**
+ * Fix the checksums of binary FRU files in place, see fru_fix_checksums().
+ * The directories among \a paths are walked recursively. The files are
+ * processed in parallel by a thread per online CPU. Every fixed checksum
+ * is reported to stdout, every failed file to stderr.
+ *
+ * @returns The number of files that failed
+ */
+size_t frugen_fix_checksums(char * const paths[], size_t count);
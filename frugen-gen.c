@@ -0,0 +1,295 @@
+/** @file
+ *  @brief FRU generator utility value generators
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "frugen-gen.h"
+
+#define GEN_FAIL(fmt, args...) do { \
+	snprintf(err, errlen, fmt, ##args); \
+	return false; \
+} while(0)
+
+/* xoshiro256** state, see https://prng.di.unimi.it/ */
+static uint64_t prng[4];
+static bool prng_seeded;
+
+static
+uint64_t splitmix64(uint64_t * x)
+{
+	uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+static inline
+uint64_t rotl(uint64_t x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+// See frugen-gen.h
+void frugen_gen_seed(uint64_t seed)
+{
+	for (size_t i = 0; i < 4; i++)
+		prng[i] = splitmix64(&seed);
+	prng_seeded = true;
+}
+
+static
+uint64_t prng_next(void)
+{
+	if (!prng_seeded) {
+		uint64_t seed = 0;
+		int fd = open("/dev/urandom", O_RDONLY);
+
+		if (fd < 0 || read(fd, &seed, sizeof(seed)) != sizeof(seed)) {
+			struct timeval tv;
+
+			gettimeofday(&tv, NULL);
+			seed = ((uint64_t)tv.tv_sec << 20) ^ tv.tv_usec ^ ((uint64_t)getpid() << 40);
+		}
+		if (fd >= 0)
+			close(fd);
+		frugen_gen_seed(seed);
+	}
+
+	const uint64_t result = rotl(prng[1] * 5, 7) * 9;
+	const uint64_t t = prng[1] << 17;
+
+	prng[2] ^= prng[0];
+	prng[3] ^= prng[1];
+	prng[1] ^= prng[2];
+	prng[0] ^= prng[3];
+	prng[2] ^= t;
+	prng[3] = rotl(prng[3], 45);
+
+	return result;
+}
+
+/*
+ * Format 16 bytes as a dashed UUID string, set version and variant
+ */
+static
+void uuid_str(char * out, uint8_t uuid[16], int version)
+{
+	uuid[6] = (uuid[6] & 0x0F) | (version << 4);
+	uuid[8] = (uuid[8] & 0x3F) | 0x80; // RFC 9562 variant
+	for (size_t i = 0; i < 16; i++) {
+		if (i == 4 || i == 6 || i == 8 || i == 10)
+			*out++ = '-';
+		out += sprintf(out, "%02x", uuid[i]);
+	}
+}
+
+static
+void uuid4(char * out)
+{
+	uint8_t uuid[16];
+	uint64_t r[2] = { prng_next(), prng_next() };
+
+	memcpy(uuid, r, sizeof(uuid));
+	uuid_str(out, uuid, 4);
+}
+
+static
+void uuid7(char * out)
+{
+	uint8_t uuid[16];
+	uint64_t r[2] = { prng_next(), prng_next() };
+	struct timeval tv;
+	uint64_t ms;
+
+	gettimeofday(&tv, NULL);
+	ms = (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+
+	memcpy(uuid, r, sizeof(uuid));
+	/* 48-bit big-endian UNIX timestamp in milliseconds */
+	for (size_t i = 0; i < 6; i++)
+		uuid[i] = ms >> (8 * (5 - i));
+	uuid_str(out, uuid, 7);
+}
+
+/*
+ * Luhn check digit for a string of decimal digits
+ */
+static
+char luhn(const char * digits)
+{
+	size_t len = strlen(digits);
+	unsigned sum = 0;
+
+	/* Double every second digit starting from the rightmost one */
+	for (size_t i = 0; i < len; i++) {
+		unsigned d = digits[len - 1 - i] - '0';
+		if (!(i % 2)) {
+			d *= 2;
+			if (d > 9)
+				d -= 9;
+		}
+		sum += d;
+	}
+
+	return '0' + (10 - sum % 10) % 10;
+}
+
+/*
+ * Expand `${seq:<start>[:<step>[:<width>[:luhn]]]}`, \a args point
+ * to the text after `seq:` and is terminated by the closing brace
+ */
+static
+bool expand_seq(char * out, size_t outlen, const char * args, size_t unit,
+                char * err, size_t errlen)
+{
+	long long start, step = 1, val;
+	unsigned long width = 0;
+	bool check = false;
+	char digits[32];
+	char * end;
+
+	errno = 0;
+	start = strtoll(args, &end, 10);
+	if (end == args)
+		GEN_FAIL("Counter start value is required in '${seq:...}'");
+	if (ERANGE == errno)
+		GEN_FAIL("Counter start value is out of range in '${seq:...}'");
+	if (':' == *end) {
+		args = end + 1;
+		step = strtoll(args, &end, 10);
+		if (end == args || ERANGE == errno)
+			GEN_FAIL("Bad counter step in '${seq:...}'");
+	}
+	if (':' == *end) {
+		args = end + 1;
+		width = strtoul(args, &end, 10);
+		if (end == args || width >= sizeof(digits) - 1)
+			GEN_FAIL("Bad counter width in '${seq:...}'");
+	}
+	if (':' == *end) {
+		args = end + 1;
+		if (strncmp(args, "luhn}", 5))
+			GEN_FAIL("Only 'luhn' check digit is supported in '${seq:...}'");
+		check = true;
+		end += 5;
+	}
+	if ('}' != *end)
+		GEN_FAIL("Malformed '${seq:...}' expression");
+
+	if (__builtin_mul_overflow(unit, step, &val)
+	    || __builtin_add_overflow(start, val, &val))
+	{
+		GEN_FAIL("Counter value %lld + %zu * %lld is out of range",
+		         start, unit, step);
+	}
+	if (val < 0)
+		GEN_FAIL("Counter value %lld is negative", val);
+
+	snprintf(digits, sizeof(digits) - 1, "%0*lld", (int)width, val);
+	if (check) {
+		size_t len = strlen(digits);
+		digits[len] = luhn(digits);
+		digits[len + 1] = 0;
+	}
+
+	if (strlen(digits) >= outlen)
+		GEN_FAIL("Expanded value is too long");
+	strcpy(out, digits);
+
+	return true;
+}
+
+// See frugen-gen.h
+bool frugen_gen_has_expr(const char * s)
+{
+	return strstr(s, "${") || strstr(s, "$$");
+}
+
+// See frugen-gen.h
+bool frugen_gen_expand(char * out, size_t outlen, const char * tmpl,
+                       size_t unit, char * err, size_t errlen)
+{
+	static time_t start;
+	size_t pos = 0;
+
+	if (!start)
+		start = time(NULL);
+
+	while (*tmpl) {
+		char value[FRUGEN_GEN_MAXLEN] = {};
+		const char * end;
+		size_t len;
+
+		if ('$' != tmpl[0] || ('{' != tmpl[1] && '$' != tmpl[1])) {
+			if (pos + 1 >= outlen)
+				GEN_FAIL("Expanded value is too long");
+			out[pos++] = *tmpl++;
+			continue;
+		}
+
+		if ('$' == tmpl[1]) {
+			strcpy(value, "$");
+			end = tmpl + 1;
+		}
+		else {
+			const char * expr = tmpl + 2;
+
+			end = strchr(expr, '}');
+			if (!end)
+				GEN_FAIL("Unterminated generator expression '%s'", tmpl);
+
+			if (!strncmp(expr, "seq:", 4)) {
+				if (!expand_seq(value, sizeof(value), expr + 4, unit, err, errlen))
+					return false;
+			}
+			else if (!strncmp(expr, "date:", 5)) {
+				char fmt[FRUGEN_GEN_MAXLEN];
+				struct tm tm;
+
+				len = end - (expr + 5);
+				if (len >= sizeof(fmt))
+					GEN_FAIL("Date format is too long");
+				memcpy(fmt, expr + 5, len);
+				fmt[len] = 0;
+				localtime_r(&start, &tm);
+				if (len && !strftime(value, sizeof(value), fmt, &tm))
+					GEN_FAIL("Bad date format '%s'", fmt);
+			}
+			else if (!strncmp(expr, "uuid4}", 6)) {
+				uuid4(value);
+			}
+			else if (!strncmp(expr, "uuid7}", 6)) {
+				uuid7(value);
+			}
+			else {
+				GEN_FAIL("Unknown generator expression '%.*s'",
+				         (int)(end - tmpl + 1), tmpl);
+			}
+		}
+
+		len = strlen(value);
+		if (pos + len >= outlen)
+			GEN_FAIL("Expanded value is too long");
+		memcpy(out + pos, value, len);
+		pos += len;
+		tmpl = end + 1;
+	}
+
+	out[pos] = 0;
+	return true;
+}
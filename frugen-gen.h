@@ -0,0 +1,57 @@
+/** @file
+ *  @brief FRU generator utility value generators header file
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Generator expressions are expanded in `--set` and `--mr-uuid` values,
+ * and in the output file name, once per generated unit:
+ *
+ *   ${seq:<start>[:<step>[:<width>[:luhn]]]}
+ *                       - A decimal counter, <start> + <unit> * <step>,
+ *                         zero-padded to <width> digits, optionally followed
+ *                         by a Luhn (mod 10) check digit
+ *   ${date:<format>}    - Date/time of the frugen start, strftime() <format>
+ *   ${uuid4}            - A random (version 4) UUID
+ *   ${uuid7}            - A time-ordered (version 7) UUID
+ *   $$                  - A literal '$'
+ *
+ * UUIDs are generated with a fast non-cryptographic PRNG,
+ * see frugen_gen_seed().
+ */
+
+/// Maximum length of an expanded string, including the terminator
+#define FRUGEN_GEN_MAXLEN 1024
+
+/**
+ * Seed the PRNG used for UUID generation. Use the same seed to get
+ * the same sequence of UUIDs. Without a call to this function,
+ * the PRNG is seeded from the system entropy source on first use.
+ */
+void frugen_gen_seed(uint64_t seed);
+
+/**
+ * Check if a string contains any generator expressions
+ */
+bool frugen_gen_has_expr(const char * s);
+
+/**
+ * Expand all generator expressions in \a tmpl for the given \a unit
+ * (0-based) into \a out of \a outlen bytes.
+ *
+ * @param[out] err Buffer for the error message
+ * @param[in] errlen Size of \a err
+ *
+ * @returns Success status, \a err is filled on failure
+ */
+bool frugen_gen_expand(char * out, size_t outlen, const char * tmpl,
+                       size_t unit, char * err, size_t errlen);
@@ -0,0 +1,773 @@
+/** @file
+ *  @brief FRU generator utility streaming JSON reader and writer
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+
+#include <assert.h>
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "frugen-cbor.h"
+#include "frugen-json-stream.h"
+
+/* Parser states, what is expected next */
+enum {
+	EX_VALUE,       // Any value
+	EX_FIRST_VALUE, // Any value or ']'
+	EX_KEY,         // A member name
+	EX_FIRST_KEY,   // A member name or '}'
+	EX_NEXT,        // ',' or the closing bracket
+	EX_DONE,        // Nothing but the end of input
+};
+
+static
+jstream_tok_t fail(jstream_t * js, const char * fmt, ...)
+{
+	size_t line = 1, col = 1;
+	size_t len;
+	va_list ap;
+
+	for (const char * p = js->start; p < js->pos; p++) {
+		col++;
+		if ('\n' == *p) {
+			line++;
+			col = 1;
+		}
+	}
+
+	len = snprintf(js->err, sizeof(js->err), "line %zu, column %zu: ", line, col);
+	va_start(ap, fmt);
+	vsnprintf(js->err + len, sizeof(js->err) - len, fmt, ap);
+	va_end(ap);
+
+	/* Any further calls fail too */
+	js->expect = EX_DONE;
+	js->end = js->pos;
+	js->depth = 0;
+
+	return JSTREAM_ERROR;
+}
+
+/*
+ * Skip whitespace and comments
+ */
+static
+bool skip_space(jstream_t * js)
+{
+	while (js->pos < js->end) {
+		char c = *js->pos;
+
+		if (' ' == c || '\t' == c || '\n' == c || '\r' == c) {
+			js->pos++;
+			continue;
+		}
+
+		if ('/' != c || js->pos + 1 >= js->end)
+			break;
+
+		if ('/' == js->pos[1]) {
+			char * eol = memchr(js->pos, '\n', js->end - js->pos);
+			js->pos = eol ? eol + 1 : js->end;
+		}
+		else if ('*' == js->pos[1]) {
+			char * p;
+
+			for (p = js->pos + 2; p + 1 < js->end; p++) {
+				if ('*' == p[0] && '/' == p[1])
+					break;
+			}
+			if (p + 1 >= js->end) {
+				fail(js, "Unterminated comment");
+				return false;
+			}
+			js->pos = p + 2;
+		}
+		else {
+			break;
+		}
+	}
+
+	return true;
+}
+
+static
+bool hex4(const char * s, const char * end, uint32_t * cp)
+{
+	*cp = 0;
+	if (end - s < 4)
+		return false;
+	for (int i = 0; i < 4; i++) {
+		if (!isxdigit((unsigned char)s[i]))
+			return false;
+		*cp = (*cp << 4) | (isdigit((unsigned char)s[i])
+		                    ? s[i] - '0'
+		                    : (tolower((unsigned char)s[i]) - 'a' + 10));
+	}
+	return true;
+}
+
+static
+char * put_utf8(char * out, uint32_t cp)
+{
+	if (cp < 0x80) {
+		*out++ = cp;
+	}
+	else if (cp < 0x800) {
+		*out++ = 0xC0 | (cp >> 6);
+		*out++ = 0x80 | (cp & 0x3F);
+	}
+	else if (cp < 0x10000) {
+		*out++ = 0xE0 | (cp >> 12);
+		*out++ = 0x80 | ((cp >> 6) & 0x3F);
+		*out++ = 0x80 | (cp & 0x3F);
+	}
+	else {
+		*out++ = 0xF0 | (cp >> 18);
+		*out++ = 0x80 | ((cp >> 12) & 0x3F);
+		*out++ = 0x80 | ((cp >> 6) & 0x3F);
+		*out++ = 0x80 | (cp & 0x3F);
+	}
+	return out;
+}
+
+/*
+ * Unescape a string in place, js->pos points right after the opening quote.
+ * The unescaped string is never longer than the escaped one, so the
+ * terminating NUL always fits at or before the closing quote.
+ */
+static
+bool read_string(jstream_t * js)
+{
+	char * in = js->pos;
+	char * out = js->pos;
+
+	js->str = out;
+	while (in < js->end && '"' != *in) {
+		uint32_t cp, lo;
+
+		if ((unsigned char)*in < 0x20) {
+			js->pos = in;
+			fail(js, "Control character in a string");
+			return false;
+		}
+
+		if ('\\' != *in) {
+			*out++ = *in++;
+			continue;
+		}
+
+		if (++in >= js->end)
+			break;
+
+		switch (*in++) {
+		case '"':  *out++ = '"'; break;
+		case '\\': *out++ = '\\'; break;
+		case '/':  *out++ = '/'; break;
+		case 'b':  *out++ = '\b'; break;
+		case 'f':  *out++ = '\f'; break;
+		case 'n':  *out++ = '\n'; break;
+		case 'r':  *out++ = '\r'; break;
+		case 't':  *out++ = '\t'; break;
+		case 'u':
+			if (!hex4(in, js->end, &cp))
+				goto bad_escape;
+			in += 4;
+			if (cp >= 0xDC00 && cp <= 0xDFFF)
+				goto bad_escape;
+			if (cp >= 0xD800 && cp <= 0xDBFF) {
+				/* A surrogate pair */
+				if (js->end - in < 6 || '\\' != in[0] || 'u' != in[1]
+				    || !hex4(in + 2, js->end, &lo)
+				    || lo < 0xDC00 || lo > 0xDFFF)
+				{
+					goto bad_escape;
+				}
+				in += 6;
+				cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+			}
+			out = put_utf8(out, cp);
+			break;
+		default:
+			goto bad_escape;
+		}
+	}
+
+	if (in >= js->end) {
+		fail(js, "Unterminated string");
+		return false;
+	}
+
+	*out = 0;
+	js->len = out - js->str;
+	js->pos = in + 1;
+	return true;
+
+bad_escape:
+	js->pos = in;
+	fail(js, "Invalid escape sequence in a string");
+	return false;
+}
+
+static
+bool read_number(jstream_t * js)
+{
+	char * p = js->pos;
+
+#define DIGITS() do { \
+	if (p >= js->end || !isdigit((unsigned char)*p)) \
+		goto bad; \
+	while (p < js->end && isdigit((unsigned char)*p)) \
+		p++; \
+} while(0)
+
+	if ('-' == *p)
+		p++;
+	if (p < js->end && '0' == *p)
+		p++;
+	else
+		DIGITS();
+	if (p < js->end && '.' == *p) {
+		p++;
+		DIGITS();
+	}
+	if (p < js->end && ('e' == *p || 'E' == *p)) {
+		p++;
+		if (p < js->end && ('+' == *p || '-' == *p))
+			p++;
+		DIGITS();
+	}
+
+#undef DIGITS
+
+	if ((size_t)(p - js->pos) >= sizeof(js->num)) {
+		fail(js, "Number is too long");
+		return false;
+	}
+	js->len = p - js->pos;
+	memcpy(js->num, js->pos, js->len);
+	js->num[js->len] = 0;
+	js->str = js->num;
+	js->pos = p;
+	return true;
+
+bad:
+	js->pos = p;
+	fail(js, "Malformed number");
+	return false;
+}
+
+static
+jstream_tok_t value_done(jstream_t * js, jstream_tok_t tok)
+{
+	js->expect = js->depth ? EX_NEXT : EX_DONE;
+	return tok;
+}
+
+static
+jstream_tok_t open_container(jstream_t * js, char c)
+{
+	if (js->depth >= JSTREAM_MAXDEPTH)
+		return fail(js, "Nesting is too deep");
+
+	js->stack[js->depth++] = c;
+	js->pos++;
+	if ('{' == c) {
+		js->expect = EX_FIRST_KEY;
+		return JSTREAM_OBJECT;
+	}
+	js->expect = EX_FIRST_VALUE;
+	return JSTREAM_ARRAY;
+}
+
+static
+jstream_tok_t close_container(jstream_t * js)
+{
+	js->pos++;
+	return value_done(js, '{' == js->stack[--js->depth]
+	                      ? JSTREAM_OBJECT_END
+	                      : JSTREAM_ARRAY_END);
+}
+
+static
+jstream_tok_t read_literal(jstream_t * js)
+{
+	static const struct {
+		const char * text;
+		jstream_tok_t tok;
+	} literals[] = {
+		{ "true", JSTREAM_TRUE },
+		{ "false", JSTREAM_FALSE },
+		{ "null", JSTREAM_NULL },
+	};
+
+	for (size_t i = 0; i < sizeof(literals) / sizeof(literals[0]); i++) {
+		size_t len = strlen(literals[i].text);
+
+		if ((size_t)(js->end - js->pos) < len
+		    || memcmp(js->pos, literals[i].text, len))
+		{
+			continue;
+		}
+		if (js->pos + len < js->end && isalnum((unsigned char)js->pos[len]))
+			break;
+		js->pos += len;
+		return value_done(js, literals[i].tok);
+	}
+
+	return fail(js, "Unexpected character '%c'", *js->pos);
+}
+
+static
+jstream_tok_t read_value(jstream_t * js)
+{
+	char c = *js->pos;
+
+	if ('{' == c || '[' == c)
+		return open_container(js, c);
+
+	if ('"' == c) {
+		js->pos++;
+		if (!read_string(js))
+			return JSTREAM_ERROR;
+		return value_done(js, JSTREAM_STRING);
+	}
+
+	if ('-' == c || isdigit((unsigned char)c)) {
+		if (!read_number(js))
+			return JSTREAM_ERROR;
+		return value_done(js, JSTREAM_NUMBER);
+	}
+
+	return read_literal(js);
+}
+
+// See frugen-json-stream.h
+void jstream_init(jstream_t * js, char * buf, size_t len)
+{
+	js->start = js->pos = buf;
+	js->end = buf + len;
+	js->depth = 0;
+	js->expect = EX_VALUE;
+	js->str = NULL;
+	js->len = 0;
+	js->err[0] = 0;
+	js->cbor = false;
+
+	/* Skip UTF-8 BOM */
+	if (len >= 3 && !memcmp(buf, "\xEF\xBB\xBF", 3))
+		js->pos += 3;
+}
+
+// See frugen-json-stream.h
+jstream_tok_t jstream_next(jstream_t * js)
+{
+	char top;
+	char c;
+
+	if (js->cbor)
+		return jstream_next_cbor(js);
+
+again:
+	if (!skip_space(js))
+		return JSTREAM_ERROR;
+
+	if (js->pos >= js->end) {
+		if (EX_DONE == js->expect && !js->err[0])
+			return JSTREAM_END;
+		return js->err[0] ? JSTREAM_ERROR : fail(js, "Unexpected end of input");
+	}
+
+	c = *js->pos;
+	top = js->depth ? js->stack[js->depth - 1] : 0;
+
+	switch (js->expect) {
+	case EX_DONE:
+		return fail(js, "Unexpected data after the end of value");
+
+	case EX_NEXT:
+		if (',' == c) {
+			js->pos++;
+			js->expect = ('{' == top) ? EX_KEY : EX_VALUE;
+			goto again;
+		}
+		if (('{' == top && '}' == c) || ('[' == top && ']' == c))
+			return close_container(js);
+		return fail(js, "Expected ',' or '%c'", ('{' == top) ? '}' : ']');
+
+	case EX_FIRST_KEY:
+		if ('}' == c)
+			return close_container(js);
+		// fall through
+	case EX_KEY:
+		if ('"' != c)
+			return fail(js, "Expected an object member name");
+		js->pos++;
+		if (!read_string(js) || !skip_space(js))
+			return JSTREAM_ERROR;
+		if (js->pos >= js->end || ':' != *js->pos)
+			return fail(js, "Expected ':' after the member name");
+		js->pos++;
+		js->expect = EX_VALUE;
+		return JSTREAM_KEY;
+
+	case EX_FIRST_VALUE:
+		if (']' == c)
+			return close_container(js);
+		// fall through
+	default:
+		return read_value(js);
+	}
+}
+
+// See frugen-json-stream.h
+bool jstream_skip(jstream_t * js, jstream_tok_t tok)
+{
+	unsigned depth = js->depth;
+
+	if (JSTREAM_OBJECT != tok && JSTREAM_ARRAY != tok)
+		return JSTREAM_ERROR != tok;
+
+	while (js->depth >= depth) {
+		tok = jstream_next(js);
+		if (JSTREAM_ERROR == tok || JSTREAM_END == tok)
+			return false;
+	}
+
+	return true;
+}
+
+// See frugen-json-stream.h
+void jsout_init(jsout_t * jo, FILE * fp, jsout_format_t format)
+{
+	jo->fp = fp;
+	jo->pretty = (JSOUT_PRETTY == format);
+	jo->cbor = (JSOUT_CBOR == format);
+	jo->after_key = false;
+	jo->error = false;
+	jo->depth = 0;
+	jo->len = 0;
+}
+
+// See frugen-json-stream.h
+bool jsout_flush(jsout_t * jo)
+{
+	if (jo->len && fwrite(jo->buf, 1, jo->len, jo->fp) != jo->len)
+		jo->error = true;
+	jo->len = 0;
+	if (fflush(jo->fp))
+		jo->error = true;
+
+	return !jo->error;
+}
+
+static
+void put(jsout_t * jo, const char * s, size_t len)
+{
+	if (jo->len + len > sizeof(jo->buf)) {
+		if (fwrite(jo->buf, 1, jo->len, jo->fp) != jo->len)
+			jo->error = true;
+		jo->len = 0;
+		if (len > sizeof(jo->buf)) {
+			if (fwrite(s, 1, len, jo->fp) != len)
+				jo->error = true;
+			return;
+		}
+	}
+	memcpy(jo->buf + jo->len, s, len);
+	jo->len += len;
+}
+
+static inline
+void putstr(jsout_t * jo, const char * s)
+{
+	put(jo, s, strlen(s));
+}
+
+/*
+ * Write a CBOR data item head, the shortest form for \a val is used
+ */
+static
+void put_head(jsout_t * jo, uint8_t major, uint64_t val)
+{
+	uint8_t head[9];
+	size_t len = 1;
+
+	major <<= 5;
+	if (val < 24) {
+		head[0] = major | val;
+	}
+	else {
+		int n = val <= UINT8_MAX ? 1 : val <= UINT16_MAX ? 2 : val <= UINT32_MAX ? 4 : 8;
+
+		head[0] = major | (n == 1 ? 24 : n == 2 ? 25 : n == 4 ? 26 : 27);
+		for (len = 0; len < (size_t)n; len++)
+			head[1 + len] = val >> (8 * (n - 1 - len));
+		len++;
+	}
+	put(jo, (const char *)head, len);
+}
+
+static
+void indent(jsout_t * jo, unsigned level)
+{
+	static const char spaces[] = "                                ";
+
+	for (level *= 2; level; ) {
+		unsigned n = level < sizeof(spaces) - 1 ? level : sizeof(spaces) - 1;
+		put(jo, spaces, n);
+		level -= n;
+	}
+}
+
+/*
+ * Separate a new member of the innermost container from the previous
+ * one, unless it's a value that follows a key
+ */
+static
+void begin_value(jsout_t * jo)
+{
+	if (jo->after_key) {
+		jo->after_key = false;
+		return;
+	}
+
+	if (!jo->depth || jo->cbor)
+		return;
+
+	if (jo->nonempty[jo->depth - 1])
+		put(jo, jo->pretty ? ",\n" : ",", jo->pretty ? 2 : 1);
+	jo->nonempty[jo->depth - 1] = true;
+	if (jo->pretty)
+		indent(jo, jo->depth);
+}
+
+static
+void open_out(jsout_t * jo, char c)
+{
+	assert(jo->depth < JSTREAM_MAXDEPTH);
+
+	begin_value(jo);
+	if (jo->cbor) {
+		/* Indefinite length, so that members needn't be counted */
+		put(jo, '{' == c ? "\xBF" : "\x9F", 1);
+	}
+	else {
+		put(jo, &c, 1);
+		if (jo->pretty)
+			put(jo, "\n", 1);
+	}
+	jo->nonempty[jo->depth++] = false;
+}
+
+static
+void close_out(jsout_t * jo, char c)
+{
+	assert(jo->depth);
+
+	jo->depth--;
+	if (jo->cbor) {
+		put(jo, "\xFF", 1); // The "break" stop code
+		return;
+	}
+	if (jo->pretty) {
+		if (jo->nonempty[jo->depth])
+			put(jo, "\n", 1);
+		indent(jo, jo->depth);
+	}
+	put(jo, &c, 1);
+}
+
+// See frugen-json-stream.h
+void jsout_object(jsout_t * jo)
+{
+	open_out(jo, '{');
+}
+
+// See frugen-json-stream.h
+void jsout_object_end(jsout_t * jo)
+{
+	close_out(jo, '}');
+}
+
+// See frugen-json-stream.h
+void jsout_array(jsout_t * jo)
+{
+	open_out(jo, '[');
+}
+
+// See frugen-json-stream.h
+void jsout_array_end(jsout_t * jo)
+{
+	close_out(jo, ']');
+}
+
+/*
+ * Write a quoted string. Quotes, backslashes and control characters
+ * are escaped, anything else including non-ASCII bytes goes as is.
+ */
+static
+void put_quoted(jsout_t * jo, const char * str, size_t len)
+{
+	const char * start = str;
+	const char * end = str + len;
+
+	put(jo, "\"", 1);
+	for (; str < end; str++) {
+		unsigned char c = *str;
+		char esc[7];
+
+		if (c >= 0x20 && '"' != c && '\\' != c)
+			continue;
+
+		put(jo, start, str - start);
+		start = str + 1;
+		switch (c) {
+		case '"':  put(jo, "\\\"", 2); break;
+		case '\\': put(jo, "\\\\", 2); break;
+		case '\b': put(jo, "\\b", 2); break;
+		case '\f': put(jo, "\\f", 2); break;
+		case '\n': put(jo, "\\n", 2); break;
+		case '\r': put(jo, "\\r", 2); break;
+		case '\t': put(jo, "\\t", 2); break;
+		default:
+			snprintf(esc, sizeof(esc), "\\u%04x", c);
+			put(jo, esc, 6);
+		}
+	}
+	put(jo, start, str - start);
+	put(jo, "\"", 1);
+}
+
+// See frugen-json-stream.h
+void jsout_key(jsout_t * jo, const char * key)
+{
+	jsout_keyn(jo, key, strlen(key));
+}
+
+// See frugen-json-stream.h
+void jsout_keyn(jsout_t * jo, const char * key, size_t len)
+{
+	jsout_stringn(jo, key, len);
+	if (!jo->cbor)
+		put(jo, jo->pretty ? ": " : ":", jo->pretty ? 2 : 1);
+	jo->after_key = true;
+}
+
+// See frugen-json-stream.h
+void jsout_string(jsout_t * jo, const char * str)
+{
+	jsout_stringn(jo, str, strlen(str));
+}
+
+// See frugen-json-stream.h
+void jsout_stringn(jsout_t * jo, const char * str, size_t len)
+{
+	begin_value(jo);
+	if (jo->cbor) {
+		put_head(jo, CBOR_TSTR, len);
+		put(jo, str, len);
+	}
+	else {
+		put_quoted(jo, str, len);
+	}
+}
+
+static inline
+int hexval(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+// See frugen-json-stream.h
+void jsout_hex(jsout_t * jo, const char * hex)
+{
+	size_t len = strlen(hex);
+
+	if (!jo->cbor || len % 2) {
+		jsout_string(jo, hex);
+		return;
+	}
+
+	for (size_t i = 0; i < len; i++) {
+		if (hexval(hex[i]) < 0) {
+			jsout_string(jo, hex);
+			return;
+		}
+	}
+
+	begin_value(jo);
+	put_head(jo, CBOR_BSTR, len / 2);
+	for (size_t i = 0; i < len; i += 2) {
+		char byte = hexval(hex[i]) << 4 | hexval(hex[i + 1]);
+		put(jo, &byte, 1);
+	}
+}
+
+// See frugen-json-stream.h
+void jsout_bytes(jsout_t * jo, const void * data, size_t len)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	const uint8_t * bytes = data;
+
+	begin_value(jo);
+	if (jo->cbor) {
+		put_head(jo, CBOR_BSTR, len);
+		if (len)
+			put(jo, data, len);
+		return;
+	}
+
+	put(jo, "\"", 1);
+	for (size_t i = 0; i < len; i++) {
+		char pair[2] = { hex[bytes[i] >> 4], hex[bytes[i] & 0x0F] };
+		put(jo, pair, sizeof(pair));
+	}
+	put(jo, "\"", 1);
+}
+
+// See frugen-json-stream.h
+void jsout_int(jsout_t * jo, int64_t val)
+{
+	char num[24];
+
+	begin_value(jo);
+	if (jo->cbor) {
+		if (val < 0)
+			put_head(jo, CBOR_NEGINT, -(val + 1));
+		else
+			put_head(jo, CBOR_UINT, val);
+		return;
+	}
+	put(jo, num, snprintf(num, sizeof(num), "%" PRId64, val));
+}
+
+// See frugen-json-stream.h
+void jsout_null(jsout_t * jo)
+{
+	begin_value(jo);
+	if (jo->cbor)
+		put(jo, "\xF6", 1);
+	else
+		putstr(jo, "null");
+}
+
+// See frugen-json-stream.h
+void jsout_bool(jsout_t * jo, bool val)
+{
+	begin_value(jo);
+	if (jo->cbor)
+		put(jo, val ? "\xF5" : "\xF4", 1);
+	else
+		putstr(jo, val ? "true" : "false");
+}
@@ -0,0 +1,173 @@
+/** @file
+ *  @brief FRU generator utility streaming JSON reader and writer header file
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * A pull tokenizer for JSON with C-style comments (both block and
+ * line ones), working on a mutable in-memory buffer. No memory is
+ * allocated: strings are unescaped in place and NUL-terminated,
+ * so they stay valid for as long as the buffer does.
+ *
+ * The same tokens are produced for CBOR input, see frugen-cbor.h,
+ * with byte strings given as JSTREAM_BYTES.
+ */
+
+/// Maximum nesting level of objects and arrays
+#define JSTREAM_MAXDEPTH 32
+
+typedef enum {
+	JSTREAM_ERROR,      ///< Syntax error, see jstream_t.err
+	JSTREAM_END,        ///< End of input after a complete value
+	JSTREAM_OBJECT,     ///< Start of an object
+	JSTREAM_OBJECT_END, ///< End of an object
+	JSTREAM_ARRAY,      ///< Start of an array
+	JSTREAM_ARRAY_END,  ///< End of an array
+	JSTREAM_KEY,        ///< Object member name in `str`
+	JSTREAM_STRING,     ///< String value in `str`
+	JSTREAM_NUMBER,     ///< Number value, the original text in `str`
+	JSTREAM_TRUE,
+	JSTREAM_FALSE,
+	JSTREAM_NULL,
+	JSTREAM_BYTES,      ///< CBOR byte string, `len` bytes at `str`, not terminated
+} jstream_tok_t;
+
+typedef struct {
+	char * pos;
+	char * end;
+	char * start; ///< Start of the buffer, for error reporting
+	unsigned depth;
+	char stack[JSTREAM_MAXDEPTH]; ///< Open containers, '{' or '['
+	int expect; ///< Parser state, private
+	const char * str; ///< Value of the last string, key or number token
+	size_t len; ///< Length of `str`
+	char num[64]; ///< Storage for number tokens
+	char err[128]; ///< Error message for JSTREAM_ERROR
+	bool cbor; ///< The buffer holds CBOR, not JSON text
+	/* CBOR state of the open containers, private */
+	struct {
+		uint64_t left; ///< Items left in a definite-length container
+		bool indefinite;
+		bool value; ///< A map value comes next, not a key
+	} cbor_stack[JSTREAM_MAXDEPTH];
+} jstream_t;
+
+/**
+ * Start tokenizing a buffer of \a len bytes, the buffer is modified
+ */
+void jstream_init(jstream_t * js, char * buf, size_t len);
+
+/**
+ * Get the next token, from either JSON or CBOR input
+ */
+jstream_tok_t jstream_next(jstream_t * js);
+
+/**
+ * Skip a value that starts with the token \a tok just returned by
+ * jstream_next(), that is the whole object or array for
+ * JSTREAM_OBJECT and JSTREAM_ARRAY, and nothing for scalars.
+ *
+ * @returns false on syntax errors
+ */
+bool jstream_skip(jstream_t * js, jstream_tok_t tok);
+
+/**
+ * Check that \a tok is a scalar value (not a container, a key, or an error)
+ */
+static inline
+bool jstream_is_scalar(jstream_tok_t tok)
+{
+	return tok >= JSTREAM_STRING;
+}
+
+/*
+ * A JSON writer producing text directly into a buffered stdio stream.
+ * The pretty format is the one of json-c with JSON_C_TO_STRING_PRETTY,
+ * JSON_C_TO_STRING_SPACED and JSON_C_TO_STRING_NOSLASHESCAPE flags:
+ * one member per line indented by two spaces per level, a space after
+ * colons, and an empty container still spanning two lines. The compact
+ * format has no whitespace at all.
+ *
+ * The same calls may produce CBOR (RFC 8949) instead of JSON text,
+ * with objects and arrays encoded as indefinite-length maps and arrays,
+ * and hex strings written with jsout_hex() encoded as byte strings.
+ *
+ * The caller is responsible for the structure being valid: keys only
+ * in objects, each key followed by exactly one value.
+ */
+
+typedef enum {
+	JSOUT_PRETTY,
+	JSOUT_COMPACT,
+	JSOUT_CBOR,
+} jsout_format_t;
+
+typedef struct {
+	FILE * fp;
+	bool pretty;
+	bool cbor;
+	bool after_key; ///< A key was just written, the value follows
+	bool error; ///< Writing to `fp` failed
+	unsigned depth;
+	bool nonempty[JSTREAM_MAXDEPTH]; ///< Open containers have members
+	size_t len; ///< Bytes used in `buf`
+	char buf[8192];
+} jsout_t;
+
+/**
+ * Start writing to \a fp in the given \a format
+ */
+void jsout_init(jsout_t * jo, FILE * fp, jsout_format_t format);
+
+/**
+ * Start an object, either as a value or as an array element
+ */
+void jsout_object(jsout_t * jo);
+void jsout_object_end(jsout_t * jo);
+
+/**
+ * Start an array, either as a value or as an array element
+ */
+void jsout_array(jsout_t * jo);
+void jsout_array_end(jsout_t * jo);
+
+/**
+ * Write an object member name, must be followed by a value
+ */
+void jsout_key(jsout_t * jo, const char * key);
+void jsout_keyn(jsout_t * jo, const char * key, size_t len);
+
+void jsout_string(jsout_t * jo, const char * str);
+void jsout_stringn(jsout_t * jo, const char * str, size_t len);
+
+/**
+ * Write binary data given as a hex string. That is a string in JSON,
+ * and a byte string in CBOR unless \a hex isn't valid hex.
+ */
+void jsout_hex(jsout_t * jo, const char * hex);
+
+/**
+ * Write \a len bytes of binary data, as an uppercase hex string
+ * in JSON, and as a byte string in CBOR
+ */
+void jsout_bytes(jsout_t * jo, const void * data, size_t len);
+void jsout_int(jsout_t * jo, int64_t val);
+void jsout_bool(jsout_t * jo, bool val);
+void jsout_null(jsout_t * jo);
+
+/**
+ * Flush the buffered text to the stream
+ *
+ * @returns false if anything failed to be written
+ */
+bool jsout_flush(jsout_t * jo);
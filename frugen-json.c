@@ -15,609 +15,959 @@
 #include <string.h>
 #include <time.h>
 
-#include <json-c/json.h>
-
 #include "fru_errno.h"
+#include "frugen-cbor.h"
 #include "frugen-json.h"
+#include "frugen-json-stream.h"
+
+/*
+ * The template loader below works directly on the token stream,
+ * without building a json-c object tree, and fills the fru_t as the
+ * tokens arrive. That matters for JSONL manifests with millions
+ * of lines. Only MR records are collected before being applied,
+ * because their type may come after the other members.
+ *
+ * The tokens come from either JSON text or CBOR. Wherever binary
+ * data are expected, CBOR byte strings are taken as they are,
+ * and JSON hex strings are converted.
+ */
 
-#if (JSON_C_MAJOR_VERSION == 0 && JSON_C_MINOR_VERSION < 13)
-#include <string.h>
-static // Don't export the local definition
-int
-json_object_to_fd(int fd, struct json_object *obj, int flags)
+/// Maximum number of members in an MR record object
+#define MR_MAX_MEMBERS 32
+
+/* A scalar member of an MR record object */
+typedef struct {
+	const char * key;
+	jstream_tok_t tok;
+	const char * str; ///< Points either to the input buffer or to `num`
+	size_t len; ///< Length of `str`, needed for byte strings
+	char num[24];
+} member_t;
+
+typedef struct {
+	jstream_t js;
+	fru_t * fru;
+	bool merge; ///< Replace the management records of the same subtype
+	const char * name; ///< File name, for diagnostics
+	size_t line; ///< Line number for manifests, 0 otherwise
+} loader_t;
+
+#define jswarn(l, fmt, args...) do { \
+	if ((l)->line) \
+		warn("%s:%zu: " fmt, (l)->name, (l)->line, ##args); \
+	else \
+		warn("%s: " fmt, (l)->name, ##args); \
+} while(0)
+
+/*
+ * Report a syntax error, or an unexpected token type
+ */
+static
+bool unexpected(loader_t * l, jstream_tok_t tok, const char * what)
 {
-	// implementation is copied from json-c v0.13 with minor refactoring
-	int ret;
-	const char *json_str;
-	size_t pos, size;
+	if (JSTREAM_ERROR == tok)
+		jswarn(l, "%s", l->js.err);
+	else
+		jswarn(l, "%s expected", what);
+	return false;
+}
 
-	if (!(json_str = json_object_to_json_string_ext(obj, flags))) {
-		return -1;
+/*
+ * Get a string value the way json_object_get_string() does for
+ * scalars, that is the original text for numbers and literals.
+ * Byte strings aren't strings.
+ */
+static
+const char * scalar_str(jstream_tok_t tok, const char * str)
+{
+	switch (tok) {
+	case JSTREAM_TRUE: return "true";
+	case JSTREAM_FALSE: return "false";
+	case JSTREAM_NULL:
+	case JSTREAM_BYTES:
+		return NULL;
+	default: return str;
 	}
+}
 
-	size = strlen(json_str);
-	pos = 0;
-	while(pos < size) {
-		if((ret = write(fd, json_str + pos, size - pos)) < 0) {
-			return -1;
-		}
+/*
+ * Get a hex string member of an MR record into \a out of \a size bytes.
+ * fru_mr_rec_t keeps all binary data as hex strings, so that's where
+ * the byte strings get converted.
+ *
+ * @retval false Neither a string nor a byte string, or too long
+ */
+static
+bool member_hex(const member_t * m, char * out, size_t size)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	const uint8_t * bytes = (const uint8_t *)m->str;
 
-		/* because of the above check for ret < 0, we can safely add */
-		pos += ret;
+	if (JSTREAM_STRING == m->tok && m->len < size) {
+		strcpy(out, m->str);
+		return true;
 	}
 
-	return 0;
+	if (JSTREAM_BYTES != m->tok || m->len > (size - 1) / 2)
+		return false;
+
+	for (size_t i = 0; i < m->len; i++) {
+		*out++ = hex[bytes[i] >> 4];
+		*out++ = hex[bytes[i] & 0x0F];
+	}
+	*out = 0;
+
+	return true;
+}
+
+/*
+ * Get an integer value, the strings are parsed like json-c does
+ */
+static
+bool scalar_int(jstream_tok_t tok, const char * str, int64_t * val)
+{
+	char * end;
+
+	switch (tok) {
+	case JSTREAM_TRUE:
+	case JSTREAM_FALSE:
+		*val = (JSTREAM_TRUE == tok);
+		return true;
+	case JSTREAM_NUMBER:
+	case JSTREAM_STRING:
+		errno = 0;
+		*val = strtoll(str, &end, 10);
+		return !errno && end != str && !*end;
+	default:
+		return false;
+	}
 }
-#endif
 
+/*
+ * Get a boolean value the way json_object_get_boolean() does
+ */
 static
-bool load_single_field(fru_field_t * field, json_object * jsfield)
+bool scalar_bool(jstream_tok_t tok, const char * str)
 {
-	bool rc = false;
-
-	// jsfield is either an object or a string.
-	// First assume it's an object with 'type' and 'data' fields.
-	json_object *typefield, *valfield;
-	const char * val;
-	fru_field_enc_t encoding = FRU_FE_UNKNOWN;
-	if (json_object_object_get_ex(jsfield, "type", &typefield) &&
-	    json_object_object_get_ex(jsfield, "data", &valfield))
-	{
-		// expected subfields are type and val
-		const char * type = json_object_get_string(typefield);
-		val = json_object_get_string(valfield);
-		encoding = frugen_enc_by_name(type);
-		if (FRU_FE_UNKNOWN == encoding) {
-			warn("Unknown encoding type '%s', using 'auto'", type);
-			encoding = FRU_FE_AUTO;
-		}
-	} else {
-		// Apparently, jsfield is not an object.
-		// It must be a string then.
-		encoding = FRU_FE_AUTO;
-		val = json_object_get_string(jsfield);
-		if (!val) {
-			warn("Field is neither an object, nor a string");
-			goto out;
+	switch (tok) {
+	case JSTREAM_TRUE: return true;
+	case JSTREAM_NUMBER: return strtod(str, NULL) != 0;
+	case JSTREAM_STRING: return !!*str;
+	default: return false;
+	}
+}
+
+/*
+ * Load a field given either as a plain value, or
+ * as an object with `type` and `data` members
+ */
+static
+bool load_field(loader_t * l, jstream_tok_t tok, fru_field_t * field)
+{
+	fru_field_enc_t encoding = FRU_FE_AUTO;
+	const char * val = NULL;
+	const char * bytes = NULL;
+	size_t size = 0;
+	char num[sizeof(l->js.num)];
+
+	if (JSTREAM_OBJECT == tok) {
+		while (JSTREAM_KEY == (tok = jstream_next(&l->js))) {
+			const char * key = l->js.str;
+
+			tok = jstream_next(&l->js);
+			if (!strcmp(key, "type") && JSTREAM_STRING == tok) {
+				encoding = frugen_enc_by_name(l->js.str);
+				if (FRU_FE_UNKNOWN == encoding) {
+					jswarn(l, "Unknown encoding type '%s', using 'auto'", l->js.str);
+					encoding = FRU_FE_AUTO;
+				}
+			}
+			else if (!strcmp(key, "data") && JSTREAM_BYTES == tok) {
+				bytes = l->js.str;
+				size = l->js.len;
+			}
+			else if (!strcmp(key, "data") && jstream_is_scalar(tok)) {
+				val = scalar_str(tok, l->js.str);
+				/* Numbers live in the tokenizer, keep a copy */
+				if (JSTREAM_NUMBER == tok)
+					val = strcpy(num, val);
+			}
+			else if (!jstream_skip(&l->js, tok)) {
+				return unexpected(l, JSTREAM_ERROR, NULL);
+			}
 		}
+		if (JSTREAM_OBJECT_END != tok)
+			return unexpected(l, tok, "Member name");
+	}
+	else if (JSTREAM_BYTES == tok) {
+		bytes = l->js.str;
+		size = l->js.len;
+	}
+	else if (jstream_is_scalar(tok)) {
+		val = scalar_str(tok, l->js.str);
+	}
+	else {
+		return unexpected(l, tok, "Field value");
+	}
+
+	if (bytes) {
+		if (FRU_FE_AUTO != encoding && FRU_FE_BINARY != encoding) {
+			jswarn(l, "Byte string data for a '%s' field",
+			       frugen_enc_name_by_val(encoding));
+			return false;
+		}
+		if (!fru_setfield_binary(field, bytes, size)) {
+			jswarn(l, "Couldn't add field: %s", fru_strerr(fru_errno));
+			return false;
+		}
+		return true;
+	}
+
+	if (!val) {
+		jswarn(l, "Field has no data");
+		return false;
 	}
 
 	if (!fru_setfield(field, encoding, val)) {
-		warn("Couldn't add field: %s", fru_strerr(fru_errno));
-		goto out;
+		jswarn(l, "Couldn't add field: %s", fru_strerr(fru_errno));
+		return false;
 	}
 
-	rc = true;
-out:
-	return rc;
+	return true;
 }
 
 static
-bool load_info_fields(fru_t * fru, fru_area_type_t atype,
-                      json_object *jso)
+bool load_custom_list(loader_t * l, fru_area_type_t atype)
 {
-	bool rc = false;
-	json_object *jsfield;
-	const char * const jsnames[FRU_INFO_AREAS][FRU_MAX_FIELD_COUNT] = {
-		[FRU_INFOIDX(CHASSIS)] = {
-			"pn",
-			"serial"
-		},
-		[FRU_INFOIDX(BOARD)] = {
-			"mfg",
-			"pname",
-			"serial",
-			"pn",
-			"file"
-		},
-		[FRU_INFOIDX(PRODUCT)] = {
-			"mfg",
-			"pname",
-			"pn",
-			"ver",
-			"serial",
-			"atag",
-			"file"
-		}
-	};
-
-	/* First load mandatory fields */
-
-	size_t field_idx = FRU_LIST_HEAD;
-	fru_field_t * field;
-	int infoidx = FRU_ATYPE_TO_INFOIDX(atype);
-	while ((field = fru_getfield(fru, atype, field_idx))) {
-		const char * jsname = jsnames[infoidx][field_idx];
-		if (!json_object_object_get_ex(jso, jsname, &jsfield)) {
-			debug(2, "Field '%s' not found for area '%s', skipping",
-			      jsname, area_names[atype].json);
-			goto nextloop;
-		}
-
-		if (!load_single_field(field, jsfield)) {
-			warn("Failed to parse or add field '%s'", jsname);
-			goto out;
-		}
-
-	nextloop:
-		field_idx++;
-		debug(2, "Field '%s' = '%s' (%s) loaded from JSON",
-		      jsname, field->val, frugen_enc_name_by_val(field->enc));
-	}
-
-	/* Now load custom fields */
-
-	json_object_object_get_ex(jso, "custom", &jsfield);
-	if (!jsfield) {
-		debug(2, "No custom field list provided");
-		rc = true;
-		goto out;
-	}
-
-	if (json_object_get_type(jsfield) != json_type_array) {
-		warn("Field 'custom' is not a list object");
+	jstream_tok_t tok = jstream_next(&l->js);
+	size_t i;
+
+	if (JSTREAM_ARRAY != tok) {
+		jswarn(l, "Field 'custom' is not a list object");
 		return false;
 	}
 
-	size_t alen = json_object_array_length(jsfield);
-	if (!alen)
-		debug(1, "Custom list is present but empty");
-
-	for (size_t i = 0; i < alen; i++) {
+	for (i = 0; JSTREAM_ARRAY_END != (tok = jstream_next(&l->js)); i++) {
 		fru_field_t field;
-		json_object *item;
 
-		item = json_object_array_get_idx(jsfield, i);
-		if (!item)
+		if (JSTREAM_NULL == tok)
 			continue;
 
-		if (!load_single_field(&field, item)) {
-			warn("Failed to load custom field %zu", LIST_INDEX_FRUGEN(i));
-			goto out;
+		if (!load_field(l, tok, &field)) {
+			jswarn(l, "Failed to load custom field %zu", LIST_INDEX_FRUGEN(i));
+			return false;
 		}
 
-		if (!fru_add_custom(fru, atype, FRU_LIST_TAIL, field.enc, field.val)) {
+		if (!fru_add_custom(l->fru, atype, FRU_LIST_TAIL, field.enc, field.val)) {
 			fru_warn("Failed to add custom field %zu", LIST_INDEX_FRUGEN(i));
-			goto out;
+			return false;
 		}
 
 		debug(2, "Custom field %zu has been loaded from JSON", LIST_INDEX_FRUGEN(i));
 	}
 
-	rc = true;
+	if (!i)
+		debug(1, "Custom list is present but empty");
 
-out:
-	return rc;
+	return true;
 }
 
 static
-bool load_mr_mgmt_record(fru_t * fru,
-                         json_object * item)
+bool load_info_area(loader_t * l, fru_area_type_t atype)
 {
-	bool rc = false;
-	const char *subtype = NULL;
-	fru_mr_mgmt_type_t subtype_id;
-	json_object * ifield;
+	jstream_tok_t tok = jstream_next(&l->js);
+	fru_t * fru = l->fru;
 
-	json_object_object_get_ex(item, "subtype", &ifield);
-	if (!ifield || !(subtype = json_object_get_string(ifield))) {
-		warn("Each management record must have a subtype");
-		goto out;
-	}
+	if (JSTREAM_OBJECT != tok)
+		return unexpected(l, tok, "Area object");
+
+	while (JSTREAM_KEY == (tok = jstream_next(&l->js))) {
+		const char * key = l->js.str;
+		fru_field_t * field = NULL;
+		int64_t val;
+		size_t i;
+
+		for (i = 0; i < field_max[atype]; i++) {
+			if (!strcmp(key, field_name[atype][i].json)) {
+				field = fru_getfield(fru, atype, i);
+				break;
+			}
+		}
+		/* Older templates (and example.json) use 'ver' */
+		if (FRU_PRODUCT_INFO == atype && !strcmp(key, "ver"))
+			field = fru_getfield(fru, atype, FRU_PROD_VERSION);
+
+		if (field) {
+			if (!load_field(l, jstream_next(&l->js), field)) {
+				jswarn(l, "Failed to parse or add field '%s'", key);
+				return false;
+			}
+			debug(2, "Field '%s' = '%s' (%s) loaded from JSON",
+			      key, field->val, frugen_enc_name_by_val(field->enc));
+			continue;
+		}
+
+		if (!strcmp(key, "custom")) {
+			if (!load_custom_list(l, atype))
+				return false;
+			continue;
+		}
+
+		tok = jstream_next(&l->js);
+		if (!jstream_is_scalar(tok)) {
+			debug(2, "Non-scalar field '%s' in '%s', skipping",
+			      key, area_names[atype].json);
+			if (!jstream_skip(&l->js, tok))
+				return unexpected(l, JSTREAM_ERROR, NULL);
+			continue;
+		}
 
-	debug(3, "Management record subtype is '%s'", subtype);
-	subtype_id = frugen_mr_mgmt_type_by_name(subtype);
-	if (!FRU_MR_MGMT_IS_SUBTYPE_VALID(subtype_id))
-		goto out;
+		if (FRU_CHASSIS_INFO == atype && !strcmp(key, "type")) {
+			if (!scalar_int(tok, l->js.str, &val)) {
+				warn("chassis.type is not an integer, zeroed");
+				val = 0;
+			}
+			fru->chassis.type = val;
+			debug(2, "Chassis type 0x%02X loaded from JSON", fru->chassis.type);
+		}
+		else if (FRU_ATYPE_HAS_LANG(atype) && !strcmp(key, "lang")) {
+			fru_lang_t * lang = (FRU_BOARD_INFO == atype)
+			                    ? &fru->board.lang
+			                    : &fru->product.lang;
+
+			if (!scalar_int(tok, l->js.str, &val)) {
+				warn("%s.lang is not an integer, using English",
+				     area_names[atype].json);
+				val = FRU_LANG_ENGLISH;
+			}
+			*lang = val;
+			debug(2, "%s language %d loaded from JSON",
+			      area_names[atype].human, *lang);
+		}
+		else if (FRU_BOARD_INFO == atype && !strcmp(key, "date")) {
+			const char * s = scalar_str(tok, l->js.str);
 
-	debug(3, "Management record subtype ID is '%d'", subtype_id);
+			if (s && !strcmp(s, "auto")) {
+				fru->board.tv_auto = true;
+			}
+			else if (!s || !datestr_to_tv(&fru->board.tv, s)) {
+				jswarn(l, "Invalid board date/time format");
+				return false;
+			}
+			else {
+				fru->board.tv_auto = false;
+			}
+			debug(2, "Board date '%s' loaded from JSON", s);
+		}
+		else {
+			debug(2, "Unknown field '%s' in '%s', skipping",
+			      key, area_names[atype].json);
+		}
+	}
 
-	fru_mr_rec_t mr_rec = {};
+	if (JSTREAM_OBJECT_END != tok)
+		return unexpected(l, tok, "Member name");
 
-	mr_rec.type = FRU_MR_MGMT_ACCESS;
-	mr_rec.mgmt.subtype = subtype_id;
+	return true;
+}
 
-	json_object_object_get_ex(item, subtype, &ifield);
-	if (!ifield) {
-		warn("Field '%s' not found for record data", subtype);
-		goto out;
+static
+const member_t * get_member(const member_t * members, size_t count,
+                            const char * key)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (!strcmp(members[i].key, key))
+			return &members[i];
 	}
+	return NULL;
+}
 
-	const char * field_data = json_object_get_string(ifield);
-	if (!field_data) {
-		warn("Field '%s' is not a string for MR record", subtype);
-		goto out;
+/*
+ * Add a record, or replace a management record of the same subtype
+ * when merging a manifest line into a template
+ */
+static
+bool add_mr_record(loader_t * l, fru_mr_rec_t * mr_rec)
+{
+	fru_mr_rec_t * old;
+	size_t index = FRU_LIST_HEAD;
+
+	if (l->merge && FRU_MR_MGMT_ACCESS == mr_rec->type) {
+		while ((old = fru_find_mr(l->fru, FRU_MR_MGMT_ACCESS, &index))) {
+			if (old->mgmt.subtype == mr_rec->mgmt.subtype)
+				return fru_replace_mr(l->fru, index, mr_rec);
+			index++;
+		}
 	}
-	strncpy(mr_rec.mgmt.data,
-	        field_data,
-	        FRU_MIN(sizeof(mr_rec.mgmt.data) - 1,
-	                strlen(field_data)
-	        )
-	);
 
 	/* Always add to the tail, one by one, sparse addition is not supported */
-	if (!fru_add_mr(fru, FRU_LIST_TAIL, &mr_rec)) {
-		fru_warn("Failed to add MR management record");
-		goto out;
+	return !!fru_add_mr(l->fru, FRU_LIST_TAIL, mr_rec);
+}
+
+static
+bool load_mr_mgmt_record(loader_t * l, const member_t * m, size_t count)
+{
+	const member_t * subtype = get_member(m, count, "subtype");
+	const member_t * data;
+	fru_mr_rec_t mr_rec = { .type = FRU_MR_MGMT_ACCESS };
+
+	if (!subtype || JSTREAM_STRING != subtype->tok) {
+		jswarn(l, "Each management record must have a subtype");
+		return false;
+	}
+
+	debug(3, "Management record subtype is '%s'", subtype->str);
+	mr_rec.mgmt.subtype = frugen_mr_mgmt_type_by_name(subtype->str);
+	if (!FRU_MR_MGMT_IS_SUBTYPE_VALID(mr_rec.mgmt.subtype))
+		return false;
+
+	data = get_member(m, count, subtype->str);
+	if (data && JSTREAM_BYTES == data->tok) {
+		if (!member_hex(data, mr_rec.mgmt.data, sizeof(mr_rec.mgmt.data))) {
+			jswarn(l, "Field '%s' is too long", subtype->str);
+			return false;
+		}
+	}
+	else if (!data || !scalar_str(data->tok, data->str)) {
+		jswarn(l, "Field '%s' not found for record data", subtype->str);
+		return false;
+	}
+	else {
+		strncpy(mr_rec.mgmt.data, scalar_str(data->tok, data->str),
+		        sizeof(mr_rec.mgmt.data) - 1);
 	}
 
-	rc = true;
+	if (!add_mr_record(l, &mr_rec)) {
+		fru_warn("Failed to add MR management record");
+		return false;
+	}
 
-out:
-	return rc;
+	return true;
 }
 
 static
-bool load_mr_raw_record(fru_t * fru,
-                        json_object * item)
+bool load_mr_raw_record(loader_t * l, const member_t * m, size_t count)
 {
-	json_object *ifield;
-	bool rc = false;
+	const member_t * type = get_member(m, count, "custom_type");
+	const member_t * data = get_member(m, count, "data");
+	fru_mr_rec_t mr_rec = { .type = FRU_MR_RAW };
+	int64_t custom_type;
 
 	debug(1, "Found a custom MR record");
-	int32_t custom_type = FRU_MR_EMPTY;
-	json_object_object_get_ex(item, "custom_type", &ifield);
-	if (!ifield) {
-		warn("Each custom MR record must have "
-		     "a 'custom_type' (0...255)");
-		goto out;
+	if (!type || !scalar_int(type->tok, type->str, &custom_type)) {
+		jswarn(l, "Each custom MR record must have a 'custom_type' (0...255)");
+		return false;
 	}
 
-	custom_type = json_object_get_int(ifield);
 	if (!FRU_MR_IS_VALID_TYPE(custom_type)) {
-		warn("Custom type %" PRIi32 " for record "
-		     "is out of range (0...255)",
-		     custom_type);
-		goto out;
+		jswarn(l, "Custom type %" PRIi64 " for record is out of range (0...255)",
+		       custom_type);
+		return false;
 	}
+	mr_rec.raw.type = custom_type;
 
-	const char *hexstr = NULL;
-	json_object_object_get_ex(item, "data", &ifield);
-	hexstr = json_object_get_string(ifield);
-	if (!ifield || !hexstr) {
-		warn("A custom MR record must have 'data' "
-		     "field with a hex string");
+	if (!data || !member_hex(data, mr_rec.raw.data, sizeof(mr_rec.raw.data))) {
+		jswarn(l, "A custom MR record must have 'data' field with a hex string"
+		          " of up to %zu bytes", (sizeof(mr_rec.raw.data) - 1) / 2);
+		return false;
 	}
 
-	fru_mr_rec_t mr_rec = {
-		.type = FRU_MR_RAW,
-		.raw.type = custom_type,
-	};
-
-	strncpy(mr_rec.raw.data,
-		hexstr,
-		FRU_MIN(sizeof(mr_rec.raw.data) - 1,
-			strlen(hexstr)
-		)
-	);
-
-	/* Always add to the tail, one by one, sparse addition is not supported */
-	if (!fru_add_mr(fru, FRU_LIST_TAIL, &mr_rec)) {
+	if (!add_mr_record(l, &mr_rec)) {
 		fru_warn("Failed to add a custom MR record");
-		goto out;
+		return false;
 	}
 
-	debug(2, "Custom MR data loaded from JSON: %s", hexstr);
-	rc = true;
-out:
-	return rc;
+	debug(2, "Custom MR data loaded from JSON: %s", mr_rec.raw.data);
+	return true;
 }
 
+/*
+ * Load any typed MR record that consists of numeric fields only.
+ * Missing fields are set to zero/false.
+ */
 static
-bool load_mr_record(fru_t * fru,
-                    struct json_object * item)
+bool load_mr_typed_record(loader_t * l, const member_t * m, size_t count,
+                          const frugen_mr_typed_t * typed)
 {
-	bool rc = false;
-
-	const char *type = NULL;
-	json_object *ifield;
-
-	json_object_object_get_ex(item, "type", &ifield);
-	if (!ifield || !(type = json_object_get_string(ifield))) {
-		warn("Each multirecord area record must have a type specifier");
-		goto out;
-	}
-
-	struct recloader {
-		const char * const typename;
-		bool (*func)(fru_t *, struct json_object *);
-	} record_loader[] = {
-		{ "management", load_mr_mgmt_record },
-//		{ "psu", load_mr_psu_record }, // TODO: Not supported yet
-		{ "custom", load_mr_raw_record },
-	};
-
-	debug(3, "Record is of type '%s'", type);
-	size_t i = 0;
-	for (; i < FRU_ARRAY_SZ(record_loader); i++) {
-		if (!strcmp(type, record_loader[i].typename)) {
-			if (!record_loader[i].func(fru, item))
-				goto out;
-			else
-				break;
+	fru_mr_rec_t mr_rec = { .type = typed->type };
+
+	for (size_t i = 0; i < typed->count; i++) {
+		const frugen_mr_field_t * f = &typed->fields[i];
+		const member_t * member = get_member(m, count, f->name.json);
+		int64_t val;
+
+		if (!member) {
+			debug(2, "Field '%s' not found for '%s' record, assuming 0",
+			      f->name.json, typed->name.json);
+			continue;
+		}
+
+		switch (f->kind) {
+		case FRUGEN_MRF_HEX:
+			if (!member_hex(member, (char *)&mr_rec + f->offset, f->size)) {
+				jswarn(l, "Field '%s' of '%s' record is not a string or is too long",
+				       f->name.json, typed->name.json);
+				return false;
+			}
+			continue;
+		case FRUGEN_MRF_BOOL:
+		case FRUGEN_MRF_FLAG:
+			val = scalar_bool(member->tok, member->str);
+			break;
+		default:
+			if (JSTREAM_NUMBER != member->tok
+			    || !scalar_int(member->tok, member->str, &val))
+			{
+				jswarn(l, "Field '%s' of '%s' record is not an integer",
+				       f->name.json, typed->name.json);
+				return false;
+			}
+			break;
+		}
+
+		if (!frugen_mr_field_set(&mr_rec, f, val)) {
+			jswarn(l, "Value %" PRIi64 " is out of range for field '%s' of '%s' record",
+			       val, f->name.json, typed->name.json);
+			return false;
 		}
 	}
 
-	if (i == FRU_ARRAY_SZ(record_loader)) {
-		warn("Multirecord type '%s' is not supported in JSON", type);
-		goto out;
+	if (!add_mr_record(l, &mr_rec)) {
+		fru_warn("Failed to add MR '%s' record", typed->name.json);
+		return false;
 	}
 
-	rc = true;
-out:
-	return rc;
+	return true;
 }
 
+/*
+ * Collect the scalar members of a record object, then load it
+ */
 static
-bool load_mr_area(fru_t * fru, json_object * jso)
+bool load_mr_record(loader_t * l, jstream_tok_t tok)
 {
-	(void)fru;
-	bool rc = false;
+	member_t members[MR_MAX_MEMBERS];
+	const member_t * type;
+	const frugen_mr_typed_t * typed;
+	size_t count = 0;
 
-	if (json_object_get_type(jso) != json_type_array) {
-		warn("'multirec' object is not an array");
-		goto out;
-	}
+	if (JSTREAM_OBJECT != tok)
+		return unexpected(l, tok, "Record object");
 
-	size_t alen = json_object_array_length(jso);
-	if (!alen) {
-		debug(1, "Multirecord area is an empty list");
-		goto out;
-	}
+	while (JSTREAM_KEY == (tok = jstream_next(&l->js))) {
+		member_t * m = &members[count];
 
-	for (size_t i = 0; i < alen; i++) {
-		json_object *item;
+		if (count == MR_MAX_MEMBERS) {
+			jswarn(l, "Too many members in a record");
+			return false;
+		}
 
-		item = json_object_array_get_idx(jso, i);
-		if (!item)
+		m->key = l->js.str;
+		m->tok = jstream_next(&l->js);
+		if (!jstream_is_scalar(m->tok)) {
+			debug(2, "Non-scalar member '%s' of a record, skipping", m->key);
+			if (!jstream_skip(&l->js, m->tok))
+				return unexpected(l, JSTREAM_ERROR, NULL);
 			continue;
+		}
 
-		debug(3, "Parsing record #%zu/%zu", LIST_INDEX_FRUGEN(i), alen);
-		if (!load_mr_record(fru, item)) {
-			warn("Failed to load MR record #%zu from JSON", LIST_INDEX_FRUGEN(i));
-			goto out;
+		m->str = l->js.str;
+		m->len = l->js.len;
+		if (JSTREAM_NUMBER == m->tok) {
+			/* Numbers live in the tokenizer, keep a copy */
+			if (l->js.len >= sizeof(m->num)) {
+				jswarn(l, "Number '%s' is too long", l->js.str);
+				return false;
+			}
+			strcpy(m->num, l->js.str);
+			m->str = m->num;
 		}
+		count++;
 	}
 
-	rc = true;
-
-out:
-	return rc;
-}
+	if (JSTREAM_OBJECT_END != tok)
+		return unexpected(l, tok, "Member name");
 
-static
-bool load_info_area(fru_t * fru,
-                             fru_area_type_t atype,
-                             json_object * jso)
-{
-	if (!load_info_fields(fru, atype, jso)) {
-		warn("Couldn't load standard or custom fields for %s",
-		      area_names[atype].human);
+	type = get_member(members, count, "type");
+	if (!type || JSTREAM_STRING != type->tok) {
+		jswarn(l, "Each multirecord area record must have a type specifier");
 		return false;
 	}
 
-	json_object * jsfield;
-	if (FRU_CHASSIS_INFO == atype) {
-		json_object_object_get_ex(jso, "type", &jsfield);
-		if (jsfield) {
-			errno = 0;
-			fru->chassis.type = json_object_get_int(jsfield);
-			if (errno)
-				warn("chassis.type is not an integer, zeroed");
+	debug(3, "Record is of type '%s'", type->str);
 
-			debug(2, "Chassis type 0x%02X loaded from JSON",
-			      fru->chassis.type);
-		}
-	}
-	else if(FRU_BOARD_INFO == atype || FRU_PRODUCT_INFO == atype) {
-		json_object_object_get_ex(jso, "lang", &jsfield);
-		if (jsfield) {
-			errno = 0;
-			fru->board.lang = json_object_get_int(jsfield);
-			if (errno) {
-				warn("board.lang is not an integer, using English");
-				fru->board.lang = FRU_LANG_ENGLISH;
-			}
+	/* PSU, DC output/load and NVMe records are described by frugen.c tables */
+	typed = frugen_mr_typed_by_name(type->str);
+	if (typed)
+		return load_mr_typed_record(l, members, count, typed);
 
-			debug(2, "Board language %d loaded from JSON",
-			      fru->board.lang);
-		}
+	if (!strcmp(type->str, "management"))
+		return load_mr_mgmt_record(l, members, count);
 
-		if (FRU_BOARD_INFO == atype) {
-			json_object_object_get_ex(jso, "date", &jsfield);
-			if (jsfield) {
-				const char *s = json_object_get_string(jsfield);
-				// get_string doesn't return any errors
+	if (!strcmp(type->str, "custom"))
+		return load_mr_raw_record(l, members, count);
 
-				if (!strcmp(s, "auto")) {
-					fru->board.tv_auto = true;
-				}
+	jswarn(l, "Multirecord type '%s' is not supported in JSON", type->str);
+	return false;
+}
 
-				if (!datestr_to_tv(&fru->board.tv, s)) {
-					warn("Invalid board date/time format in JSON file");
-					return false;
-				}
+static
+bool load_mr_area(loader_t * l)
+{
+	jstream_tok_t tok = jstream_next(&l->js);
+	size_t i;
 
-				fru->present[FRU_BOARD_INFO] = true;
-				fru->board.tv_auto = false;
+	if (JSTREAM_ARRAY != tok) {
+		jswarn(l, "'multirecord' object is not an array");
+		return false;
+	}
 
-				debug(2, "Board date '%s' loaded from JSON", s);
-			}
+	for (i = 0; JSTREAM_ARRAY_END != (tok = jstream_next(&l->js)); i++) {
+		debug(3, "Parsing record #%zu", LIST_INDEX_FRUGEN(i));
+		if (!load_mr_record(l, tok)) {
+			jswarn(l, "Failed to load MR record #%zu", LIST_INDEX_FRUGEN(i));
+			return false;
 		}
 	}
+
+	if (!i)
+		debug(1, "Multirecord area is an empty list");
+
 	return true;
 }
 
-void frugen_loadfile_json(fru_t * fru, const char * fname)
+/*
+ * Load a whole FRU object from the token stream
+ */
+static
+bool load_fru(loader_t * l)
 {
-	bool success = false;
-	json_object *jstree;
+	jstream_tok_t tok = jstream_next(&l->js);
+	fru_t * fru = l->fru;
+	bool seen[FRU_TOTAL_AREAS] = {};
+	bool was_present[FRU_TOTAL_AREAS];
+	fru_area_type_t atype;
 
-	debug(2, "Loading JSON from %s", fname);
-	/* Allocate a new object and load contents from file */
-	jstree = json_object_from_file(fname);
-	if (NULL == jstree)
-		fatal("Failed to load JSON FRU object from %s", fname);
+	if (JSTREAM_OBJECT != tok)
+		return unexpected(l, tok, "FRU object");
 
-	fru_area_type_t atype;
-	FRU_FOREACH_AREA(atype) {
-		json_object * jso;
-		if (!json_object_object_get_ex(jstree, area_names[atype].json, &jso)) {
-			debug(2, "%s Area ('%s') is not found in JSON",
-			      area_names[atype].human, area_names[atype].json);
+	memcpy(was_present, fru->present, sizeof(was_present));
+
+	while (JSTREAM_KEY == (tok = jstream_next(&l->js))) {
+		const char * key = l->js.str;
+
+		FRU_FOREACH_AREA(atype) {
+			if (!strcmp(key, area_names[atype].json))
+				break;
+		}
+
+		if (!FRU_IS_VALID_AREA(atype)) {
+			debug(2, "Unknown area '%s', skipping", key);
+			if (!jstream_skip(&l->js, jstream_next(&l->js)))
+				return unexpected(l, JSTREAM_ERROR, NULL);
 			continue;
 		}
 
-		// Add an area to the end of FRU file, that way we ensure
-		// that areas in the output are in the same order as in the input JSON`
-		fru_enable_area(fru, atype, FRU_APOS_LAST);
 		debug(2, "Found %s Area in input template", area_names[atype].human);
+		seen[atype] = true;
+		// Don't care about errors. The area is either enabled now or was enabled before.
+		fru_enable_area(fru, atype, FRU_APOS_LAST);
 
 		/* Intenal Use area needs special handling */
 		if (FRU_INTERNAL_USE == atype) {
-			const char *data = json_object_get_string(jso);
-			if (!data) {
-				debug(2, "Internal use are w/o data, skipping");
+			const char * data;
+			bool loaded;
+
+			tok = jstream_next(&l->js);
+			if (!jstream_is_scalar(tok))
+				return unexpected(l, tok, "Hex string");
+
+			data = scalar_str(tok, l->js.str);
+			if (JSTREAM_BYTES == tok) {
+				loaded = fru_set_internal_binary(fru, l->js.str, l->js.len);
+			}
+			else if (data) {
+				loaded = fru_set_internal_hexstring(fru, data);
+			}
+			else {
+				debug(2, "Internal use area w/o data, skipping");
 				continue;
 			}
 
-			if (!fru_set_internal_hexstring(fru, data)) {
+			if (!loaded) {
 				fru_warn("Failed to load internal use area");
-				goto out;
+				return false;
 			}
-
-			goto nextloop;
 		}
-
-		if (FRU_IS_INFO_AREA(atype)) {
-			if (!load_info_area(fru, atype, jso)) {
-				warn("Incorrect definition of %s Area in input json",
-				     area_names[atype].human);
-				goto out;
+		else if (FRU_IS_INFO_AREA(atype)) {
+			if (!load_info_area(l, atype)) {
+				jswarn(l, "Incorrect definition of %s Area",
+				       area_names[atype].human);
+				return false;
 			}
-
-			goto nextloop;
 		}
-
-		/* Here it can only be FRU_MR */
-		debug(2, "Processing multirecord area records");
-		if (!load_mr_area(fru, jso))
-			goto out;
-
-		if (!fru->mr) {
-			fru_disable_area(fru, FRU_MR);
-			warn("Disabled an empty %s Area", area_names[atype].human);
+		else if (!load_mr_area(l)) {
+			return false;
 		}
 
-	nextloop:
 		debug(2, "%s Area loaded from JSON", area_names[atype].human);
 	}
 
-	success = true;
-out:
-	
-	if (!success) {
-		if (FRU_IS_VALID_AREA(atype))
-			fatal("Failed to load %s Area", area_names[atype].human);
-		else
-			fatal("Failed to load FRU from JSON file");
+	if (JSTREAM_OBJECT_END != tok)
+		return unexpected(l, tok, "Area name");
+
+	tok = jstream_next(&l->js);
+	if (JSTREAM_END != tok)
+		return unexpected(l, tok, "End of input");
+
+	/*
+	 * The newly found areas go last in the standard order,
+	 * no matter how they are ordered in JSON
+	 */
+	FRU_FOREACH_AREA(atype) {
+		if (seen[atype] && !was_present[atype])
+			fru_move_area(fru, atype, FRU_APOS_LAST);
 	}
-	/* Deallocate the JSON object */
-	json_object_put(jstree);
+
+	if (seen[FRU_MR] && !fru->mr) {
+		fru_disable_area(fru, FRU_MR);
+		warn("Disabled an empty %s Area", area_names[FRU_MR].human);
+	}
+
+	return true;
+}
+
+/*
+ * Read the whole file into memory, '-' means stdin
+ */
+static
+char * read_file(const char * fname, size_t * len)
+{
+	FILE * fp = strcmp(fname, "-") ? fopen(fname, "r") : stdin;
+	size_t size = 0;
+	char * buf = NULL;
+
+	if (!fp)
+		return NULL;
+
+	*len = 0;
+	do {
+		char * p;
+
+		if (*len == size) {
+			size = size ? size * 2 : 16 * 1024;
+			p = realloc(buf, size);
+			if (!p) {
+				free(buf);
+				buf = NULL;
+				break;
+			}
+			buf = p;
+		}
+		*len += fread(buf + *len, 1, size - *len, fp);
+	} while (!feof(fp) && !ferror(fp));
+
+	if (buf && ferror(fp))
+		zfree(buf);
+	if (fp != stdin)
+		fclose(fp);
+
+	return buf;
+}
+
+void frugen_loadfile_json(fru_t * fru, const char * fname)
+{
+	loader_t l = { .fru = fru, .name = fname };
+	size_t len;
+	char * buf;
+
+	debug(2, "Loading JSON from %s", fname);
+	buf = read_file(fname, &len);
+	if (!buf)
+		fatal("Failed to read JSON FRU object from %s: %m", fname);
+
+	jstream_init(&l.js, buf, len);
+	if (!load_fru(&l))
+		fatal("Failed to load FRU from JSON file %s", fname);
+
+	free(buf);
 }
 
+// See frugen-json.h
+void frugen_loadfile_cbor(fru_t * fru, const char * fname)
+{
+	loader_t l = { .fru = fru, .name = fname };
+	size_t len;
+	char * buf;
+
+	debug(2, "Loading CBOR from %s", fname);
+	buf = read_file(fname, &len);
+	if (!buf)
+		fatal("Failed to read CBOR FRU object from %s: %m", fname);
+
+	jstream_init_cbor(&l.js, buf, len);
+	if (!load_fru(&l))
+		fatal("Failed to load FRU from CBOR file %s", fname);
+
+	free(buf);
+}
 
-void add_iu_area_json(struct json_object * jso,
-                      const char * internal)
+struct frugen_manifest_s {
+	FILE * fp;
+	const char * name;
+	char * line;
+	size_t size;
+	size_t lineno;
+};
+
+// See frugen-json.h
+frugen_manifest_t * frugen_manifest_open(const char * fname)
 {
-	assert(internal);
+	frugen_manifest_t * m = calloc(1, sizeof(*m));
+
+	if (!m)
+		fatal("Out of memory");
+
+	m->name = fname;
+	m->fp = strcmp(fname, "-") ? fopen(fname, "r") : stdin;
+	if (!m->fp)
+		fatal("Failed to open manifest %s: %m", fname);
 
-	struct json_object *section = json_object_new_string(internal);
-	json_object_object_add(jso, "internal", section);
+	return m;
 }
 
+// See frugen-json.h
+bool frugen_manifest_apply(frugen_manifest_t * m, fru_t * fru)
+{
+	loader_t l = { .fru = fru, .name = m->name, .merge = true };
+	ssize_t len;
+
+	do {
+		len = getline(&m->line, &m->size, m->fp);
+		if (len < 0) {
+			if (ferror(m->fp))
+				fatal("Failed to read manifest %s: %m", m->name);
+			return false;
+		}
+		m->lineno++;
+		/* Skip blank lines */
+	} while (strspn(m->line, " \t\r\n") == (size_t)len);
+
+	l.line = m->lineno;
+	jstream_init(&l.js, m->line, len);
+	if (!load_fru(&l))
+		fatal("Failed to apply line %zu of manifest %s", m->lineno, m->name);
+
+	return true;
+}
+
+// See frugen-json.h
+void frugen_manifest_close(frugen_manifest_t * m)
+{
+	if (m->fp != stdin)
+		fclose(m->fp);
+	free(m->line);
+	free(m);
+}
+
+/*
+ * The writer below emits JSON text directly from fru_t, with
+ * the same layout as the json-c based writer of earlier versions
+ * had, so the existing consumers of frugen output aren't affected.
+ * The very same schema is used for CBOR, where binary data are
+ * byte strings instead of hex strings.
+ */
+
 static
-bool add_info_field(struct json_object * jso,
-                    const char * key,
-                    const fru_field_t * field)
+void add_iu_area_json(jsout_t * jo, const fru_t * fru)
 {
-	struct json_object *string, *type_string, *entry;
-	if ((string = json_object_new_string(field->val)) == NULL)
-		goto STRING_ERR;
+	size_t size = 0;
+	const void * internal = fru_get_internal_binary(fru, &size);
+	if (!internal && FENODATA != fru_errno.code) {
+		fru_warn("Failed to get internal use area data");
+		return;
+	}
+
+	jsout_key(jo, "internal");
+	jsout_bytes(jo, internal, size);
+}
+
+/*
+ * Write a field as a plain string for auto encoding, or as an object
+ * with the explicit encoding. Without a key, the field is written as
+ * an array element, that is used for custom fields.
+ */
+static
+void add_info_field(jsout_t * jo, const char * key, const fru_field_t * field)
+{
+	if (key)
+		jsout_key(jo, key);
 
 	if (field->enc == FRU_FE_AUTO) {
-		entry = string;
-	} else {
-		const char *enc_name = frugen_enc_name_by_val(field->enc);
-		if ((type_string = json_object_new_string(enc_name)) == NULL)
-			goto TYPE_STRING_ERR;
-		if ((entry = json_object_new_object()) == NULL)
-			goto ENTRY_ERR;
-		json_object_object_add(entry, "type", type_string);
-		json_object_object_add(entry, "data", string);
-	}
-	if (key == NULL) {
-		/* No key, make jso an array, used for multirecord */
-		json_object_array_add(jso, entry);
-	} else {
-		/* Key is specified, add a named string or object */
-		json_object_object_add(jso, key, entry);
+		jsout_string(jo, field->val);
+		return;
 	}
-	return true;
 
-ENTRY_ERR:
-	json_object_put(type_string);
-TYPE_STRING_ERR:
-	json_object_put(string);
-STRING_ERR:
-	return false;
+	jsout_object(jo);
+	jsout_key(jo, "type");
+	jsout_string(jo, frugen_enc_name_by_val(field->enc));
+	jsout_key(jo, "data");
+	if (FRU_FE_BINARY == field->enc)
+		jsout_hex(jo, field->val);
+	else
+		jsout_string(jo, field->val);
+	jsout_object_end(jo);
 }
 
-
-void add_info_area_json(struct json_object * jso,
-                        fru_area_type_t atype,
-                        const fru_t * fru)
+static
+void add_info_area_json(jsout_t * jo, fru_area_type_t atype, const fru_t * fru)
 {
 	assert(fru);
-	assert(jso);
-
-	struct json_object * section = json_object_new_object();
+	assert(jo);
 
 	const fru_field_t * field = NULL;
 	const char * const aname = area_names[atype].json;
-
-	/* Add area-specific fields */
-	struct json_object * tmp_obj = json_object_new_object();
-	if (FRU_ATYPE_HAS_TYPE(atype)) {
-		tmp_obj = json_object_new_int(fru->chassis.type);
-		json_object_object_add(section, "type", tmp_obj);
-	}
-	else if (FRU_ATYPE_HAS_LANG(atype)) {
-		section = json_object_new_object();
-		tmp_obj = json_object_new_int(fru->product.lang);
-		json_object_object_add(section, "lang", tmp_obj);
-	}
+	/* Auto encoding ensures the date is saved as a plain string */
+	fru_field_t datefield = { .enc = FRU_FE_AUTO };
 
 	if (atype == FRU_BOARD_INFO) {
-		/* Board has a date field */
-		struct timeval tv = fru->board.tv;
-		// Auto encoding ensures it's saved as a plain string
-		fru_field_t datefield = { .enc = FRU_FE_AUTO };
-
 		if (fru->board.tv_auto) {
 			strcpy(datefield.val, "auto");
 		}
 		else {
 			// Don't save local timezone in JSON
-			tv_to_datestr(datefield.val, &tv, false);
-		}
-		// Skip writing out the 'date' field if board date is unspecified
-		if (datefield.val[0]) {
-			section = json_object_new_object();
-			add_info_field(section, "date", &datefield);
+			tv_to_datestr(datefield.val, &fru->board.tv, false);
 		}
 	}
 
+	jsout_key(jo, aname);
+	jsout_object(jo);
+
+	/* Add area-specific fields */
+	if (FRU_ATYPE_HAS_TYPE(atype)) {
+		jsout_key(jo, "type");
+		jsout_int(jo, fru->chassis.type);
+	}
+	else if (FRU_ATYPE_HAS_LANG(atype) && jo->cbor) {
+		/* CBOR has no legacy consumers, so it gets it right */
+		jsout_key(jo, "lang");
+		jsout_int(jo, atype == FRU_BOARD_INFO ? fru->board.lang
+		                                      : fru->product.lang);
+	}
+	else if (FRU_ATYPE_HAS_LANG(atype) && !datefield.val[0]) {
+		/*
+		 * Earlier versions always saved the product language here,
+		 * and omitted it for the board if the date was written.
+		 * Keep it that way for the output to stay the same.
+		 */
+		jsout_key(jo, "lang");
+		jsout_int(jo, fru->product.lang);
+	}
+
+	// Skip writing out the 'date' field if board date is unspecified
+	if (datefield.val[0])
+		add_info_field(jo, "date", &datefield);
+
 	/* Add standard fields */
 	for (size_t i = 0; i < field_max[atype]; i++) {
 		const char * const name = field_name[atype][i].json;
@@ -625,63 +975,71 @@ void add_info_area_json(struct json_object * jso,
 		if (!field)
 			fru_fatal("Failed to get standard field '%s' from '%s'", name, aname);
 
-		if (!add_info_field(section, name, field))
-			fatal("Failed to add field %s.%s to JSON", aname, name);
+		add_info_field(jo, name, field);
 		debug(2, "Added %s.%s to JSON", aname, name);
 	}
 
-	/* Add custom fields */
-	struct json_object * custom_array = json_object_new_array();
+	/* Add custom fields, omit the list if it's empty */
 	size_t idx = FRU_LIST_HEAD;
 	while ((field = fru_get_custom(fru, atype, idx))) {
-		if (!add_info_field(custom_array, NULL, field))
-			fatal("Failed to add field %s.custom.%zu to JSON", aname, idx);
-
+		if (idx == FRU_LIST_HEAD) {
+			jsout_key(jo, "custom");
+			jsout_array(jo);
+		}
+		add_info_field(jo, NULL, field);
 		debug(2, "Added %s.custom.%zu to JSON", aname, idx);
 		idx++;
 	}
 	if (fru_errno.code != FENOFIELD)
 		fru_fatal("Failed to get custom fields");
+	if (idx != FRU_LIST_HEAD)
+		jsout_array_end(jo);
 
-	if (idx == FRU_LIST_HEAD) {
-		/* The list is empty, don't add it */
-		json_object_put(custom_array);
-	}
-	else {
-		json_object_object_add(section, "custom", custom_array);
-	}
-
-	json_object_object_add(jso, aname, section);
+	jsout_object_end(jo);
 }
 
-void add_mr_record_json(struct json_object * jsa, fru_mr_rec_t * rec)
+static
+void add_mr_record_json(jsout_t * jo, fru_mr_rec_t * rec)
 {
-	struct json_object * js_rec = json_object_new_object();
-
-	if (!js_rec)
-		fatal("Failed to create a new JSON object for MR record");
+	jsout_object(jo);
 
 	if (rec->type == FRU_MR_MGMT_ACCESS) {
 		fru_mr_mgmt_type_t subtype = rec->mgmt.subtype;
-		struct json_object * jsfield = NULL;
 		off_t idx = FRU_MR_MGMT_SUBTYPE_TO_IDX(subtype);
 		const char * recname = NULL;
 
-		if (idx < 0) {
-			json_object_put(js_rec);
+		if (idx < 0)
 			fatal("Invalid management access record subtype %d", subtype);
-		}
 
 		recname = frugen_mr_mgmt_name[idx].json;
 
-		jsfield = json_object_new_string("management");
-		json_object_object_add(js_rec, "type", jsfield);
+		jsout_key(jo, "type");
+		jsout_string(jo, "management");
+		jsout_key(jo, "subtype");
+		jsout_string(jo, recname);
+		jsout_key(jo, recname);
+		if (FRU_MR_MGMT_SYS_UUID == subtype)
+			jsout_hex(jo, rec->mgmt.data);
+		else
+			jsout_string(jo, rec->mgmt.data);
+	}
+	else if (frugen_mr_typed_by_type(rec->type)) {
+		const frugen_mr_typed_t * typed = frugen_mr_typed_by_type(rec->type);
+
+		jsout_key(jo, "type");
+		jsout_string(jo, typed->name.json);
 
-		jsfield = json_object_new_string(recname);
-		json_object_object_add(js_rec, "subtype", jsfield);
+		for (size_t i = 0; i < typed->count; i++) {
+			const frugen_mr_field_t * f = &typed->fields[i];
 
-		jsfield = json_object_new_string(rec->mgmt.data);
-		json_object_object_add(js_rec, recname, jsfield);
+			jsout_key(jo, f->name.json);
+			if (FRUGEN_MRF_HEX == f->kind)
+				jsout_hex(jo, (const char *)rec + f->offset);
+			else if (FRUGEN_MRF_BOOL == f->kind || FRUGEN_MRF_FLAG == f->kind)
+				jsout_bool(jo, frugen_mr_field_get(rec, f));
+			else
+				jsout_int(jo, frugen_mr_field_get(rec, f));
+		}
 	}
 /* TODO: Add more MR types
 	else if (rec->type = ... ) {
@@ -689,43 +1047,39 @@ void add_mr_record_json(struct json_object * jsa, fru_mr_rec_t * rec)
 	}
 */
 	else if (rec->type == FRU_MR_RAW) {
-		uint8_t raw_type = rec->raw.type;
-		struct json_object * jsfield = NULL;
-
-		jsfield = json_object_new_string("custom");
-		json_object_object_add(js_rec, "type", jsfield);
-
-		jsfield = json_object_new_int(raw_type);
-		json_object_object_add(js_rec, "custom_type", jsfield);
-
-		jsfield = json_object_new_string(rec->raw.data);
-		json_object_object_add(js_rec, "data", jsfield);
+		jsout_key(jo, "type");
+		jsout_string(jo, "custom");
+		jsout_key(jo, "custom_type");
+		jsout_int(jo, rec->raw.type);
+		jsout_key(jo, "data");
+		jsout_hex(jo, rec->raw.data);
 	}
 
-	json_object_array_add(jsa, js_rec);
+	jsout_object_end(jo);
 }
 
-void add_mr_area_json(struct json_object * jso,
-                      const fru_t * fru)
+static
+void add_mr_area_json(jsout_t * jo, const fru_t * fru)
 {
-	struct json_object * js_mr = json_object_new_array();
-	if (!js_mr)
-		fatal("Failed to allocate a new JSON array for multirecord area\n");
-
 	/* Add each MR record */
 	fru_mr_rec_t *rec = NULL;
 	size_t count = 0;
 	while (true) {
 		bool last = false;
 		fru_clearerr();
-		rec = fru_get_mr(fru, FRU_LIST_HEAD);
+		rec = fru_get_mr(fru, count);
 		last = (fru_errno.code == FEMREND);
 
 		if (!rec) {
 			break;
 		}
 
-		add_mr_record_json(js_mr, rec);
+		/* Don't add an empty area */
+		if (!count) {
+			jsout_key(jo, "multirecord");
+			jsout_array(jo);
+		}
+		add_mr_record_json(jo, rec);
 		count++;
 
 		if (last)
@@ -733,19 +1087,16 @@ void add_mr_area_json(struct json_object * jso,
 	}
 
 	if (count) {
-		json_object_object_add(jso, "multirecord", js_mr);
+		jsout_array_end(jo);
 		debug(2, "Added multirecord area to JSON");
 	}
-	else {
-		json_object_put(js_mr);
-	}
-
 }
 
+// See frugen-json.h
 void save_to_json_file(FILE **fp, const char *fname,
-                       const fru_t * fru)
+                       const fru_t * fru, jsout_format_t format)
 {
-	struct json_object *json_root = json_object_new_object();
+	jsout_t jo;
 
 	assert(fp);
 	assert(fru);
@@ -758,6 +1109,9 @@ void save_to_json_file(FILE **fp, const char *fname,
 		fatal("Failed to open file '%s' for writing: %m", fname);
 	}
 
+	jsout_init(&jo, *fp, format);
+	jsout_object(&jo);
+
 	/* Write areas out in the requested order */
 	fru_area_type_t order;
 	FRU_FOREACH_AREA(order) {
@@ -769,33 +1123,23 @@ void save_to_json_file(FILE **fp, const char *fname,
 
 		switch (atype) {
 		case FRU_INTERNAL_USE:
-			add_iu_area_json(json_root, fru->internal);
+			add_iu_area_json(&jo, fru);
 			break;
 		case FRU_CHASSIS_INFO:
 		case FRU_BOARD_INFO:
 		case FRU_PRODUCT_INFO:
-			add_info_area_json(json_root, atype, fru);
+			add_info_area_json(&jo, atype, fru);
 			break;
 		case FRU_MR:
-			add_mr_area_json(json_root, fru);
+			add_mr_area_json(&jo, fru);
 			break;
 		default:
 			fatal("Invalid area (%d) in save order!", atype);
 		}
 	}
 
-	/* Write out the json tree to file */
-#ifndef JSON_C_TO_STRING_NOSLASHESCAPE
-#define JSON_C_TO_STRING_NOSLASHESCAPE 0 // Not supported, ignore
-#endif
-
-	json_object_to_fd(fileno(*fp), json_root,
-	                  JSON_C_TO_STRING_PRETTY
-	                  | JSON_C_TO_STRING_SPACED
-	                  | JSON_C_TO_STRING_NOSLASHESCAPE
-	);
-	json_object_put(json_root);
-
-	return;
+	jsout_object_end(&jo);
+	if (!jsout_flush(&jo))
+		fatal("Failed to write %s to '%s': %m",
+		      JSOUT_CBOR == format ? "CBOR" : "JSON", fname);
 }
-
@@ -7,11 +7,48 @@
  *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
  */
 #include "frugen.h"
+#include "frugen-json-stream.h"
 
 /**
  * Load a FRU template from JSON file into a FRU information structure
  */
 void frugen_loadfile_json(fru_t * fru, const char * fname);
 
+/**
+ * Load a FRU template from CBOR file into a FRU information structure.
+ * The schema is the same as for JSON, see save_to_json_file().
+ */
+void frugen_loadfile_cbor(fru_t * fru, const char * fname);
+
+/**
+ * A JSONL manifest: one JSON object per line, in the same format as
+ * a template, with per-unit data to apply on top of a template
+ */
+typedef struct frugen_manifest_s frugen_manifest_t;
+
+/**
+ * Open a manifest file, '-' means stdin. Exits on failures.
+ */
+frugen_manifest_t * frugen_manifest_open(const char * fname);
+
+/**
+ * Apply the next non-blank manifest line to \a fru.
+ *
+ * Fields and the board date from the line replace those in \a fru,
+ * custom fields are appended. MR records are appended too, except
+ * for the management records that replace the ones of the same subtype.
+ * Exits on failures.
+ *
+ * @returns false at the end of the manifest
+ */
+bool frugen_manifest_apply(frugen_manifest_t * m, fru_t * fru);
+
+void frugen_manifest_close(frugen_manifest_t * m);
+
+/**
+ * Save a FRU information structure as JSON, either pretty-printed
+ * or compact, or as CBOR, into the stream \a fp, or into the file
+ * \a fname if \a fp is NULL
+ */
 void save_to_json_file(FILE **fp, const char *fname,
-                       const fru_t * fru);
+                       const fru_t * fru, jsout_format_t format);
@@ -31,6 +31,10 @@
 
 #include "fru_errno.h"
 #include "frugen.h"
+#include "frugen-daemon.h"
+#include "frugen-export.h"
+#include "frugen-fix.h"
+#include "frugen-gen.h"
 #include "smbios.h"
 
 #ifdef __HAS_JSON__
@@ -41,31 +45,81 @@ volatile int debug_level = 0;
 
 /* Options are sorted by .val */
 static const struct option options[] = {
+	/* Write the output to an archive */
+	{ .name = "archive",       .val = 'A', .has_arg = required_argument },
+
+#ifdef __HAS_JSON__
+	/* Set input file format to CBOR */
+	{ .name = "cbor",          .val = 'c', .has_arg = required_argument },
+#endif
+
+	/* Save the output as a compiled template */
+	{ .name = "compile-template", .val = 'C', .has_arg = no_argument },
+
 	/* Set board date */
 	{ .name = "board-date",    .val = 'd', .has_arg = required_argument },
 
+	/* Serve requests on a UNIX socket */
+	{ .name = "daemon",        .val = 'D', .has_arg = required_argument },
+
+	/* Export binary FRU files into a columnar file */
+	{ .name = "export",        .val = 'E', .has_arg = required_argument },
+
+	/* Fix the checksums of binary FRU files in place */
+	{ .name = "fix-checksums", .val = 'F', .has_arg = no_argument },
+
 	/* Set debug flags */
 	{ .name = "debug",         .val = 'g', .has_arg = required_argument },
 
 	/* Display usage help */
 	{ .name = "help",          .val = 'h', .has_arg = optional_argument },
 
+	/* Report all the issues of binary FRU files */
+	{ .name = "diagnose",      .val = 'I', .has_arg = no_argument },
+
 #ifdef __HAS_JSON__
 	/* Set input file format to JSON */
 	{ .name = "json",          .val = 'j', .has_arg = required_argument },
 #endif
 
+	/* Select an archive entry for '-r' */
+	{ .name = "archive-key",   .val = 'k', .has_arg = required_argument },
+
+#ifdef __HAS_JSON__
+	/* Generate a unit per line of a JSONL manifest */
+	{ .name = "manifest",      .val = 'm', .has_arg = required_argument },
+#endif
+
+	/* Generate a number of units */
+	{ .name = "count",         .val = 'n', .has_arg = required_argument },
+
+	/* Extract NVMe drive capacities from many binary FRU files */
+	{ .name = "nvme-scan",     .val = 'N', .has_arg = no_argument },
+
 	/* Set the output data format */
 	{ .name = "out-format",    .val = 'o', .has_arg = required_argument },
 
+	/* Preload a named template for daemon mode */
+	{ .name = "preload",       .val = 'p', .has_arg = required_argument },
+
+	/* Select the source of automatic board dates */
+	{ .name = "date-policy",   .val = 'P', .has_arg = required_argument },
+
 	/* Set input file format to raw binary */
 	{ .name = "raw",          .val = 'r', .has_arg = required_argument },
 
 	/* Set data and optionally type of encoding for a FRU field */
 	{ .name = "set",          .val = 's', .has_arg = required_argument },
 
+	/* Seed the generators PRNG */
+	{ .name = "seed",          .val = 'S', .has_arg = required_argument },
+
 	/* Non-string fields for areas */
 	{ .name = "chassis-type",  .val = 't', .has_arg = required_argument },
+
+	/* Set input file format to compiled template */
+	{ .name = "template",      .val = 'T', .has_arg = required_argument },
+
 	{ .name = "board-date-unspec", .val = 'u', .has_arg = no_argument },
 
 	/* MultiRecord area options */
@@ -80,6 +134,32 @@ static const struct option options[] = {
 
 /* Sorted by index */
 static const char * const option_help[] = {
+	['A'] = "Store the binary output in a FRU archive file instead of separate\n\t\t"
+	        "files. The output file name is used as the entry key, use\n\t\t"
+	        "generator expressions with '-n' to make it unique per unit.\n\t\t"
+	        "With '-N', the scanned files are stored in the archive under\n\t\t"
+	        "their names. An existing archive is appended to, entries with\n\t\t"
+	        "the same key are replaced. The archive is only updated if all\n\t\t"
+	        "the output is stored, a failed run leaves it as it was.\n"
+	        "\n\t\t"
+	        "Examples:\n\t\t"
+	        "\tfrugen -j fru-template.json -n 1000 -A lot.fruar \\\n\t\t"
+	        "\t       -s 'board.serial=SN${seq:1}' 'SN${seq:1}'\n\t\t"
+	        "\tfrugen -N -A fleet.fruar /var/lib/fru/nvme*.bin",
+	['c'] = "Load FRU information from a CBOR file, use '-' for stdin.\n\t\t"
+	        "The data are the same as for '-j', only binary data (the internal\n\t\t"
+	        "use area, binary fields and MR record data) are byte strings.\n\t\t"
+	        "See '-o cbor'",
+	['C'] = "Save the output as a compiled template instead of a binary FRU\n\t\t"
+	        "file. A compiled template is a snapshot of the decoded FRU data,\n\t\t"
+	        "including the 'auto' encodings and board date, that is loaded\n\t\t"
+	        "with '-T' without any parsing. Use it to speed up the repeated\n\t\t"
+	        "invocations with the same JSON template. The template is only\n\t\t"
+	        "valid for the same frugen build, don't use it for interchange.\n"
+	        "\n\t\t"
+	        "Example:\n\t\t"
+	        "\tfrugen -j fru-template.json -C fru-template.frut\n\t\t"
+	        "\tfrugen -T fru-template.frut -s 'board.serial=SN1' fru.bin",
 	['d'] = "Set board manufacturing date/time, use \"DD/MM/YYYY HH:MM\" format.\n\t\t"
 	        "By default, if the date is neithers specified by this option, nor\n\t\t"
 	        "is given in the input template, the resulting output depends on the\n\t\t"
@@ -91,6 +171,40 @@ static const char * const option_help[] = {
 	        "json   | not included         | \"auto\"\n\t\t"
 	        "text   | \"Unspecified\"        | \"Unspecified (auto)\"\n\t\t"
 	        "-------|----------------------|-------------------------",
+	['D'] = "Run as a daemon serving FRU generation requests on the given\n\t\t"
+	        "UNIX socket path, using the templates given with '-p'.\n\t\t"
+	        "Each request names a template and lists the overrides in\n\t\t"
+	        "'--set' syntax, or as 'uuid=<uuid>' or 'date=<date>'. The response\n\t\t"
+	        "is the encoded binary FRU image or an error. See frugen-daemon.h\n\t\t"
+	        "for the protocol. Runs until SIGINT or SIGTERM.\n"
+	        "\n\t\t"
+	        "Example:\n\t\t"
+	        "\tfrugen -p server=server.json -p blade=blade.bin -D /run/frugen.sock",
+	['E'] = "Treat all the non-option arguments as binary FRU files or FRU\n\t\t"
+	        "archives (see '-A') and decode them into a columnar file for\n\t\t"
+	        "analytics: a column per standard field of the info areas with\n\t\t"
+	        "dictionary-encoded strings, and separate tables for the custom\n\t\t"
+	        "fields and MR records. The format is described in frugen-export.h,\n\t\t"
+	        "it's little-endian and meant to be memory-mapped. Files that fail\n\t\t"
+	        "to decode are reported to stderr and skipped, the exit code is\n\t\t"
+	        "non-zero in that case. Use '-g' to ignore errors.\n"
+	        "\n\t\t"
+	        "Example:\n\t\t"
+	        "\tfrugen -E fleet.frucol /var/lib/fru/*.bin lot.fruar",
+	['F'] = "Treat all the non-option arguments as binary FRU files or\n\t\t"
+	        "directories with such files, and fix the wrong checksums in them\n\t\t"
+	        "in place: the header checksum, the info area checksums, and the\n\t\t"
+	        "MR record header and data checksums. Nothing else is changed,\n\t\t"
+	        "unlike with decoding and encoding the files anew with '-g'.\n\t\t"
+	        "The directories are walked recursively, the files are processed\n\t\t"
+	        "in parallel. Every fixed checksum is reported, only the checksum\n\t\t"
+	        "bytes are written back. The files found in the directories that\n\t\t"
+	        "aren't FRU images are reported as skipped. Other files that fail\n\t\t"
+	        "to be processed are reported to stderr, the exit code is non-zero\n\t\t"
+	        "in that case.\n"
+	        "\n\t\t"
+	        "Example:\n\t\t"
+	        "\tfrugen -F /var/lib/fru",
 	['g'] = "Set debug flag (use multiple times for multiple flags):\n\t\t"
 	        "\tfver  - Ignore wrong version in FRU header\n\t\t"
 	        "\taver  - Ignore wrong version in area headers\n\t\t"
@@ -109,6 +223,59 @@ static const char * const option_help[] = {
 	        "\tfrugen -hhelp # Help for long option '--help'\n\t\t"
 	        "\tfrugen -hh    # Help for short option '-h'",
 	['j'] = "Load FRU information from a JSON file, use '-' for stdin",
+	['k'] = "Load the entry with the given key from a FRU archive with '-r'.\n\t\t"
+	        "Must precede '-r'. See '-A'.\n"
+	        "\n\t\t"
+	        "Example:\n\t\t"
+	        "\tfrugen -k SN1 -r lot.fruar -o text -",
+	['m'] = "Generate a unit per line of a JSONL manifest file, use '-' for stdin.\n\t\t"
+	        "Each line is a JSON object in the same format as for '-j', it is\n\t\t"
+	        "applied on top of the template given with '-j' or '-r'. Fields\n\t\t"
+	        "and the board date are replaced, custom fields and MR records\n\t\t"
+	        "are added, except for the management records (e.g. UUID) that\n\t\t"
+	        "replace the ones of the same subtype. Generator expressions\n\t\t"
+	        "(see '-n') are expanded with the 0-based line number as the unit.\n"
+	        "\n\t\t"
+	        "Example:\n\t\t"
+	        "\tfrugen -j fru-template.json -m lot.jsonl -A lot.fruar 'unit${seq:1}'",
+	['n'] = "Generate the given number of FRU files (units) from the same\n\t\t"
+	        "template. Values of '-s' and '-U', and the output file name may\n\t\t"
+	        "contain generator expressions that are expanded for each unit:\n\t\t"
+	        "\t${seq:<start>[:<step>[:<width>[:luhn]]]}\n\t\t"
+	        "\t             - Decimal counter, optionally zero-padded to\n\t\t"
+	        "\t               <width> and followed by a Luhn check digit\n\t\t"
+	        "\t${date:<fmt>} - Program start time, strftime() format\n\t\t"
+	        "\t${uuid4}      - Random UUID\n\t\t"
+	        "\t${uuid7}      - Time-ordered UUID\n\t\t"
+	        "\t$$            - Literal '$'\n\t\t"
+	        "With more than one unit, the output file name must contain\n\t\t"
+	        "an expression, unless it is '-' for stdout.\n"
+	        "\n\t\t"
+	        "Example:\n\t\t"
+	        "\tfrugen -j fru-template.json -n 100 -U '${uuid4}' \\\n\t\t"
+	        "\t       -s 'board.serial=SN${seq:1000:1:6:luhn}' 'fru-${seq:1:1:3}.bin'",
+	['I'] = "Treat all the non-option arguments as binary FRU files and print\n\t\t"
+	        "a CSV table of 'file,offset,area,index,error' for all the issues\n\t\t"
+	        "found in them, as many as possible in a single pass: a broken\n\t\t"
+	        "record or area doesn't hide the ones that follow. The offset is\n\t\t"
+	        "that of the offending byte, field, record or area in the file.\n\t\t"
+	        "The index is that of the field or record, or -1 for the whole area.\n\t\t"
+	        "FRU archives (see '-A') are scanned entry by entry.\n\t\t"
+	        "The exit code is non-zero if any issue is found.\n"
+	        "\n\t\t"
+	        "Example:\n\t\t"
+	        "\tfrugen -I /var/lib/fru/*.bin > issues.csv",
+	['N'] = "Treat all the non-option arguments as binary FRU files and print\n\t\t"
+	        "a CSV table of 'file,formfactor,capacity' for the NVMe records\n\t\t"
+	        "found in them. Only the MR area is decoded, so this is fast enough\n\t\t"
+	        "for thousands of drive FRU dumps. Use '-g' to ignore errors.\n\t\t"
+	        "FRU archives (see '-A') are scanned entry by entry, such entries\n\t\t"
+	        "are reported as '<archive>:<key>'.\n\t\t"
+	        "Files without an NVMe record are reported to stderr, and the exit\n\t\t"
+	        "code is non-zero in that case.\n"
+	        "\n\t\t"
+	        "Example:\n\t\t"
+	        "\tfrugen -N /var/lib/fru/nvme*.bin > capacities.csv",
 	['o'] = "Output format, one of:\n"
 	        "\t\tbinary - Default format when writing to a file.\n"
 	        "\t\t         For stdout, the following will be used, even\n"
@@ -119,8 +286,26 @@ static const char * const option_help[] = {
 	        "\t\ttext   - Plain text format, no decoding of MR area records"
 #ifndef __HAS_JSON__
 	        ".\n\t\t         Default format when writing to stdout"
+#else
+	        ".\n\t\tjson-compact - JSON without any whitespace.\n"
+	        "\t\tcbor   - CBOR (RFC 8949) with the same structure as JSON,\n"
+	        "\t\t         compact and faster to parse for machine consumers"
 #endif
 	        ,
+	['p'] = "Preload a template for daemon mode ('-D'), use <name>=<file> form.\n\t\t"
+	        "Files with '.json' extension are loaded as JSON, with '.cbor' as\n\t\t"
+	        "CBOR, with '.frut' as compiled templates (see '-C'), all others\n\t\t"
+	        "as raw binary.\n\t\t"
+	        "Use multiple times for multiple templates",
+	['P'] = "Select where the board mfg. date comes from when it is not given\n\t\t"
+	        "explicitly (see '-d'):\n"
+	        "\n\t\t"
+	        "now      - the time when each unit is saved, the default\n\t\t"
+	        "lot      - the same time for all the units of this run\n\t\t"
+	        "manifest - the date from every line of the manifest (see '-m'),\n\t\t"
+	        "           a line without a date is an error\n\t\t"
+	        "source   - the SOURCE_DATE_EPOCH environment variable,\n\t\t"
+	        "           for reproducible builds",
 	['r'] = "Load FRU information from a raw binary file, use '-' for stdin",
 	['s'] = "Set a text field in an area to the given value, use given encoding\n\t\t"
 	        "Requires an argument in form [<encoding>:]<area>.<field>=<value>\n\t\t"
@@ -176,7 +361,10 @@ static const char * const option_help[] = {
 	        "\tfrugen -j fru-template.json -s binary:board.custom.+2=0102DEADBEEF out.fru\n\t\t"
 	        "\t\t# (insert a custom field at position 2 in board, old 2 becomes 3)",
 	/* Chassis info area related options */
+	['S'] = "Seed the UUID generator used by '${uuid4}' and '${uuid7}'\n\t\t"
+	        "expressions to get reproducible output (see '-n')",
 	['t'] = "Set chassis type (hex). Defaults to 0x02 ('Unknown')",
+	['T'] = "Load FRU information from a compiled template file, see '-C'",
 	['u'] = "Don't use current system date/time for board mfg. date, use 'Unspecified'",
 	/* MultiRecord area related options */
 	['U'] = "Add/update a System Unique ID (UUID/GUID) record in MR area",
@@ -370,6 +558,226 @@ const frugen_name_t * frugen_mr_mgmt_name_by_type(fru_mr_mgmt_type_t type)
 	return &frugen_mr_mgmt_name[i];
 }
 
+#define MRF(rec, f, k, js, hu, m) { \
+	.name = { js, hu }, \
+	.kind = FRUGEN_MRF_##k, \
+	.offset = offsetof(fru_mr_rec_t, rec.f), \
+	.size = sizeof(((fru_mr_rec_t *)NULL)->rec.f), \
+	.mask = m, \
+}
+#define MRF_NUM(rec, f, k, hu) MRF(rec, f, k, #f, hu, 0)
+
+static const frugen_mr_field_t mr_psu_fields[] = {
+	MRF_NUM(psu, overall_cap, UINT, "Overall capacity, W"),
+	MRF_NUM(psu, peak_va, UINT, "Peak VA"),
+	MRF_NUM(psu, inrush_amp, UINT, "Inrush current, A"),
+	MRF_NUM(psu, inrush_ms, UINT, "Inrush interval, ms"),
+	MRF_NUM(psu, lo_vin1, SINT, "Input range 1 low, 10mV"),
+	MRF_NUM(psu, hi_vin1, SINT, "Input range 1 high, 10mV"),
+	MRF_NUM(psu, lo_vin2, SINT, "Input range 2 low, 10mV"),
+	MRF_NUM(psu, hi_vin2, SINT, "Input range 2 high, 10mV"),
+	MRF_NUM(psu, lo_freq, UINT, "Input frequency low, Hz"),
+	MRF_NUM(psu, hi_freq, UINT, "Input frequency high, Hz"),
+	MRF_NUM(psu, dropout_ms, UINT, "A/C dropout tolerance, ms"),
+	MRF(psu, flags, FLAG, "prefail", "Predictive fail support",
+	    FRU_MR_PSU_FLAGS_PREFAIL_SUPPORT),
+	MRF(psu, flags, FLAG, "pfc", "Power factor correction",
+	    FRU_MR_PSU_FLAGS_PF_CORRECTION),
+	MRF(psu, flags, FLAG, "autoswitch", "Autoswitch",
+	    FRU_MR_PSU_FLAGS_AUTOSWITCH),
+	MRF(psu, flags, FLAG, "hotswap", "Hot swap support",
+	    FRU_MR_PSU_FLAGS_HOTSWAP),
+	MRF(psu, flags, FLAG, "tach_ppr", "Tach 2 pulses/rev or prefail active high",
+	    FRU_MR_PSU_FLAGS_TACH_PPR),
+	MRF_NUM(psu, peak_watts, UINT, "Peak capacity, W"),
+	MRF_NUM(psu, holdup_s, UINT, "Hold-up time, s"),
+	MRF_NUM(psu, combined_v1, UINT, "Combined voltage 1 (0=12V,1=-12V,2=5V,3=3.3V)"),
+	MRF_NUM(psu, combined_v2, UINT, "Combined voltage 2 (0=12V,1=-12V,2=5V,3=3.3V)"),
+	MRF_NUM(psu, combined_watts, UINT, "Total combined wattage, W"),
+	MRF_NUM(psu, prefail_tach_rps, UINT, "Prefail tach threshold, RPS"),
+};
+
+/* Regular and extended DC output records share the same structure */
+static const frugen_mr_field_t mr_dcout_fields[] = {
+	MRF_NUM(dco, output, UINT, "Output number"),
+	MRF_NUM(dco, standby, BOOL, "Standby"),
+	MRF_NUM(dco, nominal, SINT, "Nominal voltage, 10mV"),
+	MRF_NUM(dco, max_neg_dev, SINT, "Max negative deviation, 10mV"),
+	MRF_NUM(dco, max_pos_dev, SINT, "Max positive deviation, 10mV"),
+	MRF_NUM(dco, ripple, UINT, "Ripple and noise, mV"),
+	MRF_NUM(dco, min_current, UINT, "Minimum current draw"),
+	MRF_NUM(dco, max_current, UINT, "Maximum current draw"),
+	MRF_NUM(dco, current_100ma, BOOL, "Current units are 100mA"),
+};
+
+/* Regular and extended DC load records share the same structure */
+static const frugen_mr_field_t mr_dcload_fields[] = {
+	MRF_NUM(dcl, output, UINT, "Output number"),
+	MRF_NUM(dcl, nominal, SINT, "Nominal voltage, 10mV"),
+	MRF_NUM(dcl, min_voltage, SINT, "Minimum voltage, 10mV"),
+	MRF_NUM(dcl, max_voltage, SINT, "Maximum voltage, 10mV"),
+	MRF_NUM(dcl, ripple, UINT, "Ripple and noise, mV"),
+	MRF_NUM(dcl, min_current, UINT, "Minimum current load"),
+	MRF_NUM(dcl, max_current, UINT, "Maximum current load"),
+	MRF_NUM(dcl, current_100ma, BOOL, "Current units are 100mA"),
+};
+
+static const frugen_mr_field_t mr_nvme_fields[] = {
+	MRF_NUM(nvme.info, version, UINT, "Version"),
+	MRF_NUM(nvme.info, formfactor, UINT, "Form factor"),
+	MRF_NUM(nvme.info, p1v8_init, UINT, "1.8V initial power, W"),
+	MRF_NUM(nvme.info, p1v8_max, UINT, "1.8V maximum power, W"),
+	MRF_NUM(nvme.info, p3v3_init, UINT, "3.3V initial power, W"),
+	MRF_NUM(nvme.info, p3v3_max, UINT, "3.3V maximum power, W"),
+	MRF_NUM(nvme.info, p3v3_aux_max, UINT, "3.3Vaux maximum power, W"),
+	MRF_NUM(nvme.info, p5v_init, UINT, "5V initial power, W"),
+	MRF_NUM(nvme.info, p5v_max, UINT, "5V maximum power, W"),
+	MRF_NUM(nvme.info, p12v_init, UINT, "12V initial power, W"),
+	MRF_NUM(nvme.info, p12v_max, UINT, "12V maximum power, W"),
+	MRF_NUM(nvme.info, ptherm_max, UINT, "Maximum thermal load, W"),
+	MRF_NUM(nvme.info, capacity_lo, UINT, "Capacity, bytes 0-7"),
+	MRF_NUM(nvme.info, capacity_mid, UINT, "Capacity, bytes 8-11"),
+	MRF_NUM(nvme.info, capacity_hi, UINT, "Capacity, byte 12"),
+};
+
+static const frugen_mr_field_t mr_nvme_pcie_fields[] = {
+	MRF_NUM(nvme.pcie, version, UINT, "Version"),
+	MRF_NUM(nvme.pcie, port, UINT, "Port number"),
+	MRF_NUM(nvme.pcie, info, UINT, "Port information"),
+	MRF_NUM(nvme.pcie, speeds, UINT, "Link speeds"),
+	MRF_NUM(nvme.pcie, max_width, UINT, "Maximum link width"),
+	MRF_NUM(nvme.pcie, mctp, UINT, "MCTP support"),
+	MRF_NUM(nvme.pcie, refclk, UINT, "Reference clock capability"),
+	MRF_NUM(nvme.pcie, port_id, UINT, "Port identifier"),
+};
+
+static const frugen_mr_field_t mr_nvme_topology_fields[] = {
+	MRF_NUM(nvme.topology, version, UINT, "Version"),
+	MRF_NUM(nvme.topology, count, UINT, "Element descriptors"),
+	MRF_NUM(nvme.topology, data, HEX, "Data"),
+};
+
+#define MR_TYPED(t, js, hu, f) { \
+	.type = t, \
+	.name = { js, hu }, \
+	.fields = f, \
+	.count = FRU_ARRAY_SZ(f) \
+}
+
+static const frugen_mr_typed_t mr_typed[] = {
+	MR_TYPED(FRU_MR_PSU_INFO, "psu", "PSU Information", mr_psu_fields),
+	MR_TYPED(FRU_MR_DC_OUT, "dcout", "DC Output", mr_dcout_fields),
+	MR_TYPED(FRU_MR_DC_LOAD, "dcload", "DC Load", mr_dcload_fields),
+	MR_TYPED(FRU_MR_EXT_DC_OUT, "ext_dcout", "Extended DC Output", mr_dcout_fields),
+	MR_TYPED(FRU_MR_EXT_DC_LOAD, "ext_dcload", "Extended DC Load", mr_dcload_fields),
+	MR_TYPED(FRU_MR_NVME, "nvme", "NVMe Information", mr_nvme_fields),
+	MR_TYPED(FRU_MR_NVME_PCIE_PORT, "nvme_pcie", "NVMe PCIe Port", mr_nvme_pcie_fields),
+	MR_TYPED(FRU_MR_NVME_TOPOLOGY, "nvme_topology", "NVMe Topology", mr_nvme_topology_fields),
+};
+
+const frugen_mr_typed_t * frugen_mr_typed_by_type(fru_mr_type_t type)
+{
+	for (size_t i = 0; i < FRU_ARRAY_SZ(mr_typed); i++) {
+		if (mr_typed[i].type == type)
+			return &mr_typed[i];
+	}
+	return NULL;
+}
+
+const frugen_mr_typed_t * frugen_mr_typed_by_name(const char * name)
+{
+	for (size_t i = 0; i < FRU_ARRAY_SZ(mr_typed); i++) {
+		if (!strcmp(mr_typed[i].name.json, name))
+			return &mr_typed[i];
+	}
+	return NULL;
+}
+
+int64_t frugen_mr_field_get(const fru_mr_rec_t * rec, const frugen_mr_field_t * f)
+{
+	const void * ptr = (const void *)rec + f->offset;
+	uint64_t uval = 0;
+
+	if (FRUGEN_MRF_BOOL == f->kind)
+		return *(const bool *)ptr;
+
+	switch (f->size) {
+	case sizeof(uint8_t):
+		uval = *(const uint8_t *)ptr;
+		break;
+	case sizeof(uint16_t):
+		uval = *(const uint16_t *)ptr;
+		break;
+	case sizeof(uint32_t):
+		uval = *(const uint32_t *)ptr;
+		break;
+	case sizeof(uint64_t):
+		uval = *(const uint64_t *)ptr;
+		break;
+	default:
+		fatal("BUG!!! Unsupported MR field size %zu", f->size);
+	}
+
+	if (FRUGEN_MRF_FLAG == f->kind)
+		return !!(uval & f->mask);
+
+	if (FRUGEN_MRF_SINT == f->kind) {
+		/* Sign-extend */
+		const int shift = 64 - 8 * f->size;
+		return (int64_t)(uval << shift) >> shift;
+	}
+
+	return uval;
+}
+
+bool frugen_mr_field_set(fru_mr_rec_t * rec, const frugen_mr_field_t * f, int64_t val)
+{
+	void * ptr = (void *)rec + f->offset;
+	const int bits = 8 * f->size;
+	uint64_t uval;
+
+	switch (f->kind) {
+	case FRUGEN_MRF_BOOL:
+		*(bool *)ptr = !!val;
+		return true;
+	case FRUGEN_MRF_FLAG:
+		uval = frugen_mr_field_get(rec, &(frugen_mr_field_t){ .kind = FRUGEN_MRF_UINT,
+		                                                      .offset = f->offset,
+		                                                      .size = f->size });
+		uval = val ? (uval | f->mask) : (uval & ~(uint64_t)f->mask);
+		break;
+	case FRUGEN_MRF_SINT:
+		if (val < -(1LL << (bits - 1)) || val >= (1LL << (bits - 1)))
+			return false;
+		uval = (uint64_t)val;
+		break;
+	default:
+		if (val < 0 || (bits < 64 && (uint64_t)val >= (1ULL << bits)))
+			return false;
+		uval = (uint64_t)val;
+		break;
+	}
+
+	switch (f->size) {
+	case sizeof(uint8_t):
+		*(uint8_t *)ptr = (uint8_t)uval;
+		break;
+	case sizeof(uint16_t):
+		*(uint16_t *)ptr = (uint16_t)uval;
+		break;
+	case sizeof(uint32_t):
+		*(uint32_t *)ptr = (uint32_t)uval;
+		break;
+	case sizeof(uint64_t):
+		*(uint64_t *)ptr = uval;
+		break;
+	default:
+		fatal("BUG!!! Unsupported MR field size %zu", f->size);
+	}
+
+	return true;
+}
+
 static inline
 bool isdelim(char c)
 {
@@ -393,7 +801,7 @@ static char * const mr_type_names[FRU_MR_TYPE_COUNT] = {
 
 	[FRU_MR_NVME] = "NVMe Information",
 	[FRU_MR_NVME_PCIE_PORT] = "NVMe PCIe Port",
-	[FRU_MR_NVME_TOPOLOGY] = "NVMe Topolgy",
+	[FRU_MR_NVME_TOPOLOGY] = "NVMe Topology",
 	[FRU_MR_NVME_RSVD_E] = "NVMe Reserved",
 	[FRU_MR_NVME_RSVD_F] = "NVMe Reserved",
 
@@ -508,6 +916,35 @@ void fhexstrdump(FILE * fp, const char * prefix, const char * s)
 //		fprintf(fp, "\n");
 }
 
+/*
+ * Dump a binary buffer in lines of 16 octets each,
+ * the same way as fhexstrdump() does
+ */
+static
+void fhexdump(FILE * fp, const char * prefix, const void * data, size_t len)
+{
+	const size_t perline = 16;
+	const uint8_t * buf = data;
+	size_t totalcount; // Byte count
+
+	for (totalcount = 0; totalcount < len; totalcount += perline) {
+		size_t count;
+		char printable[perline + 1];
+		memset(printable, 0, perline + 1);
+
+		fprintf(fp, "%s%04zX:", prefix, totalcount);
+		for (count = 0; count < perline && totalcount + count < len; count++) {
+			uint8_t c = buf[totalcount + count];
+			printable[count] = isprint(c) ? (char)c : (char)0xFE;
+			fprintf(fp, " %02hhX", c);
+		}
+		const size_t spaces_per_byte = 3; // Size of result of "%02X " above
+		const size_t remains_bytes = perline - count;
+		const size_t remains_spaces = 1 + remains_bytes * spaces_per_byte;
+		fprintf(fp, "%*c| %s\n", (int)remains_spaces, ' ', printable);
+	}
+}
+
 #if 0
 #define debug_dump(level, data, len, fmt, args...) do { \
 	debug(level, fmt, ##args); \
@@ -548,10 +985,9 @@ bool datestr_to_tv(struct timeval * tv, const char * datestr)
 	tm.tm_hour = hour;
 	tm.tm_min = min;
 
-	tzset(); // Set up local timezone
-	tm.tm_isdst = -1; // Use local timezone data in mktime
-	time = mktime(&tm); // Here we have local time since local Epoch
-	tv->tv_sec = time + timezone; // Convert to UTC
+	/* The dates in FRU are UTC, no time zone is involved */
+	time = fru_date_from_tm(&tm);
+	tv->tv_sec = time;
 	tv->tv_usec = 0;
 	return true;
 }
@@ -560,6 +996,7 @@ static struct frugen_config_s config = {
 	.format = FRUGEN_FMT_UNSET,
 	.outformat = FRUGEN_FMT_BINARY, /* Default binary output */
 	.flags = FRU_NOFLAGS,
+	.count = 1,
 };
 
 void tv_to_datestr(char * datestr, const struct timeval * tv, bool include_timezone)
@@ -570,13 +1007,11 @@ void tv_to_datestr(char * datestr, const struct timeval * tv, bool include_timez
 			datestr[0] = 0; // Empty string for 'unspecified'
 		}
 
-		tzset(); // Set up local timezone
 		struct tm bdtime;
-		// Time in FRU is in UTC, convert to local
-		time_t seconds = tv->tv_sec - timezone;
-		localtime_r(&seconds, &bdtime);
+		// Time in FRU is in UTC, show it as is
+		fru_date_to_tm(tv->tv_sec, &bdtime);
 		const char * const fmt = include_timezone
-		                         ? "%d/%m/%Y %H:%M %Z"
+		                         ? "%d/%m/%Y %H:%M UTC"
 		                         : "%d/%m/%Y %H:%M";
 		strftime(datestr, DATEBUF_SZ, fmt, &bdtime);
 }
@@ -635,7 +1070,12 @@ void fru_perror(FILE *fp, const char *fmt, ...)
 	fputc('\n', fp);
 }
 
-fieldopt_t arg_to_fieldopt(char * arg)
+#define FIELDOPT_FAIL(fmt, args...) do { \
+	snprintf(err, errlen, fmt, ##args); \
+	return false; \
+} while(0)
+
+bool frugen_parse_fieldopt(fieldopt_t * fopt, char * arg, char * err, size_t errlen)
 {
 	fieldopt_t opt = { .type = FRU_FE_PRESERVE };
 	char * p;
@@ -651,7 +1091,7 @@ fieldopt_t arg_to_fieldopt(char * arg)
 			debug(2, "Encoding requested is '%s'", arg);
 			debug(2, "Encoding parsed is '%s'", frugen_enc_name_by_val(opt.type));
 			if (FRU_FE_UNKNOWN == opt.type) {
-				fatal("Field encoding type '%s' is not supported", arg);
+				FIELDOPT_FAIL("Field encoding type '%s' is not supported", arg);
 			}
 		}
 		arg = p+1;
@@ -663,7 +1103,7 @@ fieldopt_t arg_to_fieldopt(char * arg)
 	/* Now check if the area is specified */
 	p = strchr(arg, '.');
 	if (!p || p == arg) {
-		fatal("Area name must be specified");
+		FIELDOPT_FAIL("Area name must be specified");
 	}
 	*p = 0;
 
@@ -674,25 +1114,25 @@ fieldopt_t arg_to_fieldopt(char * arg)
 			break;
 	}
 	if (opt.area > FRU_MAX_AREA) {
-		fatal("Bad area name '%s'", arg);
+		FIELDOPT_FAIL("Bad area name '%s'", arg);
 	}
 	arg = p + 1;
 
 	/* Now check if there is value */
 	p = strchr(arg, '=');
 	if ((p && arg == p) || (!p && !strlen(arg))) {
-		fatal("Must specify field name for %s area", area_names[opt.area].human);
+		FIELDOPT_FAIL("Must specify field name for %s area", area_names[opt.area].human);
 	}
 	if (!p) {
-		fatal("Must specify value for '%s.%s'",
-		      area_names[opt.area].json, arg);
+		FIELDOPT_FAIL("Must specify value for '%s.%s'",
+		              area_names[opt.area].json, arg);
 	}
 	*p = 0;
 
 #define FRU_FIELD_NOT_PRESENT (-1)
 	if (!field_max[opt.area]) {
-		fatal("No fields are settable for area '%s'",
-			  area_names[opt.area].json);
+		FIELDOPT_FAIL("No fields are settable for area '%s'",
+		              area_names[opt.area].json);
 	}
 	for (opt.field.index = field_max[opt.area] - 1;
 		 opt.field.index > FRU_FIELD_NOT_PRESENT; opt.field.index--)
@@ -736,12 +1176,12 @@ fieldopt_t arg_to_fieldopt(char * arg)
 				}
 
 				if (opt.custom_index < 0)
-					fatal("Custom field index must be a [+]number or one of [FHSTEL]");
+					FIELDOPT_FAIL("Custom field index must be a [+]number or one of [FHSTEL]");
 			}
 		}
 		else {
-			fatal("Field '%s' doesn't exist in area '%s'",
-			      arg, area_names[opt.area].json);
+			FIELDOPT_FAIL("Field '%s' doesn't exist in area '%s'",
+			              arg, area_names[opt.area].json);
 		}
 	}
 	opt.value = p + 1;
@@ -753,9 +1193,105 @@ fieldopt_t arg_to_fieldopt(char * arg)
 	         opt.value);
 
 
+	*fopt = opt;
+	return true;
+}
+
+#undef FIELDOPT_FAIL
+
+fieldopt_t arg_to_fieldopt(char * arg)
+{
+	fieldopt_t opt;
+	char err[256];
+
+	if (!frugen_parse_fieldopt(&opt, arg, err, sizeof(err)))
+		fatal("%s", err);
+
 	return opt;
 }
 
+bool frugen_apply_fieldopt(fru_t * fru, const fieldopt_t * fieldopt,
+                           const char ** failure)
+{
+	/* We intentionally waste some memory on these sparse arrays
+	 * for the sake of data/code separation */
+	fru_field_t * const fields[FRU_TOTAL_AREAS][FRU_MAX_FIELD_COUNT] = {
+		[FRU_CHASSIS_INFO] = {
+			[FRU_CHASSIS_PARTNO] = &fru->chassis.pn,
+			[FRU_CHASSIS_SERIAL] = &fru->chassis.serial,
+		},
+		[FRU_BOARD_INFO] = {
+			[FRU_BOARD_MFG] = &fru->board.mfg,
+			[FRU_BOARD_PRODNAME] = &fru->board.pname,
+			[FRU_BOARD_SERIAL] = &fru->board.serial,
+			[FRU_BOARD_PARTNO] = &fru->board.pn,
+			[FRU_BOARD_FILE] = &fru->board.file,
+		},
+		[FRU_PRODUCT_INFO] = {
+			[FRU_PROD_MFG] = &fru->product.mfg,
+			[FRU_PROD_NAME] = &fru->product.pname,
+			[FRU_PROD_MODELPN] = &fru->product.pn,
+			[FRU_PROD_VERSION] = &fru->product.ver,
+			[FRU_PROD_SERIAL] = &fru->product.serial,
+			[FRU_PROD_ASSET] = &fru->product.atag,
+			[FRU_PROD_FILE] = &fru->product.file,
+		},
+	};
+
+	/* Now do the actual job and set data in the appropriate locations */
+	fru_field_t * field = NULL;
+	if (fieldopt->field.index != FRU_FIELD_CUSTOM)
+		field = fields[fieldopt->area][fieldopt->field.index];
+	else {
+		if (fieldopt->custom_index != FRU_LIST_HEAD
+		    && fieldopt->custom_index != FRU_LIST_TAIL)
+		{
+			if (fieldopt->custom_insert) {
+				// here custom_index is a 1-based index of the field
+				debug(3, "Inserting a custom field at position %d",
+				      fieldopt->custom_index);
+				field = fru_add_custom(fru, fieldopt->area,
+				                       LIST_INDEX_LIBFRU(fieldopt->custom_index),
+				                       FRU_FE_EMPTY, NULL);
+			}
+			else {
+				// here custom_index is a 1-based index of the field
+				debug(3, "Modifying custom field %d. New value is [%s]",
+				      fieldopt->custom_index, fieldopt->value);
+				// The field is modified in place, it may be shared with a template
+				if (!fru_unshare(fru, fieldopt->area)) {
+					*failure = "Failed to copy the custom fields";
+					return false;
+				}
+				field = fru_get_custom(fru, fieldopt->area,
+				                       LIST_INDEX_LIBFRU(fieldopt->custom_index));
+			}
+			if (!field) {
+				*failure = "Custom field not found in specified area";
+				return false;
+			}
+		}
+		else {
+			// custom_index is either FRU_LIST_HEAD or FRU_LIST_TAIL here
+			debug(3, "Adding a custom field to the start or end of the list");
+			field = fru_add_custom(fru, fieldopt->area, fieldopt->custom_index, FRU_FE_EMPTY, NULL);
+			if (!field) {
+				*failure = "Failed to add a custom field";
+				return false;
+			}
+
+		}
+	}
+	debug(3, "Setting the custom field to [%s]", fieldopt->value);
+	if(!fru_setfield(field, fieldopt->type, fieldopt->value)) {
+		*failure = "Failed to set field value";
+		return false;
+	}
+	// Don't care about errors. The area is either enabled now or was enabled before.
+	fru_enable_area(fru, fieldopt->area, FRU_APOS_AUTO);
+	return true;
+}
+
 void load_fromfile(const char * fname,
                    const struct frugen_config_s * config,
                    fru_t * fru)
@@ -768,19 +1304,245 @@ void load_fromfile(const char * fname,
 		// This call exits on failures
 		frugen_loadfile_json(fru, fname);
 		break;
+	case FRUGEN_FMT_CBOR:
+		// This call exits on failures
+		frugen_loadfile_cbor(fru, fname);
+		break;
 #endif /* __HAS_JSON__ */
 	case FRUGEN_FMT_BINARY:
+		if (config->archive_key) {
+			fru_archive_t * ar = fru_archive_open(fname);
+
+			if (!ar)
+				fru_fatal("Couldn't open FRU archive %s", fname);
+			fru = fru_archive_load(fru, ar, config->archive_key, config->flags);
+			if (!fru)
+				fru_fatal("Couldn't load '%s' from %s", config->archive_key, fname);
+			fru_archive_close(ar);
+			break;
+		}
 		fru = fru_loadfile(fru, fname, config->flags);
 		if (!fru) {
 			fru_fatal("Couldn't load FRU file");
 		}
 		break;
+	case FRUGEN_FMT_TEMPLATE:
+		fru = fru_template_load(fru, fname);
+		if (!fru)
+			fru_fatal("Couldn't load compiled template %s", fname);
+		break;
 	default:
 		fatal("Please specify the input file format");
 		break;
 	}
 }
 
+/*
+ * Print the 13-byte NVMe capacity as a decimal number into \a out,
+ * which must be at least 33 bytes long (2^104 has 32 digits)
+ */
+static
+void nvme_capacity_str(char * out, const fru_mr_nvme_info_t * info)
+{
+	/* Most significant byte first */
+	uint8_t num[13];
+	char digits[33];
+	size_t ndigits = 0;
+	bool zero;
+
+	num[0] = info->capacity_hi;
+	for (size_t i = 0; i < 4; i++)
+		num[1 + i] = info->capacity_mid >> (8 * (3 - i));
+	for (size_t i = 0; i < 8; i++)
+		num[5 + i] = info->capacity_lo >> (8 * (7 - i));
+
+	/* Long division by 10, collect the remainders as digits */
+	do {
+		unsigned rem = 0;
+
+		zero = true;
+		for (size_t i = 0; i < sizeof(num); i++) {
+			unsigned cur = (rem << 8) | num[i];
+			num[i] = cur / 10;
+			rem = cur % 10;
+			if (num[i])
+				zero = false;
+		}
+		digits[ndigits++] = '0' + rem;
+	} while (!zero);
+
+	while (ndigits)
+		*out++ = digits[--ndigits];
+	*out = 0;
+}
+
+/*
+ * A handler for each binary FRU image found by scan_files()
+ *
+ * @returns false if the image failed to be processed
+ */
+typedef bool (* scan_fn_t)(const char * name, const void * buf, size_t len,
+                           const struct frugen_config_s * config, void * arg);
+
+/*
+ * Print form factor and capacity of an NVMe drive from a binary FRU image
+ */
+static
+bool nvme_scan_image(const char * name, const void * buf, size_t len,
+                     const struct frugen_config_s * config,
+                     void * arg __attribute__((unused)))
+{
+	fru_mr_nvme_info_t info;
+	char capacity[33];
+
+	if (!fru_mr_nvme_info(buf, len, config->flags, &info)) {
+		fru_warn("%s", name);
+		return false;
+	}
+
+	nvme_capacity_str(capacity, &info);
+	printf("%s,%u,%s\n", name, info.formfactor, capacity);
+	return true;
+}
+
+/* Issues to report individually per image, the rest are only counted */
+#define MAX_DIAGS 64
+
+/*
+ * Print all the issues found in a binary FRU image
+ */
+static
+bool diag_image(const char * name, const void * buf, size_t len,
+                const struct frugen_config_s * config __attribute__((unused)),
+                void * arg __attribute__((unused)))
+{
+	fru_diag_t diags[MAX_DIAGS];
+	size_t count = MAX_DIAGS;
+	fru_t * fru;
+
+	fru = fru_loadbuffer_diag(NULL, buf, len, diags, &count);
+	fru_free(fru);
+
+	for (size_t i = 0; i < count && i < MAX_DIAGS; i++) {
+		const fru_errno_t * err = &diags[i].err;
+		const char * area = "fru";
+
+		if (err->src < (fru_error_source_t)FRU_TOTAL_AREAS)
+			area = area_names[err->src].json;
+
+		printf("%s,0x%zX,%s,%d,\"%s\"\n",
+		       name, diags[i].offset, area, err->index,
+		       FEGENERIC == err->code ? strerror(diags[i].errnum)
+		                              : fru_strerr(*err));
+	}
+	if (count > MAX_DIAGS)
+		warn("%s: %zu more issues not shown", name, count - MAX_DIAGS);
+
+	return !count;
+}
+
+/*
+ * Add a binary FRU image to the columnar export given in \a arg
+ */
+static
+bool export_image(const char * name, const void * buf, size_t len,
+                  const struct frugen_config_s * config, void * arg)
+{
+	if (!frugen_export_add(arg, name, buf, len, config->flags)) {
+		fru_warn("%s", name);
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Process all the entries of a FRU archive with \a scan,
+ * store them into the output archive if one is given
+ *
+ * @returns The number of entries that failed
+ */
+static
+size_t scan_archive(const char * fname, const struct frugen_config_s * config,
+                    scan_fn_t scan, void * arg)
+{
+	fru_archive_t * ar = fru_archive_open(fname);
+	size_t failed = 0;
+
+	if (!ar) {
+		fru_warn("%s", fname);
+		return 1;
+	}
+
+	for (size_t i = 0; i < fru_archive_count(ar); i++) {
+		char name[PATH_MAX];
+		const char * key;
+		const void * image;
+		size_t len;
+
+		image = fru_archive_entry(ar, i, &key, &len);
+		if (!image) {
+			fru_warn("%s, entry %zu", fname, i);
+			failed++;
+			continue;
+		}
+		snprintf(name, sizeof(name), "%s:%s", fname, key);
+		if (config->archive && !fru_archive_add(config->archive, name, image, len))
+			fru_fatal("Couldn't store %s in the archive", name);
+		if (!scan(name, image, len, config, arg))
+			failed++;
+	}
+	fru_archive_close(ar);
+
+	return failed;
+}
+
+/*
+ * Process all the given binary FRU files or archives with \a scan.
+ * Store the files into the output archive if one is given.
+ *
+ * @returns The number of files (archive entries) that failed
+ */
+static
+size_t scan_files(char * const files[], size_t count,
+                  const struct frugen_config_s * config,
+                  scan_fn_t scan, void * arg)
+{
+	static uint8_t buf[64 * 1024];
+	size_t failed = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		ssize_t len;
+		int fd;
+
+		fd = open(files[i], O_RDONLY);
+		if (fd < 0) {
+			warn("Failed to open %s: %m", files[i]);
+			failed++;
+			continue;
+		}
+		len = read(fd, buf, sizeof(buf));
+		close(fd);
+		if (len < 0) {
+			warn("Failed to read %s: %m", files[i]);
+			failed++;
+			continue;
+		}
+
+		if (fru_is_archive(buf, len)) {
+			failed += scan_archive(files[i], config, scan, arg);
+			continue;
+		}
+
+		if (config->archive && !fru_archive_add(config->archive, files[i], buf, len))
+			fru_fatal("Couldn't store %s in the archive", files[i]);
+
+		if (!scan(files[i], buf, len, config, arg))
+			failed++;
+	}
+
+	return failed;
+}
+
 void print_info_area(FILE ** fp, const fru_t * fru, fru_area_type_t atype)
 {
 	const char * const aname = area_names[atype].human;
@@ -848,6 +1610,38 @@ void print_info_area(FILE ** fp, const fru_t * fru, fru_area_type_t atype)
 	printf("\n");
 }
 
+/* Print all fields of a typed (numeric) MR record */
+static
+void print_mr_typed(FILE * fp, const fru_mr_rec_t * mr_rec, const char * prefix)
+{
+	const frugen_mr_typed_t * typed = frugen_mr_typed_by_type(mr_rec->type);
+
+	if (!typed)
+		fatal("BUG!!! MR record type %d is not described", mr_rec->type);
+
+	for (size_t i = 0; i < typed->count; i++) {
+		const frugen_mr_field_t * f = &typed->fields[i];
+		int64_t val;
+
+		if (FRUGEN_MRF_HEX == f->kind) {
+			fprintf(fp, "%s%-46s: %s\n", prefix, f->name.human,
+			        (const char *)mr_rec + f->offset);
+			continue;
+		}
+
+		val = frugen_mr_field_get(mr_rec, f);
+		switch (f->kind) {
+		case FRUGEN_MRF_BOOL:
+		case FRUGEN_MRF_FLAG:
+			fprintf(fp, "%s%-46s: %s\n", prefix, f->name.human, val ? "yes" : "no");
+			break;
+		default:
+			fprintf(fp, "%s%-46s: %" PRIi64 "\n", prefix, f->name.human, val);
+			break;
+		}
+	}
+}
+
 void print_mr_area(FILE ** fp, size_t mr_index, fru_mr_rec_t * mr_rec)
 {
 	fru_mr_mgmt_type_t subtype = mr_rec->mgmt.subtype;
@@ -875,6 +1669,16 @@ void print_mr_area(FILE ** fp, size_t mr_index, fru_mr_rec_t * mr_rec)
 	case FRU_MR_RAW:
 		mr_raw_dump(*fp, mr_rec, "       ");
 		break;
+	case FRU_MR_PSU_INFO:
+	case FRU_MR_DC_OUT:
+	case FRU_MR_DC_LOAD:
+	case FRU_MR_EXT_DC_OUT:
+	case FRU_MR_EXT_DC_LOAD:
+	case FRU_MR_NVME:
+	case FRU_MR_NVME_PCIE_PORT:
+	case FRU_MR_NVME_TOPOLOGY:
+		print_mr_typed(*fp, mr_rec, "       ");
+		break;
 	case FRU_MR_MGMT_ACCESS:
 		fprintf(*fp,
 		        "       Subtype %d: %s (%s)\n",
@@ -905,7 +1709,7 @@ void print_area(FILE ** fp, const fru_t * fru, fru_area_type_t atype)
 
 	switch(atype) {
 	case FRU_INTERNAL_USE:
-		fhexstrdump(*fp, "   ", fru->internal);
+		fhexdump(*fp, "   ", fru->internal.data, fru->internal.size);
 		printf("\n");
 		break;
 
@@ -969,7 +1773,7 @@ void save_to_text_file(FILE ** fp, const char * fname,
 	}
 }
 
-void frugen_update_uuid(fru_t * fru, const char * s)
+bool frugen_set_uuid(fru_t * fru, const char * s)
 {
 	fru_mr_rec_t mr = {
 		.type = FRU_MR_MGMT_ACCESS,
@@ -990,22 +1794,262 @@ void frugen_update_uuid(fru_t * fru, const char * s)
 
 	if (!old_mr) {
 		/* No UUID yet, add one */
-		if (!fru_add_mr(fru, FRU_LIST_TAIL, &mr)) {
-			fru_fatal("Couln't add UUID");
-		}
+		return !!fru_add_mr(fru, FRU_LIST_TAIL, &mr);
 	}
-	else {
-		/* An UUID record is already present, update it */
-		if (!fru_replace_mr(fru, index, &mr)) {
-			fru_fatal("Couln't replace UUID");
-		}
+
+	/* An UUID record is already present, update it */
+	return !!fru_replace_mr(fru, index, &mr);
+}
+
+void frugen_update_uuid(fru_t * fru, const char * s)
+{
+	if (!frugen_set_uuid(fru, s))
+		fru_fatal("Couldn't set UUID");
+}
+
+/*
+ * Allocate a new decoded FRU file structure instance,
+ * set some defaults that are not zeroes.
+ */
+static
+fru_t * new_fru(void)
+{
+	fru_t * fru = fru_init(NULL);
+
+	if (!fru)
+		fru_fatal("Failed to allocate a FRU structure");
+
+	fru->chassis.type = SMBIOS_CHASSIS_UNKNOWN;
+	fru->board.lang = FRU_LANG_ENGLISH;
+	fru->board.tv_auto = true;
+	fru->product.lang = FRU_LANG_ENGLISH;
+
+	return fru;
+}
+
+static frugen_template_t * templates;
+static size_t template_count;
+
+/*
+ * Load a template for the daemon mode from a <name>=<file> argument
+ * and keep it in the form it would be decoded back from the binary
+ */
+static
+void preload_template(char * arg)
+{
+	struct frugen_config_s tconfig = config;
+	frugen_template_t * t;
+	char * fname = strchr(arg, '=');
+	fru_t * fru;
+
+	if (!fname || fname == arg || !fname[1])
+		fatal("Template must be given as <name>=<file>");
+	*fname++ = 0;
+
+	size_t len = strlen(fname);
+	tconfig.format = FRUGEN_FMT_BINARY;
+	if (len > 5 && !strcmp(fname + len - 5, ".frut"))
+		tconfig.format = FRUGEN_FMT_TEMPLATE;
+#ifdef __HAS_JSON__
+	if (len > 5 && !strcmp(fname + len - 5, ".json"))
+		tconfig.format = FRUGEN_FMT_JSON;
+	if (len > 5 && !strcmp(fname + len - 5, ".cbor"))
+		tconfig.format = FRUGEN_FMT_CBOR;
+#endif
+
+	t = realloc(templates, (template_count + 1) * sizeof(*templates));
+	if (!t)
+		fatal("Out of memory");
+	templates = t;
+	t = &templates[template_count];
+
+	fru = new_fru();
+	load_fromfile(fname, &tconfig, fru);
+	if (!fru_validate(fru) || !fru_normalize(fru))
+		fru_fatal("Failed to encode template '%s'", arg);
+	t->fru = fru;
+
+	t->name = strdup(arg);
+	if (!t->name)
+		fatal("Out of memory");
+	template_count++;
+	debug(1, "Template '%s' preloaded from %s", arg, fname);
+}
+
+/* The options with generator expressions, applied per unit */
+typedef struct {
+	int opt;
+	const char * arg;
+} deferred_opt_t;
+
+static deferred_opt_t * deferred;
+static size_t deferred_count;
+
+static
+void defer_option(int opt, const char * arg)
+{
+	deferred_opt_t * d = realloc(deferred, (deferred_count + 1) * sizeof(*deferred));
+
+	if (!d)
+		fatal("Out of memory");
+	deferred = d;
+	deferred[deferred_count++] = (deferred_opt_t){ .opt = opt, .arg = arg };
+	debug(2, "Option '-%c %s' will be applied per unit", opt, arg);
+}
+
+/*
+ * Expand the generator expressions in a deferred
+ * option for the given unit and apply it
+ */
+static
+void apply_generated(fru_t * fru, const deferred_opt_t * d, size_t unit)
+{
+	char value[FRUGEN_GEN_MAXLEN];
+	char err[256];
+	fieldopt_t fieldopt;
+	const char * failure;
+
+	if (!frugen_gen_expand(value, sizeof(value), d->arg, unit, err, sizeof(err)))
+		fatal("%s", err);
+
+	switch (d->opt) {
+	case 'U':
+		frugen_update_uuid(fru, value);
+		break;
+	case 's':
+		fieldopt = arg_to_fieldopt(value);
+		if (!frugen_apply_fieldopt(fru, &fieldopt, &failure))
+			fru_fatal("%s", failure);
+		break;
+	default:
+		fatal("BUG!!! Option '-%c' can't be deferred", d->opt);
+	}
+}
+
+/*
+ * Save the FRU information to a file in the configured output format
+ */
+static
+void save_output(const char * fname, fru_t * fru)
+{
+	FILE * fp = NULL;
+
+	if (config.archive) {
+		debug(1, "FRU info data will be stored in the archive as '%s'", fname);
+		if (!fru_archive_save(config.archive, fname, fru))
+			fru_fatal("Couldn't save binary FRU as '%s' in the archive", fname);
+		return;
+	}
+
+	if (!strcmp("-", fname)) {
+		if (config.outformat == FRUGEN_FMT_BINARY)
+#ifdef __HAS_JSON__
+			config.outformat = FRUGEN_FMT_JSON;
+#else
+			config.outformat = FRUGEN_FMT_TEXTOUT;
+#endif
+
+		fp = stdout;
+		debug(1, "FRU info data will be output to stdout");
+	}
+	else
+		debug(1, "FRU info data will be stored in %s", fname);
+
+	switch (config.outformat) {
+#ifdef __HAS_JSON__
+	case FRUGEN_FMT_JSON:
+		save_to_json_file(&fp, fname, fru, JSOUT_PRETTY);
+		break;
+	case FRUGEN_FMT_JSON_COMPACT:
+		save_to_json_file(&fp, fname, fru, JSOUT_COMPACT);
+		break;
+	case FRUGEN_FMT_CBOR:
+		save_to_json_file(&fp, fname, fru, JSOUT_CBOR);
+		break;
+#endif
+	case FRUGEN_FMT_TEXTOUT:
+		save_to_text_file(&fp, fname, fru);
+		break;
+
+	default:
+	case FRUGEN_FMT_BINARY:
+		if (!fru_savefile(fname, fru))
+			fru_fatal("Couldn't save binary FRU as %s", fname);
 	}
 }
 
+/*
+ * Drop the archive on any exit but the one after finish_archive(),
+ * including fatal errors, so that a failed run leaves the archive
+ * as it was
+ */
+static
+void discard_archive(void)
+{
+	if (config.archive)
+		fru_archive_discard(config.archive);
+	config.archive = NULL;
+}
+
+/*
+ * Open the output archive given with '-A', if any,
+ * when all the options are checked
+ */
+static
+void open_archive(void)
+{
+	if (!config.archive_file)
+		return;
+
+	config.archive = fru_archive_create(config.archive_file, true);
+	if (!config.archive)
+		fru_fatal("Couldn't open FRU archive %s", config.archive_file);
+	atexit(discard_archive);
+	debug(1, "Output will be stored in archive %s", config.archive_file);
+}
+
+/*
+ * Write the index of the output archive when all the output is stored
+ */
+static
+void finish_archive(void)
+{
+	fru_archive_t * ar = config.archive;
+
+	config.archive = NULL;
+	if (ar && !fru_archive_close(ar))
+		fru_fatal("Failed to finalize the archive %s", config.archive_file);
+}
+
+#ifdef FRU_EMBEDDED
+/* The embedded libfru doesn't use the heap unless it is told to */
+static
+void * heap_malloc(size_t size, void * data __attribute__((unused)))
+{
+	return malloc(size);
+}
+
+static
+void * heap_realloc(void * ptr, size_t size, void * data __attribute__((unused)))
+{
+	return realloc(ptr, size);
+}
+
+static
+void heap_free(void * ptr, void * data __attribute__((unused)))
+{
+	free(ptr);
+}
+
+static const fru_allocator_t heap_allocator = {
+	heap_malloc, heap_realloc, heap_free, NULL
+};
+#endif
+
 int main(int argc, char * argv[])
 {
 	size_t i;
-	FILE * fp = NULL;
+	size_t failed;
 	int opt;
 	int lindex;
 	fieldopt_t fieldopt = {};
@@ -1013,20 +2057,16 @@ int main(int argc, char * argv[])
 	// Prevent intermixing of stderr and stdout outputs
 	setbuf(stdout, NULL);
 
+#ifdef FRU_EMBEDDED
+	fru_set_allocator(&heap_allocator);
+#endif
+
 	/*
-	 * Allocate a new decoded FRU file structure instance,
-	 * set some defaults that are not zeroes.
-	 *
 	 * Its contents are to be filled further by command line options
 	 * or overwritten by an input template file.
 	 */
-	fru_t * fru = fru_init(NULL);
-	fru->chassis.type = SMBIOS_CHASSIS_UNKNOWN;
-	fru->board.lang = FRU_LANG_ENGLISH;
-	fru->board.tv_auto = true;
-	fru->product.lang = FRU_LANG_ENGLISH;
+	fru_t * fru = new_fru();
 
-	const char * fname = NULL;
 
 	char optstring[FRU_ARRAY_SZ(options) * 2 + 1] = {0};
 
@@ -1090,8 +2130,20 @@ int main(int argc, char * argv[])
 				debug(1, "Using JSON input format");
 				load_fromfile(optarg, &config, fru);
 				break;
+
+			case 'c': // cbor
+				config.format = FRUGEN_FMT_CBOR;
+				debug(1, "Using CBOR input format");
+				load_fromfile(optarg, &config, fru);
+				break;
 #endif
 
+			case 'T': // compiled template
+				config.format = FRUGEN_FMT_TEMPLATE;
+				debug(1, "Using compiled template input format");
+				load_fromfile(optarg, &config, fru);
+				break;
+
 			case 'r': // raw binary
 				config.format = FRUGEN_FMT_BINARY;
 				debug(1, "Using RAW binary input format");
@@ -1099,10 +2151,77 @@ int main(int argc, char * argv[])
 				load_fromfile(optarg, &config, fru);
 				break;
 
+			case 'A': // archive
+				if (config.archive_file)
+					fatal("Only one output archive may be specified");
+				config.archive_file = optarg;
+				break;
+
+#ifdef __HAS_JSON__
+			case 'm': // manifest
+				config.manifest = optarg;
+				break;
+#endif
+
+			case 'P': // date-policy
+				if (!strcmp(optarg, "now")) {
+					fru_set_date_policy(FRU_DATE_NOW, 0);
+				}
+				else if (!strcmp(optarg, "lot")) {
+					/* Freeze the time for all the units */
+					if (!fru_set_date_policy(FRU_DATE_FIXED, time(NULL)))
+						fru_fatal("Failed to set the board date for the lot");
+				}
+				else if (!strcmp(optarg, "manifest")) {
+					config.date_from_manifest = true;
+				}
+				else if (!strcmp(optarg, "source")) {
+					if (!fru_set_date_policy(FRU_DATE_SOURCE_EPOCH, 0))
+						fru_fatal("Invalid or missing SOURCE_DATE_EPOCH");
+				}
+				else {
+					fatal("Invalid date policy '%s'", optarg);
+				}
+				break;
+
+			case 'k': // archive-key
+				config.archive_key = optarg;
+				break;
+
+			case 'D': // daemon
+				config.daemon = optarg;
+				break;
+
+			case 'p': // preload
+				preload_template(optarg);
+				break;
+
+			case 'C': // compile-template
+				config.outformat = FRUGEN_FMT_TEMPLATE;
+				break;
+
+			case 'N': // nvme-scan
+				config.nvme_scan = true;
+				break;
+
+			case 'E': // export
+				config.export = optarg;
+				break;
+
+			case 'F': // fix-checksums
+				config.fix_checksums = true;
+				break;
+
+			case 'I': // diagnose
+				config.diagnose = true;
+				break;
+
 			case 'o': { // out-format
-				const char * const outfmt[] = {
+				const char * const outfmt[FRUGEN_FMT_LAST + 1] = {
 #ifdef __HAS_JSON__
 					[FRUGEN_FMT_JSON] = "json",
+					[FRUGEN_FMT_JSON_COMPACT] = "json-compact",
+					[FRUGEN_FMT_CBOR] = "cbor",
 #endif
 					[FRUGEN_FMT_BINARY] = "binary",
 					[FRUGEN_FMT_TEXTOUT] = "text",
@@ -1124,76 +2243,15 @@ int main(int argc, char * argv[])
 				break;
 
 			case 's': { // set field
-				/* We intentionally waste some memory on these sparse arrays
-				 * for the sake of data/code separation */
-				fru_field_t * const fields[FRU_TOTAL_AREAS][FRU_MAX_FIELD_COUNT] = {
-					[FRU_CHASSIS_INFO] = {
-						[FRU_CHASSIS_PARTNO] = &fru->chassis.pn,
-						[FRU_CHASSIS_SERIAL] = &fru->chassis.serial,
-					},
-					[FRU_BOARD_INFO] = {
-						[FRU_BOARD_MFG] = &fru->board.mfg,
-						[FRU_BOARD_PRODNAME] = &fru->board.pname,
-						[FRU_BOARD_SERIAL] = &fru->board.serial,
-						[FRU_BOARD_PARTNO] = &fru->board.pn,
-						[FRU_BOARD_FILE] = &fru->board.file,
-					},
-					[FRU_PRODUCT_INFO] = {
-						[FRU_PROD_MFG] = &fru->product.mfg,
-						[FRU_PROD_NAME] = &fru->product.pname,
-						[FRU_PROD_MODELPN] = &fru->product.pn,
-						[FRU_PROD_VERSION] = &fru->product.ver,
-						[FRU_PROD_SERIAL] = &fru->product.serial,
-						[FRU_PROD_ASSET] = &fru->product.atag,
-						[FRU_PROD_FILE] = &fru->product.file,
-					},
-				};
+				const char * failure;
 
-				/* Now do the actual job and set data in the appropriate locations */
-				fieldopt = arg_to_fieldopt(optarg); // This will fail() on non-info areas
-				fru_field_t * field = NULL;
-				if (fieldopt.field.index != FRU_FIELD_CUSTOM)
-					field = fields[fieldopt.area][fieldopt.field.index];
-				else {
-					if (fieldopt.custom_index != FRU_LIST_HEAD
-					    && fieldopt.custom_index != FRU_LIST_TAIL)
-					{
-						if (fieldopt.custom_insert) {
-							// here custom_index is a 1-based index of the field
-							debug(3, "Inserting a custom field at position %d",
-							      fieldopt.custom_index);
-							field = fru_add_custom(fru, fieldopt.area,
-							                       LIST_INDEX_LIBFRU(fieldopt.custom_index),
-							                       FRU_FE_EMPTY, NULL);
-						}
-						else {
-							// here custom_index is a 1-based index of the field
-							debug(3, "Modifying custom field %d. New value is [%s]",
-							      fieldopt.custom_index, fieldopt.value);
-							field = fru_get_custom(fru, fieldopt.area,
-							                       LIST_INDEX_LIBFRU(fieldopt.custom_index));
-						}
-						if (!field) {
-							fru_fatal("Custom field %d not found in specified area",
-							          LIST_INDEX_FRUGEN(fieldopt.custom_index));
-						}
-					}
-					else {
-						// custom_index is either FRU_LIST_HEAD or FRU_LIST_TAIL here
-						debug(3, "Adding a custom field to the start or end of the list");
-						field = fru_add_custom(fru, fieldopt.area, fieldopt.custom_index, FRU_FE_EMPTY, NULL);
-						if (!field) {
-							fru_fatal("Failed to add a custom field");
-						}
-
-					}
-				}
-				debug(3, "Setting the custom field to [%s]", fieldopt.value);
-				if(!fru_setfield(field, fieldopt.type, fieldopt.value)) {
-					fru_fatal("Failed to add custom field value '%s'", fieldopt.value);
+				if (frugen_gen_has_expr(optarg)) {
+					defer_option(opt, optarg);
+					break;
 				}
-				// Don't care about errors. The area is either enabled now or was enabled before.
-				fru_enable_area(fru, fieldopt.area, FRU_APOS_AUTO);
+				fieldopt = arg_to_fieldopt(optarg); // This will fail() on non-info areas
+				if (!frugen_apply_fieldopt(fru, &fieldopt, &failure))
+					fru_fatal("%s", failure);
 				break;
 			}
 
@@ -1215,7 +2273,29 @@ int main(int argc, char * argv[])
 				fru->board.tv_auto = false;
 				break;
 			case 'U': {
-				frugen_update_uuid(fru, optarg);
+				if (frugen_gen_has_expr(optarg))
+					defer_option(opt, optarg);
+				else
+					frugen_update_uuid(fru, optarg);
+				break;
+			}
+			case 'n': { // count
+				char * end;
+
+				errno = 0;
+				config.count = strtoul(optarg, &end, 0);
+				if (errno || *end || !config.count)
+					fatal("Invalid unit count '%s'", optarg);
+				break;
+			}
+			case 'S': { // seed
+				char * end;
+
+				errno = 0;
+				uint64_t seed = strtoull(optarg, &end, 0);
+				if (errno || *end)
+					fatal("Invalid seed '%s'", optarg);
+				frugen_gen_seed(seed);
 				break;
 			}
 			case '?':
@@ -1225,58 +2305,155 @@ int main(int argc, char * argv[])
 		}
 	} while (opt != -1);
 
-	// Now as we've loaded everything, validate it by passing through
-	// libfru encoder and decoder
-	size_t fullsize = 0;
-	uint8_t *frubuf = NULL;
-	struct timeval orig_tv = fru->board.tv;
-	bool orig_tv_auto = fru->board.tv_auto;
-	if (!fru_savebuffer((void **)&frubuf, &fullsize, fru)) {
-		fru_fatal("Failed to encode the provided data");
+	if (config.daemon) {
+		if (!template_count)
+			fatal("At least one template must be preloaded with '-p'");
+		fru_free(fru);
+		exit(frugen_daemon(config.daemon, templates, template_count));
 	}
-	fru_free(fru);
-	fru = fru_loadbuffer(NULL, frubuf, fullsize, FRU_NOFLAGS);
-	if (!fru) {
-		fru_fatal("Failed to decode the FRU encoded from provided data");
+
+	if (config.nvme_scan) {
+		if (optind >= argc)
+			fatal("At least one file name must be specified");
+		fru_free(fru);
+		open_archive();
+		printf("file,formfactor,capacity\n");
+		failed = scan_files(&argv[optind], argc - optind, &config,
+		                    nvme_scan_image, NULL);
+		finish_archive();
+		exit(!!failed);
+	}
+
+	if (config.diagnose) {
+		if (optind >= argc)
+			fatal("At least one file name must be specified");
+		fru_free(fru);
+		open_archive();
+		printf("file,offset,area,index,error\n");
+		failed = scan_files(&argv[optind], argc - optind, &config,
+		                    diag_image, NULL);
+		finish_archive();
+		exit(!!failed);
+	}
+
+	if (config.fix_checksums) {
+		if (optind >= argc)
+			fatal("At least one file or directory name must be specified");
+		fru_free(fru);
+		exit(!!frugen_fix_checksums(&argv[optind], argc - optind));
+	}
+
+	if (config.export) {
+		frugen_export_t * ex = frugen_export_new();
+
+		if (optind >= argc)
+			fatal("At least one file name must be specified");
+		fru_free(fru);
+		open_archive();
+		failed = scan_files(&argv[optind], argc - optind, &config,
+		                    export_image, ex);
+		finish_archive();
+		frugen_export_save(ex, config.export);
+		frugen_export_free(ex);
+		exit(!!failed);
+	}
+
+	// Now as we've loaded everything, make sure it can be encoded
+	if (!fru_validate(fru)) {
+		fru_fatal("Failed to encode the provided data");
 	}
-	fru->board.tv_auto = orig_tv_auto;
-	fru->board.tv = orig_tv;
 
 	/* Generate the output */
 	if (optind >= argc)
 		fatal("Filename must be specified");
 
-	fname = argv[optind];
+	if (config.archive_file && config.outformat != FRUGEN_FMT_BINARY)
+		fatal("Only binary output can be stored in an archive");
+
+	if (config.outformat == FRUGEN_FMT_TEMPLATE) {
+		if (config.count > 1 || config.manifest || deferred_count)
+			fatal("Generator options can't be used with '-C'");
+		if (!strcmp(argv[optind], "-"))
+			fatal("Compiled templates can't be written to stdout");
+		/* Save the data as loaded to keep the 'auto' encodings as they are */
+		if (!fru_template_save(argv[optind], fru))
+			fru_fatal("Couldn't save compiled template as %s", argv[optind]);
+		debug(1, "Compiled template saved to %s", argv[optind]);
+		fru_free(fru);
+		exit(0);
+	}
+
+	/* Make the units start with the data as they are saved */
+	if (!fru_normalize(fru)) {
+		fru_fatal("Failed to encode the provided data");
+	}
+
+	if ((config.count > 1 || config.manifest)
+	    && (config.archive_file || strcmp(argv[optind], "-"))
+	    && !frugen_gen_has_expr(argv[optind]))
+	{
+		fatal("File name must contain a generator expression for '-n' or '-m'");
+	}
 
-	if (!strcmp("-", fname)) {
-		if (config.outformat == FRUGEN_FMT_BINARY)
 #ifdef __HAS_JSON__
-			config.outformat = FRUGEN_FMT_JSON;
-#else
-			config.outformat = FRUGEN_FMT_TEXTOUT;
+	frugen_manifest_t * manifest = NULL;
+	if (config.manifest) {
+		if (config.count > 1)
+			fatal("Options '-n' and '-m' are mutually exclusive");
+		manifest = frugen_manifest_open(config.manifest);
+	}
 #endif
+	if (config.date_from_manifest && !config.manifest)
+		fatal("Date policy 'manifest' requires '-m'");
 
-		fp = stdout;
-		debug(1, "FRU info data will be output to stdout");
-	}
-	else
-		debug(1, "FRU info data will be stored in %s", fname);
+	open_archive();
+
+	/* Every unit is derived from the loaded data */
+	fru_t * tmpl = fru;
+
+	for (size_t unit = 0; ; unit++) {
+		char err[256];
+		char name[FRUGEN_GEN_MAXLEN];
+
+		fru = fru_derive(tmpl);
+		if (!fru) {
+			fru_fatal("Failed to derive a FRU from the template");
+		}
 
-	switch (config.outformat) {
 #ifdef __HAS_JSON__
-	case FRUGEN_FMT_JSON:
-		save_to_json_file(&fp, fname, fru);
-		break;
+		if (manifest) {
+			/* Every line must bring its own date */
+			if (config.date_from_manifest)
+				fru->board.tv_auto = true;
+			if (!frugen_manifest_apply(manifest, fru)) {
+				fru_free(fru);
+				break;
+			}
+			if (config.date_from_manifest && fru->board.tv_auto)
+				fatal("No board date in the manifest for unit %zu", unit);
+		}
 #endif
-	case FRUGEN_FMT_TEXTOUT:
-		save_to_text_file(&fp, fname, fru);
-		break;
+		if (!config.manifest && unit == config.count) {
+			fru_free(fru);
+			break;
+		}
 
-	default:
-	case FRUGEN_FMT_BINARY:
-		if (!fru_savefile(fname, fru))
-			fru_fatal("Couldn't save binary FRU as %s", fname);
+		for (i = 0; i < deferred_count; i++)
+			apply_generated(fru, &deferred[i], unit);
+
+		if (!frugen_gen_expand(name, sizeof(name), argv[optind], unit,
+		                       err, sizeof(err)))
+		{
+			fatal("%s", err);
+		}
+		save_output(name, fru);
+		fru_free(fru);
 	}
+	fru_free(tmpl);
+	finish_archive();
 
-	fru_free(fru);
+#ifdef __HAS_JSON__
+	if (manifest)
+		frugen_manifest_close(manifest);
+#endif
 }
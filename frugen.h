@@ -9,6 +9,7 @@
 #pragma once
 
 #include <errno.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <unistd.h>
 
@@ -23,14 +24,28 @@ typedef enum {
 	FRUGEN_FMT_FIRST,
 	FRUGEN_FMT_JSON = FRUGEN_FMT_FIRST,
 	FRUGEN_FMT_BINARY,
+	FRUGEN_FMT_TEMPLATE, /* Compiled template, see fru_template_save() */
+	FRUGEN_FMT_CBOR,
 	FRUGEN_FMT_TEXTOUT, /* Output format only */
-	FRUGEN_FMT_LAST = FRUGEN_FMT_TEXTOUT
+	FRUGEN_FMT_JSON_COMPACT, /* Output format only */
+	FRUGEN_FMT_LAST = FRUGEN_FMT_JSON_COMPACT
 } frugen_format_t;
 
 struct frugen_config_s {
 	frugen_format_t format;
 	frugen_format_t outformat;
 	fru_flags_t flags;
+	bool nvme_scan; ///< Only scan the input files for NVMe records, see `-N`
+	const char * export; ///< Columnar file to decode the input files into, see `-E`
+	bool fix_checksums; ///< Only fix the checksums of the input files, see `-F`
+	bool diagnose; ///< Only report the issues of the input files, see `-I`
+	const char * daemon; ///< Socket path to serve requests on, see `-D`
+	size_t count; ///< Number of units to generate, see `-n`
+	const char * archive_file; ///< Archive to write the output to, see `-A`
+	fru_archive_t * archive; ///< The open `archive_file`, see open_archive()
+	const char * archive_key; ///< Archive entry to load with `-r`, see `-k`
+	const char * manifest; ///< JSONL file with per-unit data, see `-m`
+	bool date_from_manifest; ///< Every unit must get its date from `-m`, see `-P`
 };
 
 typedef struct {
@@ -44,6 +59,50 @@ extern const size_t field_max[FRU_TOTAL_AREAS];
 extern const frugen_name_t * const field_name[FRU_TOTAL_AREAS];
 extern const frugen_name_t frugen_mr_mgmt_name[FRU_MR_MGMT_INDEX_COUNT];
 
+/** Kinds of numeric fields in typed (non-string) MR records */
+typedef enum {
+	FRUGEN_MRF_UINT, ///< Unsigned integer of any size
+	FRUGEN_MRF_SINT, ///< Signed integer of any size
+	FRUGEN_MRF_BOOL, ///< A `bool`
+	FRUGEN_MRF_FLAG, ///< A bit (`mask`) in an unsigned integer
+	FRUGEN_MRF_HEX, ///< A hex string (char array), not a number
+} frugen_mrf_kind_t;
+
+/** A field of a typed MR record in fru_mr_rec_t */
+typedef struct {
+	frugen_name_t name;
+	frugen_mrf_kind_t kind;
+	size_t offset; ///< Offset of the field in fru_mr_rec_t
+	size_t size; ///< Size of the field in bytes
+	uint32_t mask; ///< The flag bit for FRUGEN_MRF_FLAG
+} frugen_mr_field_t;
+
+/** Description of a typed MR record that consists of numeric (and hex) fields only */
+typedef struct {
+	fru_mr_type_t type;
+	frugen_name_t name;
+	const frugen_mr_field_t * fields;
+	size_t count;
+} frugen_mr_typed_t;
+
+/**
+ * Find a typed MR record description by record type or by JSON name
+ *
+ * @returns A pointer to the description or NULL if not found
+ */
+const frugen_mr_typed_t * frugen_mr_typed_by_type(fru_mr_type_t type);
+const frugen_mr_typed_t * frugen_mr_typed_by_name(const char * name);
+
+/** Get a numeric field value from a typed MR record, not for FRUGEN_MRF_HEX */
+int64_t frugen_mr_field_get(const fru_mr_rec_t * rec, const frugen_mr_field_t * f);
+
+/**
+ * Set a numeric field value in a typed MR record, not for FRUGEN_MRF_HEX
+ *
+ * @retval false The value doesn't fit the field
+ */
+bool frugen_mr_field_set(fru_mr_rec_t * rec, const frugen_mr_field_t * f, int64_t val);
+
 void fru_perror(FILE *fp, const char *fmt, ...);
 
 #define fatal(fmt, args...) do { \
@@ -136,6 +195,38 @@ void tv_to_datestr(char *datestr, const struct timeval *tv, bool include_timezon
  */
 fieldopt_t arg_to_fieldopt(char *arg);
 
+/**
+ * Same as arg_to_fieldopt(), but doesn't terminate the program.
+ *
+ * @param[out] fopt The parsed option
+ * @param[in,out] arg The argument string, is modified
+ * @param[out] err The buffer for the error message
+ * @param[in] errlen The size of \a err
+ *
+ * @returns Success status, \a err is filled on failure
+ */
+bool frugen_parse_fieldopt(fieldopt_t * fopt, char * arg, char * err, size_t errlen);
+
+/**
+ * Apply a parsed `--set` option to a FRU information structure
+ *
+ * @param[out] failure Description of the failure, \ref fru_errno is also set
+ *
+ * @returns Success status
+ */
+bool frugen_apply_fieldopt(fru_t * fru, const fieldopt_t * fieldopt,
+                           const char ** failure);
+
+/**
+ * Add or update a System UUID record in MR area, sets \ref fru_errno on failure
+ */
+bool frugen_set_uuid(fru_t * fru, const char * s);
+
+/**
+ * Same as frugen_set_uuid(), but terminates the program on failure
+ */
+void frugen_update_uuid(fru_t * fru, const char * s);
+
 /**
  * Find a Management Access record subtype by its short name
  *
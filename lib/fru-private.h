@@ -14,6 +14,7 @@
 #pragma once
 
 #include "fru.h"
+#include "../fru_errno.h"
 
 #if defined(__APPLE__)
 
@@ -29,6 +30,9 @@
 #define be32toh(x) OSSwapBigToHostInt32(x)
 #define le32toh(x) OSSwapLittleToHostInt32(x)
 
+#define htole64(x) OSSwapHostToLittleInt64(x)
+#define le64toh(x) OSSwapLittleToHostInt64(x)
+
 #else
 
 #define _BSD_SOURCE
@@ -58,6 +62,66 @@
 	fru_errno.index = idx; \
 } while(0)
 
+/*
+ * Allocation through the hooks set by fru_set_allocator(),
+ * with the same semantics as the standard functions.
+ * All the memory of the library must come from these.
+ */
+void * fru__malloc(size_t size);
+void * fru__calloc(size_t nmemb, size_t size);
+void * fru__realloc(void * ptr, size_t size);
+void fru__free(void * ptr);
+
+/* Same as zfree(), but for the memory from fru__malloc() */
+#define fru__zfree(buf) do { \
+	fru__free(buf); \
+	(buf) = NULL; \
+} while(0)
+
+/*
+ * An allocator along with the count of its live blocks,
+ * it can't be replaced while there are any
+ */
+typedef struct {
+	fru_allocator_t hooks;
+	size_t blocks;
+} fru__allocator_t;
+
+#if FRU_WITH_MR_OEM
+/* The OEM MR record codecs, a table per OEM record type */
+typedef struct {
+	struct {
+		struct fru__oem_entry_s * entries; ///< Sorted by mfg_id
+		size_t count;
+	} type[FRU_MR_OEM_COUNT];
+} fru__oem_registry_t;
+#endif
+
+/*
+ * Replace the hooks of \a allocator with a copy of \a hooks
+ * unless it has live blocks, like fru_set_allocator() does
+ */
+bool fru__set_hooks(fru__allocator_t * allocator, const fru_allocator_t * hooks);
+
+/* See fru_set_date_policy() */
+typedef struct {
+	fru_date_policy_t policy; ///< Never FRU_DATE_SOURCE_EPOCH
+	time_t date; ///< For FRU_DATE_FIXED
+} fru__date_policy_t;
+
+/* See fru_ctx_t in fru.h */
+struct fru_ctx_s {
+	fru__allocator_t allocator; ///< Not used while hooks.malloc is NULL
+	fru_errno_t err; ///< Left by the last `_r` function
+	fru__date_policy_t date;
+#if FRU_WITH_MR_OEM
+	fru__oem_registry_t oem;
+#endif
+};
+
+/* The context of the calling thread, set by fru_ctx_use() */
+extern __thread fru_ctx_t * fru__ctx;
+
 /*
  * Binary FRU file related definitions
  */
@@ -183,12 +247,22 @@ typedef struct {
 	uint8_t data[];
 } __attribute__((packed)) fru__file_mr_mgmt_rec_t;
 
+/// Section 18.7, OEM Record
+typedef struct {
+	fru__file_mr_header_t hdr;
+	uint8_t mfg_id[FRU__FILE_MRR_OEM_MFGID_LEN]; // LS byte first
+	uint8_t data[];
+} __attribute__((packed)) fru__file_mr_oem_rec_t;
+#define FRU__OEM_MFGID_MAX 0xFFFFFF
+
+#if FRU_WITH_MR_MGMT
 /*
  * Minimum and maximum lengths of values as per
  * Table 18-6, Management Access Record
  */
 extern const size_t fru__mr_mgmt_minlen[FRU_MR_MGMT_MAX];
 extern const size_t fru__mr_mgmt_maxlen[FRU_MR_MGMT_MAX];
+#endif
 /* A convenience macro to make indices into the above arrays from subtype NAMES */
 #define FRU__MGMT_TYPENAME_ID(name) FRU_MR_MGMT_SUBTYPE_TO_IDX(FRU_MR_MGMT_##name)
 
@@ -201,58 +275,101 @@ extern const size_t fru__mr_mgmt_maxlen[FRU_MR_MGMT_MAX];
 	(sizeof(((fru__file_mr_mgmt_rec_t *)NULL)->subtype) + (mgmt_size))
 
 /// Table 18-1, Power Supply Information
+/// See fru.h for public FRU_MR_PSU_* values
 typedef struct {
 	uint16_t overall_cap;
-#define FRU_MR_PSU_OCAP_MAX ((1 << 12) - 1)
-#define FRU_MR_PSU_OCAP_MASK FRU_MR_PSU_OCAP_MAX
+#define FRU__MR_PSU_OCAP_MASK FRU_MR_PSU_CAP_MAX
 	uint16_t peak_va;
-#define FRU_MR_PSU_PEAK_VA_UNSPEC 0xFFFF
 	uint8_t inrush_amp;
-#define FRU_MR_PSU_INRUSH_AMP_UNSPEC 0xFF
 	uint8_t inrush_ms;
-#define FRU_MR_PSU_INRUSH_MS_UNSPEC 0
 	int16_t lo_vin1;
 	int16_t hi_vin1;
 	int16_t lo_vin2;
 	int16_t hi_vin2;
-#define FRU_MR_PSU_VIN_SINGLE_RANGE 0
-#define FRU_MR_PSU_VIN_RANGE_STEP_mV 10
 	uint8_t lo_freq;
-#define FRU_MR_PSU_LFREQ_ACCEPTS_DC 0
 	uint8_t hi_freq;
-#define FRU_MR_PSU_HFREQ_DC_ONLY 0
 	uint8_t dropout_tolerance_ms;
 	uint8_t flags;
-#define FRU_MR_PSU_FLAGS_PREFAIL_SUPPORT (1 << 0)
-#define FRU_MR_PSU_FLAGS_PF_CORRECTION (1 << 1)
-#define FRU_MR_PSU_FLAGS_AUTOSWITCH (1 << 2)
-#define FRU_MR_PSU_FLAGS_HOTSWAP (1 << 3)
-#define FRU_MR_PSU_FLAGS_TACH_PPR (1 << 4)
-#define   FRU_MR_PSU_TACH_PPR(x) (((x)->flags & FRU_MR_PSU_FLAGS_TACH_PPR) ? 2 : 1)
-#define FRU_MR_PSU_FLAGS_PREFAIL_POL FRU_MR_PSU_FLAGS_TACH_PPR
 	uint16_t peak_watts_holdup;
-#define FRU_MR_PSU_HOLDUP_SHIFT 12
-#define FRU_MR_PSU_HOLDUP(x) ((x)->peak_watts_holdup >> FRU_MR_PSU_HOLDUP_SHIFT)
-#define FRU_MR_PSU_PEAK_WATTS_MASK ((1 << FRU_MR_PSU_HOLDUP_SHIFT) - 1)
-#define FRU_MR_PSU_PEAK_WATTS(x) ((x)->peak_watts_holdup & FRU_MR_PSU_PEAK_WATTS_MASK)
-#define FRU_MR_PSU_PEAK_WATTS_UNSPEC FRU_MR_PSU_PEAK_WATTS_MASK
+#define FRU__MR_PSU_HOLDUP_SHIFT 12
+#define FRU__MR_PSU_PEAK_WATTS_MASK ((1 << FRU__MR_PSU_HOLDUP_SHIFT) - 1)
 	struct {
 		uint8_t per_range;
-#define FRU_MR_PSU_WATTS_RANGE1_SHIFT 4
-#define FRU_MR_PSU_WATTS_RANGE2_SHIFT 0
-#define FRU_MR_PSU_WATTS_MASK ((1 << FRU_MR_PSU_WATTS_RANGE1_SHIFT) - 1)
-#define FRU_MR_PSU_WATTS_RANGE(x, r) ( \
-        	( \
-        		((x)->combined_watts.per_range) >> FRU_MR_PSU_WATTS_RANGE##r##_SHIFT \
-        	) & FRU_MR_PSU_WATTS_MASK \
-        )
+#define FRU__MR_PSU_WATTS_RANGE1_SHIFT 4
+#define FRU__MR_PSU_WATTS_RANGE2_SHIFT 0
+#define FRU__MR_PSU_WATTS_MASK ((1 << FRU__MR_PSU_WATTS_RANGE1_SHIFT) - 1)
 		uint16_t total;
 	} __attribute__((packed)) combined_watts;
 	uint8_t prefail_tach_rps;
-#define FRU_MR_PSU_PREFAIL_BINARY 0x00
-#define FRU_MR_PSU_PREFAIL_RPM(x) (((x)->prefail_tach_rps) * 60) // RPS to RPM conversion
 } __attribute__((packed)) fru__file_mr_psu_t;
 
+/// Tables 18-2 and 18-2a, DC Output and Extended DC Output
+typedef struct {
+	uint8_t info;
+#define FRU__MR_DC_OUTPUT_MASK FRU_MR_DC_OUTPUT_MAX
+#define FRU__MR_DCOUT_STANDBY (1 << 7)
+#define FRU__MR_DCOUT_100MA (1 << 4) // Extended only
+	int16_t nominal;
+	int16_t max_neg_dev;
+	int16_t max_pos_dev;
+	uint16_t ripple;
+	uint16_t min_current;
+	uint16_t max_current;
+} __attribute__((packed)) fru__file_mr_dcout_t;
+
+/// Tables 18-3 and 18-3a, DC Load and Extended DC Load
+typedef struct {
+	uint8_t info;
+#define FRU__MR_DCLOAD_100MA (1 << 7) // Extended only
+	int16_t nominal;
+	int16_t min_voltage;
+	int16_t max_voltage;
+	uint16_t ripple;
+	uint16_t min_current;
+	uint16_t max_current;
+} __attribute__((packed)) fru__file_mr_dcload_t;
+
+/*
+ * NVMe-MI 1.2b, Figures 159, 161 and 162. Only the mandatory parts are
+ * described here, any trailing reserved bytes are ignored on decoding.
+ */
+typedef struct {
+	uint8_t version;
+	uint8_t formfactor;
+	uint8_t p1v8_init;
+	uint8_t p1v8_max;
+	uint8_t p3v3_init;
+	uint8_t p3v3_max;
+	uint8_t p3v3_aux_max;
+	uint8_t p5v_init;
+	uint8_t p5v_max;
+	uint8_t p12v_init;
+	uint8_t p12v_max;
+	uint8_t ptherm_max;
+	struct {
+		uint64_t lo;
+		uint32_t mid;
+		uint8_t hi;
+	} __attribute__((packed)) capacity;
+} __attribute__((packed)) fru__file_mr_nvme_t;
+
+typedef struct {
+	uint8_t version;
+	uint8_t port;
+	uint8_t info;
+	uint8_t speeds;
+	uint8_t max_width;
+	uint8_t mctp;
+	uint8_t refclk;
+	uint8_t port_id;
+} __attribute__((packed)) fru__file_mr_nvme_pcie_t;
+
+typedef struct {
+	uint8_t version;
+	uint8_t count;
+	uint8_t data[];
+} __attribute__((packed)) fru__file_mr_nvme_topo_t;
+
 /**
  * Generic FRU info area description structure.
  *
@@ -285,6 +402,86 @@ typedef union __attribute__((packed)) {
 	};
 } fru__uuid_t;
 
+/*
+ * FRU archive layout, see fru_archive_create().
+ *
+ * The file starts with fru__archive_hdr_t, followed by the images,
+ * each padded to FRU__ARCHIVE_ALIGN bytes. Then goes the index,
+ * an array of fru__archive_idx_t sorted by key, then the string
+ * table with NUL-terminated keys, and finally fru__archive_tail_t.
+ * All numbers are little-endian.
+ */
+#define FRU__ARCHIVE_MAGIC "FRUARCH1"
+#define FRU__ARCHIVE_TAIL_MAGIC "FRUAIDX1"
+#define FRU__ARCHIVE_ALIGN 8
+
+typedef struct {
+	char magic[8]; ///< FRU__ARCHIVE_MAGIC
+	uint64_t rsvd;
+} fru__archive_hdr_t;
+
+typedef struct {
+	uint64_t offset; ///< Offset of the image from the start of file
+	uint32_t size; ///< Size of the image
+	uint32_t crc; ///< CRC-32 (IEEE 802.3) of the image
+	uint32_t key; ///< Offset of the key in the string table
+	uint32_t keylen; ///< Length of the key, not including the terminator
+} fru__archive_idx_t;
+
+typedef struct {
+	uint64_t index; ///< Offset of the index from the start of file
+	uint32_t count; ///< Number of entries in the index
+	uint32_t strsize; ///< Size of the string table
+	uint32_t crc; ///< CRC-32 of the index and the string table
+	uint32_t rsvd;
+	char magic[8]; ///< FRU__ARCHIVE_TAIL_MAGIC
+} fru__archive_tail_t;
+
+/*
+ * Compiled template layout, see fru_template_save().
+ *
+ * The file starts with fru__template_hdr_t, followed by the internal
+ * use area data, then the fields of the chassis, board and product
+ * areas, each as fru__template_field_t followed by the value without
+ * a terminator: the mandatory fields first, then the custom ones.
+ * The MR records go last, as fru_mr_rec_t structures padded
+ * to FRU__TEMPLATE_ALIGN bytes.
+ *
+ * The header numbers are little-endian. The MR records are stored
+ * in the host format, so the template is only loaded by a library
+ * built for the same byte order and with the same fru_mr_rec_t size.
+ */
+#define FRU__TEMPLATE_MAGIC "FRUTMPL1"
+#define FRU__TEMPLATE_VERSION 1
+#define FRU__TEMPLATE_ALIGN 8
+#define FRU__TEMPLATE_BYTEORDER 0x0102
+
+typedef struct {
+	char magic[8]; ///< FRU__TEMPLATE_MAGIC
+	uint16_t version; ///< FRU__TEMPLATE_VERSION
+	uint16_t byteorder; ///< FRU__TEMPLATE_BYTEORDER in the host byte order
+	uint32_t recsize; ///< sizeof(fru_mr_rec_t)
+	uint32_t size; ///< Size of the whole template
+	uint32_t crc; ///< CRC-32 of everything after the header
+	uint8_t present[FRU_TOTAL_AREAS]; ///< fru_t.present
+	uint8_t order[FRU_TOTAL_AREAS]; ///< fru_t.order
+	uint8_t chassis_type;
+	uint8_t board_lang;
+	uint8_t product_lang;
+	uint8_t tv_auto;
+	int64_t tv_sec; ///< Board date
+	int32_t tv_usec;
+	uint32_t internal; ///< Size of the internal use area data
+	uint16_t custom[FRU_TOTAL_AREAS]; ///< Custom field counts for info areas
+	uint16_t mrcount; ///< Number of MR records
+	uint16_t rsvd;
+} fru__template_hdr_t;
+
+typedef struct {
+	uint8_t enc; ///< fru_field_enc_t
+	uint8_t len; ///< Length of the value
+} fru__template_field_t;
+
 #pragma pack(pop)
 
 /*
@@ -372,11 +569,14 @@ fru__reclist_t ** fru__get_customlist(const fru_t * fru, fru_area_type_t atype);
  * allocated entry if \a head_ptr was NULL or if index was
  * \ref FRU_LIST_HEAD
  *
- * @note Doesn't allocate/add the actual data to the entry
+ * The entry comes with a zeroed record of \a recsize bytes,
+ * both taken from the storage of \a fru if it has one,
+ * see fru_init_storage().
  *
  * @returns Pointer to the added entry
  */
-void * fru__add_reclist_entry(void * head_ptr, size_t index);
+void * fru__add_reclist_entry(fru_t * fru, void * head_ptr,
+                              size_t index, size_t recsize);
 
 /**
  * Find an \a n'th record in a list.
@@ -397,8 +597,56 @@ void * fru__find_reclist_entry(void * head_ptr, void * prev, size_t index);
  *
  * Takes a pointer to any fru__genlist_t compatible list.
  * That is either fru__reclist_t ** or fru__mr_reclist_t **.
+ * The list is left empty. \a fru is the owner of the list,
+ * may be NULL for lists that don't belong to any.
  */
-bool fru__free_reclist(void * listptr);
+bool fru__free_reclist(const fru_t * fru, void * listptr);
+
+/*
+ * Free a single list entry of \a fru along with its record,
+ * returning it to the storage if it came from there.
+ * The entry must be unlinked by the caller.
+ */
+void fru__free_entry(const fru_t * fru, void * entry);
+
+/** Check if the data of an area are shared with a template, see fru_derive() */
+#define FRU__IS_SHARED(fru, atype) ((fru)->shared & FRU__BIT(atype))
+
+/*
+ * Forget the data of an area shared with a template without
+ * freeing them, leaving the area data empty in \a fru.
+ */
+void fru__drop_shared(fru_t * fru, fru_area_type_t atype);
+
+/*
+ * CRC-32 as in IEEE 802.3, zlib and many others.
+ * Pass 0 as \a crc to start a new checksum.
+ */
+uint32_t fru__crc32(uint32_t crc, const void * data, size_t len);
+
+/*
+ * Write the whole buffer to a file descriptor, retrying
+ * on interruptions. Sets fru_errno on failures.
+ */
+bool fru__write_all(int fd, const void * data, size_t len);
+
+/*
+ * Release the internal use area data of \a fru, either by freeing
+ * or by unmapping it, depending on how it was obtained.
+ */
+void fru__internal_release(fru_t * fru);
+
+/*
+ * Find a codec registered with fru_register_mr_oem() for the
+ * given OEM record type and manufacturer ID, the codecs of
+ * the current context come first. Returns NULL if none.
+ */
+const fru_mr_oem_codec_t * fru__mr_oem_codec(uint8_t type, uint32_t mfg_id);
+
+#if FRU_WITH_MR_OEM
+/* Free all the codec tables of \a reg */
+void fru__oem_registry_clear(fru__oem_registry_t * reg);
+#endif
 
 typedef enum {
 	FRU__HEX_RELAXED, // Allow delimiters in the input hex string
@@ -417,19 +665,35 @@ typedef enum {
  */
 bool fru__hexstr2bin(void * out, size_t * outsize, fru__hex_mode_t enc_mode, const char * s);
 
-/**
- * Get the FRU date/time base in seconds since UNIX Epoch
- *
- * According to IPMI FRU Information Storage Definition v1.0, rev 1.3,
- * the date/time encoded as zero designates "0:00 hrs 1/1/96",
- * see Table 11-1 "BOARD INFO AREA"
- *
- * @returns The number of seconds from UNIX Epoch to the FRU date/time base
+/*
+ * Conversions between the board dates in seconds since Epoch and
+ * the minutes since "0:00 hrs 1/1/96" stored in the board area,
+ * see Table 11-1 "BOARD INFO AREA" of IPMI FRU Information Storage
+ * Definition v1.0, rev 1.3
+ */
+#define FRU__DATE_TO_MINUTES(t) ((uint32_t)(((t) - FRU_DATE_BASE) / 60))
+#define FRU__DATE_FROM_MINUTES(m) (FRU_DATE_BASE + (time_t)(m) * 60)
+
+/*
+ * Get the date to save for a board with tv_auto set, as per
+ * the date policy of the current context or the global one
  */
-time_t fru__datetime_base(void);
+time_t fru__auto_date(void);
 
-/* FRU has 3 bytes for time in minutes since the base */
-#define FRU_DATETIME_MAX ((time_t)(0xFFFFFFLL * 60 + fru__datetime_base()))
+/*
+ * Encode the board date \a tv, or the automatic one if \a tv_auto is set,
+ * into the 3 bytes of fru__file_board_t.mfgdate at \a out, if not NULL.
+ * Fails with FEBDATE if the date is out of range.
+ */
+bool fru__encode_date(uint8_t * out, const struct timeval * tv, bool tv_auto);
+
+/**
+ * Decode a binary MR record \a srec into \a rec, which is expected
+ * to be zeroed by the caller
+ */
+bool fru__decode_mr_record(fru_mr_rec_t * rec,
+                           const fru__file_mr_rec_t * srec,
+                           fru_flags_t flags);
 
 /**
  * @brief Get a hex string representation of the supplied raw binary buffer.
@@ -24,6 +24,7 @@ void cut_tail(char *s)
 	for(i = strlen((char *)s) - 1; i >= 0 && ' ' == s[i]; i--) s[i] = 0;
 }
 
+#if FRU_WITH_ENC_BINARY
 /**
  * @brief Get a hex string representation of the supplied binary field.
  *
@@ -44,7 +45,9 @@ void decode_binary(fru_field_t *out,
 	                       out->val,
 	                       sizeof(out->val));
 }
+#endif
 
+#if FRU_WITH_ENC_BCDPLUS
 /**
  * @brief Decode BCDPLUS string.
  *
@@ -97,7 +100,9 @@ void decode_bcdplus(fru_field_t *out,
 	cut_tail(out->val);
 	DEBUG("BCD+ string of length %zd decoded: '%s'", len, out->val);
 }
+#endif
 
+#if FRU_WITH_ENC_6BIT
 /**
  * @brief Decode a 6-bit ASCII string.
  *
@@ -153,6 +158,7 @@ void decode_6bit(fru_field_t *out,
 	cut_tail(out->val);
 	DEBUG("6bit ASCII string of length %zd decoded: '%s'", len, out->val);
 }
+#endif
 
 /**
  * @brief Copy data from encoded fru__file_field_t into a plain text buffer
@@ -203,9 +209,15 @@ bool fru__decode_field(fru_field_t *out,
 	void (*decode[FRU_FE_REALCOUNT])(fru_field_t *,
 	                                  const fru__file_field_t *) =
 	{
+#if FRU_WITH_ENC_BINARY
 		[FRU_REAL_FE(FRU_FE_BINARY)] = decode_binary,
+#endif
+#if FRU_WITH_ENC_BCDPLUS
 		[FRU_REAL_FE(FRU_FE_BCDPLUS)] = decode_bcdplus,
+#endif
+#if FRU_WITH_ENC_6BIT
 		[FRU_REAL_FE(FRU_FE_6BITASCII)] = decode_6bit,
+#endif
 		[FRU_REAL_FE(FRU_FE_TEXT)] = decode_text,
 	};
 
@@ -218,8 +230,8 @@ bool fru__decode_field(fru_field_t *out,
 
 	enc = FRU__FIELD_ENC_T(field->typelen);
 
-	if (!FRU_FE_IS_REAL(enc)) {
-		DEBUG("ERROR: Field encoding type is invalid (%d)", enc);
+	if (!FRU_FE_IS_REAL(enc) || !decode[FRU_REAL_FE(enc)]) {
+		DEBUG("ERROR: Field encoding type is invalid or not supported (%d)", enc);
 		// Area and item will be adjusted by the caller
 		fru__seterr(FEBADENC, FERR_LOC_GENERAL, -1);
 		return false;
@@ -37,6 +37,9 @@ fru_field_t * fru_add_custom(fru_t * fru,
 		goto out;
 	}
 
+	if (!fru_unshare(fru, atype))
+		goto out;
+
 	fru__reclist_t ** cust = fru__get_customlist(fru, atype);
 
 	/* Before allocating any list entries check if the supplied
@@ -48,20 +51,15 @@ fru_field_t * fru_add_custom(fru_t * fru,
 	}
 
 	fru__reclist_t * custom_list = *cust;
-	fru__reclist_t * custom_entry = fru__add_reclist_entry(&custom_list, index);
+	fru__reclist_t * custom_entry = fru__add_reclist_entry(fru, &custom_list, index,
+	                                                       sizeof(fru_field_t));
 	if (!custom_entry) {
-		fru__seterr(FEGENERIC, atype, fru__fieldcount[atype] + index);
+		fru_errno.src = (fru_error_source_t)atype;
+		fru_errno.index = fru__fieldcount[atype] + index;
 		DEBUG("Failed to allocate reclist entry: %s\n", fru_strerr(fru_errno));
 		goto out;
 	}
 
-	custom_entry->rec = calloc(1, sizeof(fru_field_t));
-	if (!custom_entry->rec) {
-		DEBUG("Failed to allocate custom record: %s\n", fru_strerr(fru_errno));
-		fru__seterr(FEGENERIC, atype, fru__fieldcount[atype] + index);
-		goto out;
-	}
-
 	/* Now as everything seeems ok, copy the field into the list entry */
 	memcpy(custom_entry->rec, &field, sizeof(fru_field_t));
 	ret = custom_entry->rec;
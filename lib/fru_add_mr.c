@@ -24,34 +24,34 @@ fru_mr_rec_t * fru_add_mr(fru_t * fru, size_t index, fru_mr_rec_t * rec)
 		return NULL;
 	}
 
+	if (!fru_unshare(fru, FRU_MR))
+		return NULL;
+
 	fru__mr_reclist_t *mr_reclist_tail = NULL;
 	fru__mr_reclist_t ** mr_reclist_head = (fru__mr_reclist_t **)&fru->mr;
 
-	mr_reclist_tail = fru__add_reclist_entry(mr_reclist_head, index);
-	if (!mr_reclist_tail) {
-		fru__seterr(FEGENERIC, FERR_LOC_MR, index);
-		DEBUG("Failed to allocate MR reclist entry: %s\n", fru_strerr(fru_errno));
-		return NULL;
-	}
-
 	/*
 	 * In order for fru__free_reclist() to work properly later, we must
-	 * ensure that the new record in reclist is dynamically allocated.
+	 * ensure that the new record in reclist is allocated by the library.
 	 * That's why we don't take the user-supplied pointer, but instead
-	 * allocate a new record and copy the data.
+	 * get a new record along with the entry and copy the data.
 	 */
-	fru_mr_rec_t *newrec = calloc(1, sizeof(fru_mr_rec_t));
-	if (!newrec) {
-		fru__seterr(FEGENERIC, FERR_LOC_MR, index);
-		errno = EFAULT;
+	mr_reclist_tail = fru__add_reclist_entry(fru, mr_reclist_head, index,
+	                                         sizeof(fru_mr_rec_t));
+	if (!mr_reclist_tail) {
+		fru_errno.src = (fru_error_source_t)FERR_LOC_MR;
+		fru_errno.index = index;
+		DEBUG("Failed to allocate MR reclist entry: %s\n", fru_strerr(fru_errno));
+		return NULL;
 	}
+
+	fru_mr_rec_t *newrec = mr_reclist_tail->rec;
 	newrec->type = FRU_MR_EMPTY;
 
 	if (rec) {
 		memcpy(newrec, rec, sizeof(fru_mr_rec_t));
 	}
 
-	mr_reclist_tail->rec = newrec;
 	fru->present[FRU_MR] = true;
 	return newrec;
 }
@@ -0,0 +1,283 @@
+/** @file
+ *  @brief Implementation of the pluggable memory allocator
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+//#define DEBUG
+#include "fru-private.h"
+#include "../fru_errno.h"
+
+/*
+ * Every block starts with this header, so that it can be accounted for
+ * and returned to the allocator it came from even after fru_set_allocator()
+ * has installed a different one.
+ */
+typedef union {
+	struct {
+		fru__allocator_t * allocator;
+		size_t size; ///< Including the header
+	};
+	max_align_t align; ///< Keep the user part suitably aligned
+} header_t;
+
+#define HEADER(ptr) ((header_t *)(ptr) - 1)
+
+#ifdef FRU_EMBEDDED
+/*
+ * The embedded build must not touch the heap unless the application
+ * has installed an allocator, so any attempt is a bug to catch early
+ */
+static
+void * default_malloc(size_t size __attribute__((unused)),
+                      void * data __attribute__((unused)))
+{
+	abort();
+}
+#else
+static
+void * default_malloc(size_t size, void * data __attribute__((unused)))
+{
+	return malloc(size);
+}
+
+static
+void * default_realloc(void * ptr, size_t size, void * data __attribute__((unused)))
+{
+	return realloc(ptr, size);
+}
+#endif
+
+static
+void default_free(void * ptr, void * data __attribute__((unused)))
+{
+	free(ptr);
+}
+
+static fru__allocator_t default_allocator = {
+	.hooks = {
+		.malloc = default_malloc,
+#ifndef FRU_EMBEDDED
+		.realloc = default_realloc,
+#endif
+		.free = default_free,
+	},
+};
+
+static fru__allocator_t * current = &default_allocator;
+/* A copy of the last user allocator, the blocks keep pointers to it */
+static fru__allocator_t user_allocator;
+static fru_mem_stats_t stats;
+
+static
+void stats_add(size_t * live, size_t * peak, size_t n)
+{
+	size_t now = __atomic_add_fetch(live, n, __ATOMIC_RELAXED);
+	size_t old = __atomic_load_n(peak, __ATOMIC_RELAXED);
+
+	while (now > old
+	       && !__atomic_compare_exchange_n(peak, &old, now, true,
+	                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+static
+void stats_sub(size_t * live, size_t n)
+{
+	__atomic_sub_fetch(live, n, __ATOMIC_RELAXED);
+}
+
+// See fru.h
+bool fru_set_allocator(const fru_allocator_t * allocator)
+{
+	if (!allocator) {
+		__atomic_store_n(&current, &default_allocator, __ATOMIC_RELEASE);
+		return true;
+	}
+
+	if (!fru__set_hooks(&user_allocator, allocator))
+		return false;
+
+	__atomic_store_n(&current, &user_allocator, __ATOMIC_RELEASE);
+	return true;
+}
+
+// See fru.h
+void fru_mem_stats(fru_mem_stats_t * out)
+{
+	if (!out)
+		return;
+
+	out->bytes = __atomic_load_n(&stats.bytes, __ATOMIC_RELAXED);
+	out->allocs = __atomic_load_n(&stats.allocs, __ATOMIC_RELAXED);
+	out->peak_bytes = __atomic_load_n(&stats.peak_bytes, __ATOMIC_RELAXED);
+	out->peak_allocs = __atomic_load_n(&stats.peak_allocs, __ATOMIC_RELAXED);
+}
+
+// See fru.h
+void fru_mem_reset_peak(void)
+{
+	__atomic_store_n(&stats.peak_bytes,
+	                 __atomic_load_n(&stats.bytes, __ATOMIC_RELAXED),
+	                 __ATOMIC_RELAXED);
+	__atomic_store_n(&stats.peak_allocs,
+	                 __atomic_load_n(&stats.allocs, __ATOMIC_RELAXED),
+	                 __ATOMIC_RELAXED);
+}
+
+// See fru.h
+void fru_mem_free(void * ptr)
+{
+	fru__free(ptr);
+}
+
+/** @cond PRIVATE */
+// See fru-private.h
+bool fru__set_hooks(fru__allocator_t * allocator, const fru_allocator_t * hooks)
+{
+	if (!hooks->malloc || !hooks->free) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EINVAL;
+		return false;
+	}
+
+	/*
+	 * The blocks allocated earlier are still freed with the allocator
+	 * they point to, so it can only be replaced when it isn't in use.
+	 */
+	if (__atomic_load_n(&allocator->blocks, __ATOMIC_RELAXED)) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EBUSY;
+		return false;
+	}
+
+	allocator->hooks = *hooks;
+	return true;
+}
+
+// See fru-private.h
+void * fru__malloc(size_t size)
+{
+	fru__allocator_t * allocator = __atomic_load_n(&current, __ATOMIC_ACQUIRE);
+	header_t * hdr;
+
+	/* The allocator of the context takes precedence */
+	if (fru__ctx && fru__ctx->allocator.hooks.malloc)
+		allocator = &fru__ctx->allocator;
+
+	if (size > SIZE_MAX - sizeof(*hdr)) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	size += sizeof(*hdr);
+	hdr = allocator->hooks.malloc(size, allocator->hooks.data);
+	if (!hdr) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	hdr->allocator = allocator;
+	hdr->size = size;
+	stats_add(&stats.bytes, &stats.peak_bytes, size);
+	stats_add(&stats.allocs, &stats.peak_allocs, 1);
+	__atomic_add_fetch(&allocator->blocks, 1, __ATOMIC_RELAXED);
+
+	return hdr + 1;
+}
+
+// See fru-private.h
+void * fru__calloc(size_t nmemb, size_t size)
+{
+	void * ptr;
+
+	if (size && nmemb > SIZE_MAX / size) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	ptr = fru__malloc(nmemb * size);
+	if (ptr)
+		memset(ptr, 0, nmemb * size);
+
+	return ptr;
+}
+
+// See fru-private.h
+void * fru__realloc(void * ptr, size_t size)
+{
+	fru__allocator_t * allocator;
+	header_t * hdr;
+	size_t oldsize;
+
+	if (!ptr)
+		return fru__malloc(size);
+
+	hdr = HEADER(ptr);
+	allocator = hdr->allocator;
+	oldsize = hdr->size;
+
+	if (size > SIZE_MAX - sizeof(*hdr)) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	size += sizeof(*hdr);
+
+	if (allocator->hooks.realloc) {
+		hdr = allocator->hooks.realloc(hdr, size, allocator->hooks.data);
+		if (!hdr) {
+			errno = ENOMEM;
+			return NULL;
+		}
+	}
+	else {
+		/* Emulate with the other hooks, like a pool allocator would need */
+		header_t * newhdr = allocator->hooks.malloc(size, allocator->hooks.data);
+
+		if (!newhdr) {
+			errno = ENOMEM;
+			return NULL;
+		}
+		memcpy(newhdr + 1, hdr + 1, FRU_MIN(oldsize, size) - sizeof(*hdr));
+		allocator->hooks.free(hdr, allocator->hooks.data);
+		hdr = newhdr;
+		hdr->allocator = allocator;
+	}
+
+	hdr->size = size;
+	if (size > oldsize)
+		stats_add(&stats.bytes, &stats.peak_bytes, size - oldsize);
+	else
+		stats_sub(&stats.bytes, oldsize - size);
+
+	return hdr + 1;
+}
+
+// See fru-private.h
+void fru__free(void * ptr)
+{
+	fru__allocator_t * allocator;
+	header_t * hdr;
+	int err = errno;
+
+	if (!ptr)
+		return;
+
+	hdr = HEADER(ptr);
+	allocator = hdr->allocator;
+	stats_sub(&stats.bytes, hdr->size);
+	stats_sub(&stats.allocs, 1);
+	__atomic_sub_fetch(&allocator->blocks, 1, __ATOMIC_RELAXED);
+	allocator->hooks.free(hdr, allocator->hooks.data);
+	errno = err;
+}
+/** @endcond */
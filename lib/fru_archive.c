@@ -0,0 +1,625 @@
+/** @file
+ *  @brief Implementation of FRU archives
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//#define DEBUG
+#include "fru-private.h"
+#include "../fru_errno.h"
+
+struct fru_archive_s {
+	bool writing;
+	bool failed; ///< An image was written partially, only for writing
+	int fd; ///< Only for writing
+	uint64_t end; ///< End of the image data, only for writing
+	char * path; ///< The archive being written
+	char * tmp; ///< The copy of an existing `path` being written, replaces it on close
+
+	/* The index, in memory for writing, mapped for reading */
+	fru__archive_idx_t * index;
+	size_t count;
+	char * strtab;
+	size_t strsize;
+
+	/* Only for reading */
+	const uint8_t * map;
+	size_t mapsize;
+};
+
+static
+const char * entry_key(const fru_archive_t * ar, const fru__archive_idx_t * e)
+{
+	return ar->strtab + le32toh(e->key);
+}
+
+static
+int cmp_keys(const char * a, size_t alen, const char * b, size_t blen)
+{
+	int rc = memcmp(a, b, alen < blen ? alen : blen);
+
+	return rc ? rc : (alen > blen) - (alen < blen);
+}
+
+/*
+ * Validate the archive mapped at ar->map, set up the index pointers
+ */
+static
+bool map_index(fru_archive_t * ar)
+{
+	const fru__archive_hdr_t * hdr = (const void *)ar->map;
+	fru__archive_tail_t tail;
+	uint64_t index, count, strsize;
+
+	if (ar->mapsize < sizeof(*hdr) + sizeof(tail)
+	    || memcmp(hdr->magic, FRU__ARCHIVE_MAGIC, sizeof(hdr->magic)))
+	{
+		goto bad;
+	}
+
+	memcpy(&tail, ar->map + ar->mapsize - sizeof(tail), sizeof(tail));
+	if (memcmp(tail.magic, FRU__ARCHIVE_TAIL_MAGIC, sizeof(tail.magic)))
+		goto bad;
+
+	index = le64toh(tail.index);
+	count = le32toh(tail.count);
+	strsize = le32toh(tail.strsize);
+	DEBUG("Index at %" PRIu64 ", %" PRIu64 " entries, %" PRIu64 " bytes of keys",
+	      index, count, strsize);
+	if (index < sizeof(*hdr) || index % FRU__ARCHIVE_ALIGN
+	    || index + count * sizeof(fru__archive_idx_t) + strsize + sizeof(tail)
+	       != ar->mapsize)
+	{
+		goto bad;
+	}
+
+	if (fru__crc32(0, ar->map + index, ar->mapsize - index - sizeof(tail))
+	    != le32toh(tail.crc))
+	{
+		goto bad;
+	}
+
+	ar->index = (void *)(ar->map + index);
+	ar->count = count;
+	ar->strtab = (char *)(ar->index + count);
+	ar->strsize = strsize;
+
+	/* The CRC is fine, just make sure a buggy writer can't crash us */
+	for (size_t i = 0; i < count; i++) {
+		const fru__archive_idx_t * e = &ar->index[i];
+		uint64_t key = le32toh(e->key);
+
+		if (key + le32toh(e->keylen) >= strsize
+		    || ar->strtab[key + le32toh(e->keylen)]
+		    || le64toh(e->offset) + le32toh(e->size) > index)
+		{
+			goto bad;
+		}
+	}
+
+	return true;
+
+bad:
+	fru__seterr(FEBADARCH, FERR_LOC_GENERAL, -1);
+	return false;
+}
+
+/*
+ * Read the index of an existing archive into memory for appending,
+ * and copy its images to ar->fd. The old archive isn't modified.
+ */
+static
+bool load_index(fru_archive_t * ar, const char * filename)
+{
+	fru_archive_t * old = fru_archive_open(filename);
+	size_t idxsize;
+
+	if (!old)
+		return false;
+
+	ar->end = (const uint8_t *)old->index - old->map;
+	if (!fru__write_all(ar->fd, old->map, ar->end)) {
+		fru_archive_close(old);
+		return false;
+	}
+
+	idxsize = old->count * sizeof(*old->index);
+	ar->index = fru__malloc(idxsize ? idxsize : 1);
+	ar->strtab = fru__malloc(old->strsize ? old->strsize : 1);
+	if (!ar->index || !ar->strtab) {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		fru_archive_close(old);
+		return false;
+	}
+	memcpy(ar->index, old->index, idxsize);
+	memcpy(ar->strtab, old->strtab, old->strsize);
+	ar->count = old->count;
+	ar->strsize = old->strsize;
+	fru_archive_close(old);
+
+	return true;
+}
+
+// See fru.h
+fru_archive_t * fru_archive_create(const char * filename, bool append)
+{
+	fru_archive_t * ar;
+	struct stat st;
+	bool exists;
+	size_t len;
+
+	if (!filename) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return NULL;
+	}
+
+	ar = fru__calloc(1, sizeof(*ar));
+	if (!ar) {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		return NULL;
+	}
+	ar->writing = true;
+	ar->fd = -1;
+
+	len = strlen(filename);
+	ar->path = fru__malloc(len + 1);
+	if (!ar->path) {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		goto err;
+	}
+	memcpy(ar->path, filename, len + 1);
+
+	/*
+	 * An existing archive is replaced on close by a copy written next
+	 * to it, so it stays valid until the new one is fully written.
+	 * A new one is created in place and is removed if discarded.
+	 */
+	exists = !stat(filename, &st);
+	if (exists) {
+		ar->tmp = fru__malloc(len + sizeof(".XXXXXX"));
+		if (!ar->tmp) {
+			fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+			goto err;
+		}
+		memcpy(ar->tmp, filename, len);
+		memcpy(ar->tmp + len, ".XXXXXX", sizeof(".XXXXXX"));
+
+		ar->fd = mkstemp(ar->tmp);
+		if (ar->fd < 0 || fchmod(ar->fd, st.st_mode & 07777)) {
+			fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+			goto err;
+		}
+	}
+	else {
+		ar->fd = open(filename, O_WRONLY | O_CREAT | O_EXCL, 0644);
+		if (ar->fd < 0) {
+			fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+			goto err;
+		}
+	}
+
+	if (append && exists && st.st_size) {
+		if (!load_index(ar, filename))
+			goto err;
+		DEBUG("Appending to %s at %" PRIu64 " via %s", filename, ar->end, ar->tmp);
+	}
+	else {
+		fru__archive_hdr_t hdr = { .magic = FRU__ARCHIVE_MAGIC };
+
+		ar->end = sizeof(hdr);
+		if (!fru__write_all(ar->fd, &hdr, sizeof(hdr)))
+			goto err;
+	}
+
+	return ar;
+
+err:
+	if (ar->fd >= 0) {
+		int err = errno;
+		close(ar->fd);
+		unlink(ar->tmp ? ar->tmp : ar->path);
+		errno = err;
+	}
+	fru__free(ar->path);
+	fru__free(ar->tmp);
+	fru__free(ar->index);
+	fru__free(ar->strtab);
+	fru__free(ar);
+	return NULL;
+}
+
+// See fru.h
+bool fru_archive_add(fru_archive_t * ar, const char * key,
+                     const void * image, size_t size)
+{
+	static const uint8_t pad[FRU__ARCHIVE_ALIGN];
+	fru__archive_idx_t * index;
+	size_t keylen, padlen;
+	char * strtab;
+
+	if (!ar || !key || !image) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return false;
+	}
+
+	keylen = strlen(key);
+	if (!ar->writing || !keylen) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EINVAL;
+		return false;
+	}
+
+	if (size > UINT32_MAX || ar->strsize + keylen + 1 > UINT32_MAX) {
+		fru__seterr(FE2BIG, FERR_LOC_CALLER, -1);
+		return false;
+	}
+
+	index = fru__realloc(ar->index, (ar->count + 1) * sizeof(*index));
+	if (!index) {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		return false;
+	}
+	ar->index = index;
+
+	strtab = fru__realloc(ar->strtab, ar->strsize + keylen + 1);
+	if (!strtab) {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		return false;
+	}
+	ar->strtab = strtab;
+
+	padlen = (FRU__ARCHIVE_ALIGN - size % FRU__ARCHIVE_ALIGN) % FRU__ARCHIVE_ALIGN;
+	if (!fru__write_all(ar->fd, image, size) || !fru__write_all(ar->fd, pad, padlen)) {
+		/* The file position is unknown now, the archive can't be completed */
+		ar->failed = true;
+		return false;
+	}
+
+	memcpy(ar->strtab + ar->strsize, key, keylen + 1);
+	ar->index[ar->count++] = (fru__archive_idx_t){
+		.offset = htole64(ar->end),
+		.size = htole32(size),
+		.crc = htole32(fru__crc32(0, image, size)),
+		.key = htole32(ar->strsize),
+		.keylen = htole32(keylen),
+	};
+	ar->strsize += keylen + 1;
+	ar->end += size + padlen;
+
+	return true;
+}
+
+#if FRU_WITH_SAVE
+// See fru.h
+bool fru_archive_save(fru_archive_t * ar, const char * key, const fru_t * fru)
+{
+	void * buf = NULL;
+	size_t size = 0;
+	bool rc;
+
+	if (!fru_savebuffer(&buf, &size, fru))
+		return false;
+
+	rc = fru_archive_add(ar, key, buf, size);
+	fru__free(buf);
+
+	return rc;
+}
+#endif
+
+/* The index being sorted, qsort() has no context argument */
+static __thread const fru_archive_t * sorting;
+
+/*
+ * Order by key, then by offset, so that the latest
+ * of the duplicates is the last one
+ */
+static
+int cmp_entries(const void * a, const void * b)
+{
+	const fru__archive_idx_t * ea = a, * eb = b;
+	int rc = cmp_keys(entry_key(sorting, ea), le32toh(ea->keylen),
+	                  entry_key(sorting, eb), le32toh(eb->keylen));
+
+	if (rc)
+		return rc;
+
+	return (le64toh(ea->offset) > le64toh(eb->offset))
+	       - (le64toh(ea->offset) < le64toh(eb->offset));
+}
+
+/*
+ * Sort the in-memory index, drop the replaced entries,
+ * and write the index, the keys and the tail
+ */
+static
+bool write_index(fru_archive_t * ar)
+{
+	fru__archive_tail_t tail = { .magic = FRU__ARCHIVE_TAIL_MAGIC };
+	size_t count = 0, strsize = 0;
+	char * strtab;
+
+	sorting = ar;
+	qsort(ar->index, ar->count, sizeof(*ar->index), cmp_entries);
+	sorting = NULL;
+
+	/* Rebuild the string table in the index order, skipping the duplicates */
+	strtab = fru__malloc(ar->strsize ? ar->strsize : 1);
+	if (!strtab) {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		return false;
+	}
+	for (size_t i = 0; i < ar->count; i++) {
+		fru__archive_idx_t * e = &ar->index[i];
+		size_t keylen = le32toh(e->keylen);
+
+		if (i + 1 < ar->count
+		    && !cmp_keys(entry_key(ar, e), keylen,
+		                 entry_key(ar, e + 1), le32toh(e[1].keylen)))
+		{
+			DEBUG("Entry '%s' is replaced", entry_key(ar, e));
+			continue;
+		}
+		memcpy(strtab + strsize, entry_key(ar, e), keylen + 1);
+		ar->index[count] = *e;
+		ar->index[count++].key = htole32(strsize);
+		strsize += keylen + 1;
+	}
+	fru__free(ar->strtab);
+	ar->strtab = strtab;
+	ar->strsize = strsize;
+	ar->count = count;
+
+	tail.index = htole64(ar->end);
+	tail.count = htole32(count);
+	tail.strsize = htole32(strsize);
+	tail.crc = htole32(fru__crc32(fru__crc32(0, ar->index, count * sizeof(*ar->index)),
+	                         strtab, strsize));
+
+	return fru__write_all(ar->fd, ar->index, count * sizeof(*ar->index))
+	       && fru__write_all(ar->fd, strtab, strsize)
+	       && fru__write_all(ar->fd, &tail, sizeof(tail));
+}
+
+// See fru.h
+fru_archive_t * fru_archive_open(const char * filename)
+{
+	fru_archive_t * ar;
+	struct stat st;
+	void * map;
+	int fd, err;
+
+	if (!filename) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return NULL;
+	}
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		return NULL;
+	}
+
+	if (fstat(fd, &st)) {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		goto err;
+	}
+	if ((size_t)st.st_size < sizeof(fru__archive_hdr_t) + sizeof(fru__archive_tail_t)) {
+		fru__seterr(FEBADARCH, FERR_LOC_GENERAL, -1);
+		goto err;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (MAP_FAILED == map) {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		goto err;
+	}
+	close(fd);
+
+	ar = fru__calloc(1, sizeof(*ar));
+	if (!ar) {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		munmap(map, st.st_size);
+		return NULL;
+	}
+	ar->fd = -1;
+	ar->map = map;
+	ar->mapsize = st.st_size;
+
+	if (!map_index(ar)) {
+		munmap(map, st.st_size);
+		fru__free(ar);
+		return NULL;
+	}
+
+	DEBUG("Opened %s with %zu entries", filename, ar->count);
+	return ar;
+
+err:
+	err = errno;
+	close(fd);
+	errno = err;
+	return NULL;
+}
+
+// See fru.h
+bool fru_is_archive(const void * buf, size_t size)
+{
+	return buf && size >= sizeof(fru__archive_hdr_t)
+	       && !memcmp(buf, FRU__ARCHIVE_MAGIC, sizeof(FRU__ARCHIVE_MAGIC) - 1);
+}
+
+// See fru.h
+size_t fru_archive_count(const fru_archive_t * ar)
+{
+	return ar ? ar->count : 0;
+}
+
+// See fru.h
+const void * fru_archive_entry(const fru_archive_t * ar, size_t index,
+                               const char ** key, size_t * size)
+{
+	const fru__archive_idx_t * e;
+	const uint8_t * image;
+
+	if (!ar || !size) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return NULL;
+	}
+
+	if (ar->writing) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (index >= ar->count) {
+		fru__seterr(FENOREC, FERR_LOC_CALLER, index);
+		return NULL;
+	}
+
+	e = &ar->index[index];
+	image = ar->map + le64toh(e->offset);
+	if (fru__crc32(0, image, le32toh(e->size)) != le32toh(e->crc)) {
+		fru__seterr(FEDATACKSUM, FERR_LOC_GENERAL, index);
+		return NULL;
+	}
+
+	if (key)
+		*key = entry_key(ar, e);
+	*size = le32toh(e->size);
+
+	return image;
+}
+
+// See fru.h
+const void * fru_archive_find(const fru_archive_t * ar, const char * key,
+                              size_t * size)
+{
+	size_t lo = 0, hi, keylen;
+
+	if (!ar || !key) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return NULL;
+	}
+
+	keylen = strlen(key);
+	hi = ar->count;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		const fru__archive_idx_t * e = &ar->index[mid];
+		int c = cmp_keys(key, keylen, entry_key(ar, e), le32toh(e->keylen));
+
+		if (!c)
+			return fru_archive_entry(ar, mid, NULL, size);
+		if (c > 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	fru__seterr(FENOREC, FERR_LOC_CALLER, -1);
+	return NULL;
+}
+
+#if FRU_WITH_LOAD
+// See fru.h
+fru_t * fru_archive_load(fru_t * init_fru, const fru_archive_t * ar,
+                         const char * key, fru_flags_t flags)
+{
+	const void * image;
+	size_t size;
+
+	image = fru_archive_find(ar, key, &size);
+	if (!image)
+		return NULL;
+
+	return fru_loadbuffer(init_fru, image, size, flags);
+}
+#endif
+
+/*
+ * Close an archive, for writing either finalize it or discard
+ * everything written, the original archive if any is kept then
+ */
+static
+bool archive_close(fru_archive_t * ar, bool commit)
+{
+	bool rc = commit;
+
+	if (!ar)
+		return true;
+
+	if (ar->writing) {
+		if (commit && ar->failed) {
+			fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+			errno = EIO;
+			rc = false;
+		}
+		else if (commit) {
+			rc = write_index(ar);
+		}
+
+		/* The copy must be on disk before it replaces the original */
+		if (rc && ar->tmp && fsync(ar->fd)) {
+			fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+			rc = false;
+		}
+		if (close(ar->fd) && rc) {
+			fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+			rc = false;
+		}
+		if (rc && ar->tmp && rename(ar->tmp, ar->path)) {
+			fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+			rc = false;
+		}
+		if (!rc) {
+			int err = errno;
+			unlink(ar->tmp ? ar->tmp : ar->path);
+			errno = err;
+		}
+
+		fru__free(ar->path);
+		fru__free(ar->tmp);
+		fru__free(ar->index);
+		fru__free(ar->strtab);
+	}
+	else {
+		munmap((void *)ar->map, ar->mapsize);
+		rc = true;
+	}
+	fru__free(ar);
+
+	return rc;
+}
+
+// See fru.h
+bool fru_archive_close(fru_archive_t * ar)
+{
+	return archive_close(ar, true);
+}
+
+// See fru.h
+void fru_archive_discard(fru_archive_t * ar)
+{
+	archive_close(ar, false);
+}
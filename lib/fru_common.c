@@ -17,6 +17,7 @@
 #include <string.h>
 #include <time.h>
 #include <assert.h>
+#include <unistd.h>
 
 //#define DEBUG
 #include "fru-private.h"
@@ -24,6 +25,7 @@
 
 /** @cond PRIVATE */
 
+#if FRU_WITH_MR_MGMT
 /*
  * Minimum and maximum lengths of values as per
  * Table 18-6, Management Access Record
@@ -47,6 +49,7 @@ const size_t fru__mr_mgmt_maxlen[FRU_MR_MGMT_INDEX_COUNT] = {
 	[FRU__MGMT_TYPENAME_ID(COMPONENT_PING)] = 64,
 	[FRU__MGMT_TYPENAME_ID(SYS_UUID)] = 16
 };
+#endif
 
 /* Numbers of standard string fields per info area */
 const size_t fru__fieldcount[FRU_TOTAL_AREAS] = {
@@ -107,8 +110,83 @@ void * fru__find_reclist_entry(void * head_ptr, void * prev, size_t index)
 	return rec;
 }
 
+/* The storage slots must fit the list entries */
+_Static_assert(sizeof(fru__genlist_t) == sizeof(((fru_custom_slot_t *)0)->entry),
+               "Bad custom field slot layout");
+_Static_assert(sizeof(fru__genlist_t) == sizeof(((fru_mr_slot_t *)0)->entry),
+               "Bad MR record slot layout");
+
+#define IN_ARRAY(ptr, array, count) \
+	((void *)(ptr) >= (void *)(array) && (void *)(ptr) < (void *)((array) + (count)))
+
+/*
+ * Take a free slot for a list entry with a record of \a recsize bytes
+ * from the caller-provided storage, see fru_init_storage()
+ */
+static
+fru__genlist_t * storage_entry(fru_storage_t * storage, size_t recsize)
+{
+	size_t i;
+
+	if (recsize == sizeof(fru_mr_rec_t)) {
+		for (i = 0; i < storage->mr_count; i++) {
+			fru__genlist_t * entry = (fru__genlist_t *)storage->mr[i].entry;
+
+			if (!entry->data) {
+				entry->data = &storage->mr[i].rec;
+				return entry;
+			}
+		}
+	}
+	else {
+		for (i = 0; i < storage->custom_count; i++) {
+			fru__genlist_t * entry = (fru__genlist_t *)storage->custom[i].entry;
+
+			if (!entry->data) {
+				entry->data = &storage->custom[i].field;
+				return entry;
+			}
+		}
+	}
+
+	fru__seterr(FENOSPACE, FERR_LOC_GENERAL, -1);
+	return NULL;
+}
+
+/*
+ * Allocate a list entry with a record of \a recsize bytes
+ * from wherever \a fru keeps them
+ */
+static
+fru__genlist_t * new_entry(fru_t * fru, size_t recsize)
+{
+	fru__genlist_t * entry;
+
+	if (fru->storage) {
+		entry = storage_entry(fru->storage, recsize);
+		if (entry) {
+			entry->next = NULL;
+			memset(entry->data, 0, recsize);
+		}
+		return entry;
+	}
+
+	entry = fru__calloc(1, sizeof(*entry));
+	if (entry)
+		entry->data = fru__calloc(1, recsize);
+	if (!entry || !entry->data) {
+		fru__free(entry);
+		// Location and item are adjusted up the call chain
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		return NULL;
+	}
+
+	return entry;
+}
+
 // See header
-void * fru__add_reclist_entry(void * head_ptr, size_t index)
+void * fru__add_reclist_entry(fru_t * fru, void * head_ptr,
+                              size_t index, size_t recsize)
 {
 	assert(head_ptr);
 
@@ -117,12 +195,9 @@ void * fru__add_reclist_entry(void * head_ptr, size_t index)
 	               * prevrec = NULL,
 	               **reclist = (fru__genlist_t **)head_ptr;
 
-	rec = (fru__genlist_t *)calloc(1, sizeof(fru__genlist_t));
-	if(!rec) {
-		// Location and item are adjusted up the call chain
-		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+	rec = new_entry(fru, recsize);
+	if(!rec)
 		return NULL;
-	}
 
 	// If the reclist is empty, update it
 	if(!(*reclist)) {
@@ -150,14 +225,28 @@ void * fru__add_reclist_entry(void * head_ptr, size_t index)
 	return rec;
 }
 
-/*
- * Free all the record list entries starting with the
- * one pointed to by listptr and up to the end of the list.
- *
- * Takes a pointer to any fru__genlist_t compatible list.
- * That is either fru__reclist_t ** or fru__mr_reclist_t **.
- */
-bool fru__free_reclist(void * listptr)
+// See fru-private.h
+void fru__free_entry(const fru_t * fru, void * entry_ptr)
+{
+	const fru_storage_t * storage = fru ? fru->storage : NULL;
+	fru__genlist_t * entry = entry_ptr;
+
+	if (storage
+	    && (IN_ARRAY(entry, storage->custom, storage->custom_count)
+	        || IN_ARRAY(entry, storage->mr, storage->mr_count)))
+	{
+		/* Just mark the slot free */
+		entry->data = NULL;
+		entry->next = NULL;
+		return;
+	}
+
+	fru__free(entry->data);
+	fru__free(entry);
+}
+
+// See fru-private.h
+bool fru__free_reclist(const fru_t * fru, void * listptr)
 {
 	fru__genlist_t ** genlist = listptr;
 	fru__genlist_t * entry;
@@ -169,37 +258,34 @@ bool fru__free_reclist(void * listptr)
 
 	while (entry) {
 		fru__genlist_t * next = entry->next;
-		zfree(entry->data);
-		zfree(entry);
+		fru__free_entry(fru, entry);
 		entry = next;
 	}
+	*genlist = NULL;
 
 	return true;
 }
 
-// See fru-private.h
-time_t fru__datetime_base(void) {
-	struct tm tm_1996 = {
-		.tm_year = 96,
-		.tm_mon = 0,
-		.tm_mday = 1
-	};
-	// The argument to mktime is zoneless
-	return mktime(&tm_1996);
-}
-
 /** @endcond */
 
 // See fru.h
 void fru_wipe(fru_t * fru)
 {
+	fru_area_type_t atype;
+
 	if (!fru) return;
 
-	zfree(fru->internal);
-	fru__free_reclist(&fru->chassis.cust);
-	fru__free_reclist(&fru->board.cust);
-	fru__free_reclist(&fru->product.cust);
-	fru__free_reclist(&fru->mr);
+	/* Only free what is not borrowed from a template */
+	FRU_FOREACH_AREA(atype) {
+		if (FRU__IS_SHARED(fru, atype))
+			fru__drop_shared(fru, atype);
+	}
+
+	fru__internal_release(fru);
+	fru__free_reclist(fru, &fru->chassis.cust);
+	fru__free_reclist(fru, &fru->board.cust);
+	fru__free_reclist(fru, &fru->product.cust);
+	fru__free_reclist(fru, &fru->mr);
 	memset(fru, 0, sizeof(fru_t));
 }
 
@@ -246,3 +332,47 @@ int16_t fru_hex2byte(const char * hex)
 	return byte;
 }
 
+// See fru-private.h
+uint32_t fru__crc32(uint32_t crc, const void * data, size_t len)
+{
+	static uint32_t table[256];
+	static bool ready;
+	const uint8_t * p = data;
+
+	/* Concurrent initializations are harmless, they yield the same table */
+	if (!__atomic_load_n(&ready, __ATOMIC_ACQUIRE)) {
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++)
+				c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+			table[i] = c;
+		}
+		__atomic_store_n(&ready, true, __ATOMIC_RELEASE);
+	}
+
+	crc = ~crc;
+	while (len--)
+		crc = table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+
+	return ~crc;
+}
+
+// See fru-private.h
+bool fru__write_all(int fd, const void * data, size_t len)
+{
+	const uint8_t * p = data;
+
+	while (len) {
+		ssize_t rc = write(fd, p, len);
+		if (rc < 0) {
+			if (EINTR == errno)
+				continue;
+			fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+			return false;
+		}
+		p += rc;
+		len -= rc;
+	}
+
+	return true;
+}
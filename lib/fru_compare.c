@@ -0,0 +1,375 @@
+/** @file
+ *  @brief Implementation of fru_compare() and fru_equal()
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+//#define DEBUG
+#include "fru-private.h"
+#include "../fru_errno.h"
+
+#define CMP(a, b) (((a) > (b)) - ((a) < (b)))
+
+/*
+ * Compare a binary value (hex string) with the bytes of a non-binary one
+ */
+static
+int cmp_bin_text(const char * bin, const char * text)
+{
+	/* Big enough for the MR record data too */
+	uint8_t buf[FRU_MRR_RAW_MAXDATA];
+	size_t len = sizeof(buf);
+	size_t tlen = strlen(text);
+	int rc;
+
+	if (!fru__hexstr2bin(buf, &len, FRU__HEX_RELAXED, bin))
+		return strcmp(bin, text);
+
+	rc = memcmp(buf, text, len < tlen ? len : tlen);
+	return rc ? rc : CMP(len, tlen);
+}
+
+/*
+ * Compare two values with their encodings, binary values are hex strings
+ */
+static
+int cmp_val(fru_field_enc_t aenc, const char * a,
+            fru_field_enc_t benc, const char * b, fru_cmp_flags_t flags)
+{
+	bool abin = (FRU_FE_BINARY == aenc);
+	bool bbin = (FRU_FE_BINARY == benc);
+
+	if (!(flags & FRU_CMP_IGNENC)) {
+		if (aenc != benc)
+			return CMP(aenc, benc);
+		return strcmp(a, b);
+	}
+
+	/* The hex digits of binary values are case-insensitive */
+	if (abin && bbin)
+		return strcasecmp(a, b);
+	if (abin != bbin)
+		return abin ? cmp_bin_text(a, b) : -cmp_bin_text(b, a);
+	return strcmp(a, b);
+}
+
+static
+int cmp_field(const fru_field_t * a, const fru_field_t * b, fru_cmp_flags_t flags)
+{
+	return cmp_val(a->enc, a->val, b->enc, b->val, flags);
+}
+
+/* Compare hex strings that have no encoding of their own */
+static
+int cmp_hex(const char * a, const char * b, fru_cmp_flags_t flags)
+{
+	return cmp_val(FRU_FE_BINARY, a, FRU_FE_BINARY, b, flags);
+}
+
+static
+int cmp_info(const fru_t * a, const fru_t * b, fru_area_type_t atype,
+             fru_cmp_flags_t flags, fru_diff_t * diff)
+{
+	const fru__reclist_t * ca = *fru__get_customlist(a, atype);
+	const fru__reclist_t * cb = *fru__get_customlist(b, atype);
+	size_t i;
+	int rc;
+
+	diff->index = -1;
+	switch (atype) {
+	case FRU_CHASSIS_INFO:
+		rc = CMP(a->chassis.type, b->chassis.type);
+		break;
+	case FRU_BOARD_INFO:
+		rc = CMP(a->board.lang, b->board.lang);
+		if (rc || (flags & FRU_CMP_IGNDATE))
+			break;
+		rc = CMP(a->board.tv_auto, b->board.tv_auto);
+		/* The date is only stored up to a minute */
+		if (!rc && !a->board.tv_auto)
+			rc = CMP(a->board.tv.tv_sec / 60, b->board.tv.tv_sec / 60);
+		break;
+	default:
+		rc = CMP(a->product.lang, b->product.lang);
+		break;
+	}
+	if (rc)
+		return rc;
+
+	for (i = 0; i < fru__fieldcount[atype]; i++) {
+		const fru_field_t * fa = fru_getfield(a, atype, i);
+		/* The field is at the same offset in the other structure */
+		const fru_field_t * fb = (const void *)b + ((const void *)fa - (const void *)a);
+
+		diff->index = i;
+		rc = cmp_field(fa, fb, flags);
+		if (rc)
+			return rc;
+	}
+
+	for (; ca && cb; ca = ca->next, cb = cb->next, i++) {
+		diff->index = i;
+		rc = cmp_field(ca->rec, cb->rec, flags);
+		if (rc)
+			return rc;
+	}
+
+	/* The longer list is the greater one */
+	diff->index = i;
+	return CMP(!!ca, !!cb);
+}
+
+/* Compare a member of two records, return if they differ */
+#define CMP_MEMBER(m) do { \
+	int rc_ = CMP(a->m, b->m); \
+	if (rc_) \
+		return rc_; \
+} while (0)
+
+#if FRU_WITH_MR_OEM
+/*
+ * Compare the native data of two OEM records, by their encodings
+ * if there is a codec, or as is otherwise
+ */
+static
+int cmp_mr_oem_native(const fru_mr_rec_t * a, const fru_mr_rec_t * b)
+{
+	const fru_mr_oem_codec_t * codec = fru__mr_oem_codec(a->type, a->oem.mfg_id);
+	uint8_t abuf[FRU__FILE_MRR_MAXDATA], bbuf[FRU__FILE_MRR_MAXDATA];
+	size_t alen = sizeof(abuf), blen = sizeof(bbuf);
+	int rc;
+
+	if (!codec
+	    || !codec->encode(a, abuf, &alen, codec->arg)
+	    || !codec->encode(b, bbuf, &blen, codec->arg))
+	{
+		return memcmp(a->oem.native_data, b->oem.native_data,
+		              sizeof(a->oem.native_data));
+	}
+
+	rc = memcmp(abuf, bbuf, alen < blen ? alen : blen);
+	return rc ? rc : CMP(alen, blen);
+}
+#endif
+
+/*
+ * Compare two records of the same type member by member,
+ * only the used part of the strings counts
+ */
+static
+int cmp_mr_rec(const fru_mr_rec_t * a, const fru_mr_rec_t * b,
+               fru_cmp_flags_t flags)
+{
+	switch (a->type) {
+	case FRU_MR_PSU_INFO:
+		CMP_MEMBER(psu.overall_cap);
+		CMP_MEMBER(psu.peak_va);
+		CMP_MEMBER(psu.inrush_amp);
+		CMP_MEMBER(psu.inrush_ms);
+		CMP_MEMBER(psu.lo_vin1);
+		CMP_MEMBER(psu.hi_vin1);
+		CMP_MEMBER(psu.lo_vin2);
+		CMP_MEMBER(psu.hi_vin2);
+		CMP_MEMBER(psu.lo_freq);
+		CMP_MEMBER(psu.hi_freq);
+		CMP_MEMBER(psu.dropout_ms);
+		CMP_MEMBER(psu.flags);
+		CMP_MEMBER(psu.peak_watts);
+		CMP_MEMBER(psu.holdup_s);
+		CMP_MEMBER(psu.combined_v1);
+		CMP_MEMBER(psu.combined_v2);
+		CMP_MEMBER(psu.combined_watts);
+		CMP_MEMBER(psu.prefail_tach_rps);
+		return 0;
+	case FRU_MR_DC_OUT:
+	case FRU_MR_EXT_DC_OUT:
+		CMP_MEMBER(dco.standby);
+		CMP_MEMBER(dco.output);
+		CMP_MEMBER(dco.nominal);
+		CMP_MEMBER(dco.max_neg_dev);
+		CMP_MEMBER(dco.max_pos_dev);
+		CMP_MEMBER(dco.ripple);
+		CMP_MEMBER(dco.min_current);
+		CMP_MEMBER(dco.max_current);
+		CMP_MEMBER(dco.current_100ma);
+		return 0;
+	case FRU_MR_DC_LOAD:
+	case FRU_MR_EXT_DC_LOAD:
+		CMP_MEMBER(dcl.output);
+		CMP_MEMBER(dcl.nominal);
+		CMP_MEMBER(dcl.min_voltage);
+		CMP_MEMBER(dcl.max_voltage);
+		CMP_MEMBER(dcl.ripple);
+		CMP_MEMBER(dcl.min_current);
+		CMP_MEMBER(dcl.max_current);
+		CMP_MEMBER(dcl.current_100ma);
+		return 0;
+	case FRU_MR_MGMT_ACCESS:
+		CMP_MEMBER(mgmt.subtype);
+		/* The UUID is a hex string, the rest are text */
+		if (FRU_MR_MGMT_SYS_UUID == a->mgmt.subtype)
+			return cmp_hex(a->mgmt.data, b->mgmt.data, flags);
+		return strcmp(a->mgmt.data, b->mgmt.data);
+	case FRU_MR_NVME:
+		CMP_MEMBER(nvme.info.version);
+		CMP_MEMBER(nvme.info.formfactor);
+		CMP_MEMBER(nvme.info.p1v8_init);
+		CMP_MEMBER(nvme.info.p1v8_max);
+		CMP_MEMBER(nvme.info.p3v3_init);
+		CMP_MEMBER(nvme.info.p3v3_max);
+		CMP_MEMBER(nvme.info.p3v3_aux_max);
+		CMP_MEMBER(nvme.info.p5v_init);
+		CMP_MEMBER(nvme.info.p5v_max);
+		CMP_MEMBER(nvme.info.p12v_init);
+		CMP_MEMBER(nvme.info.p12v_max);
+		CMP_MEMBER(nvme.info.ptherm_max);
+		CMP_MEMBER(nvme.info.capacity_lo);
+		CMP_MEMBER(nvme.info.capacity_mid);
+		CMP_MEMBER(nvme.info.capacity_hi);
+		return 0;
+	case FRU_MR_NVME_PCIE_PORT:
+		CMP_MEMBER(nvme.pcie.version);
+		CMP_MEMBER(nvme.pcie.port);
+		CMP_MEMBER(nvme.pcie.info);
+		CMP_MEMBER(nvme.pcie.speeds);
+		CMP_MEMBER(nvme.pcie.max_width);
+		CMP_MEMBER(nvme.pcie.mctp);
+		CMP_MEMBER(nvme.pcie.refclk);
+		CMP_MEMBER(nvme.pcie.port_id);
+		return 0;
+	case FRU_MR_NVME_TOPOLOGY:
+		CMP_MEMBER(nvme.topology.version);
+		CMP_MEMBER(nvme.topology.count);
+		return cmp_hex(a->nvme.topology.data, b->nvme.topology.data, flags);
+	case FRU_MR_OEM_START ... FRU_MR_OEM_END:
+		CMP_MEMBER(oem.mfg_id);
+		CMP_MEMBER(oem.native);
+#if FRU_WITH_MR_OEM
+		if (a->oem.native)
+			return cmp_mr_oem_native(a, b);
+#endif
+		return cmp_val(a->oem.enc, a->oem.data, b->oem.enc, b->oem.data, flags);
+	case FRU_MR_RAW:
+		CMP_MEMBER(raw.type);
+		return cmp_val(a->raw.enc, a->raw.data, b->raw.enc, b->raw.data, flags);
+	default:
+		/* Nothing is decoded for the other types */
+		return 0;
+	}
+}
+
+#undef CMP_MEMBER
+
+static
+int cmp_mr(const fru_t * a, const fru_t * b, fru_cmp_flags_t flags,
+           fru_diff_t * diff)
+{
+	const fru__mr_reclist_t * ra = a->mr;
+	const fru__mr_reclist_t * rb = b->mr;
+	int rc;
+
+	for (diff->index = 0; ra && rb; ra = ra->next, rb = rb->next, diff->index++) {
+		rc = CMP(ra->rec->type, rb->rec->type);
+		if (!rc)
+			rc = cmp_mr_rec(ra->rec, rb->rec, flags);
+		if (rc)
+			return rc;
+	}
+
+	return CMP(!!ra, !!rb);
+}
+
+static
+int cmp_internal(const fru_t * a, const fru_t * b)
+{
+	size_t asize = a->internal.data ? a->internal.size : 0;
+	size_t bsize = b->internal.data ? b->internal.size : 0;
+	size_t size = asize < bsize ? asize : bsize;
+	int rc = size ? memcmp(a->internal.data, b->internal.data, size) : 0;
+
+	return rc ? rc : CMP(asize, bsize);
+}
+
+// See fru.h
+int fru_compare(const fru_t * a, const fru_t * b,
+                fru_cmp_flags_t flags, fru_diff_t * diff)
+{
+	fru_diff_t local_diff;
+	fru_area_type_t atype;
+	int rc = 0;
+
+	if (!diff)
+		diff = &local_diff;
+	diff->atype = FRU_TOTAL_AREAS;
+	diff->index = -1;
+
+	if (a == b)
+		return 0;
+	if (!a || !b)
+		return a ? 1 : -1;
+
+	FRU_FOREACH_AREA(atype) {
+		diff->atype = atype;
+		rc = CMP(a->present[atype], b->present[atype]);
+		if (rc)
+			return rc;
+	}
+
+	if (!(flags & FRU_CMP_IGNORDER)) {
+		/* Only the order of the present areas matters */
+		size_t ia = 0, ib = 0;
+
+		diff->atype = FRU_TOTAL_AREAS;
+		while (!rc && ia < FRU_TOTAL_AREAS && ib < FRU_TOTAL_AREAS) {
+			if (!a->present[a->order[ia]])
+				ia++;
+			else if (!b->present[b->order[ib]])
+				ib++;
+			else {
+				rc = CMP(a->order[ia], b->order[ib]);
+				ia++;
+				ib++;
+			}
+		}
+		if (rc)
+			return rc;
+	}
+
+	FRU_FOREACH_AREA(atype) {
+		if (!a->present[atype])
+			continue;
+
+		diff->atype = atype;
+		diff->index = -1;
+		switch (atype) {
+		case FRU_INTERNAL_USE:
+			rc = cmp_internal(a, b);
+			break;
+		case FRU_MR:
+			rc = cmp_mr(a, b, flags, diff);
+			break;
+		default:
+			rc = cmp_info(a, b, atype, flags, diff);
+			break;
+		}
+		if (rc)
+			return rc;
+	}
+
+	diff->atype = FRU_TOTAL_AREAS;
+	diff->index = -1;
+	return 0;
+}
+
+// See fru.h
+bool fru_equal(const fru_t * a, const fru_t * b, fru_cmp_flags_t flags)
+{
+	return !fru_compare(a, b, flags, NULL);
+}
@@ -0,0 +1,190 @@
+/** @file
+ *  @brief Implementation of the library contexts
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//#define DEBUG
+#include "fru-private.h"
+#include "../fru_errno.h"
+
+/** @cond PRIVATE */
+__thread fru_ctx_t * fru__ctx;
+/** @endcond */
+
+#if FRU_WITH_LOAD || FRU_WITH_SAVE
+/*
+ * Make \a ctx current for an `_r` function, the previous
+ * context is restored with leave()
+ */
+static
+bool enter(fru_ctx_t * ctx, fru_ctx_t ** prev)
+{
+	if (!ctx) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return false;
+	}
+
+	*prev = fru_ctx_use(ctx);
+	return true;
+}
+
+static
+void leave(fru_ctx_t * ctx, fru_ctx_t * prev)
+{
+	ctx->err = fru_errno;
+	fru_ctx_use(prev);
+}
+#endif
+
+// See fru.h
+fru_ctx_t * fru_ctx_new(void)
+{
+	/* Use the global allocator */
+	fru_ctx_t * prev = fru_ctx_use(NULL);
+	fru_ctx_t * ctx = fru__calloc(1, sizeof(*ctx));
+
+	if (ctx) {
+		ctx->date.policy = FRU_DATE_NOW;
+		ctx->err.code = FENONE;
+		ctx->err.src = FERR_LOC_GENERAL;
+		ctx->err.index = -1;
+	}
+	else {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+	}
+	fru_ctx_use(prev);
+
+	return ctx;
+}
+
+// See fru.h
+bool fru_ctx_free(fru_ctx_t * ctx)
+{
+	if (!ctx)
+		return true;
+
+	if (__atomic_load_n(&ctx->allocator.blocks, __ATOMIC_RELAXED)) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EBUSY;
+		return false;
+	}
+
+#if FRU_WITH_MR_OEM
+	fru__oem_registry_clear(&ctx->oem);
+#endif
+
+	if (fru__ctx == ctx)
+		fru__ctx = NULL;
+	fru__free(ctx);
+	return true;
+}
+
+// See fru.h
+fru_ctx_t * fru_ctx_use(fru_ctx_t * ctx)
+{
+	fru_ctx_t * prev = fru__ctx;
+
+	fru__ctx = ctx;
+	return prev;
+}
+
+// See fru.h
+bool fru_ctx_set_allocator(fru_ctx_t * ctx, const fru_allocator_t * allocator)
+{
+	const fru_allocator_t none = {};
+
+	if (!ctx) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return false;
+	}
+
+	if (!allocator) {
+		/* Keep the blocks count, the live blocks still point here */
+		ctx->allocator.hooks = none;
+		return true;
+	}
+
+	return fru__set_hooks(&ctx->allocator, allocator);
+}
+
+// See fru_errno.h
+fru_errno_t fru_ctx_errno(const fru_ctx_t * ctx)
+{
+	return ctx->err;
+}
+
+#if FRU_WITH_LOAD
+// See fru.h
+fru_t * fru_loadbuffer_r(fru_ctx_t * ctx, fru_t * fru,
+                         const void * buf, size_t size, fru_flags_t flags)
+{
+	fru_ctx_t * prev;
+
+	if (!enter(ctx, &prev))
+		return NULL;
+
+	fru = fru_loadbuffer(fru, buf, size, flags);
+	leave(ctx, prev);
+
+	return fru;
+}
+
+// See fru.h
+fru_t * fru_loadfile_r(fru_ctx_t * ctx, fru_t * fru,
+                       const char * filename, fru_flags_t flags)
+{
+	fru_ctx_t * prev;
+
+	if (!enter(ctx, &prev))
+		return NULL;
+
+	fru = fru_loadfile(fru, filename, flags);
+	leave(ctx, prev);
+
+	return fru;
+}
+#endif
+
+#if FRU_WITH_SAVE
+// See fru.h
+bool fru_savebuffer_r(fru_ctx_t * ctx, void ** bufptr, size_t * size,
+                      const fru_t * fru)
+{
+	fru_ctx_t * prev;
+	bool rc;
+
+	if (!enter(ctx, &prev))
+		return false;
+
+	rc = fru_savebuffer(bufptr, size, fru);
+	leave(ctx, prev);
+
+	return rc;
+}
+
+// See fru.h
+bool fru_savefile_r(fru_ctx_t * ctx, const char * fname, const fru_t * fru)
+{
+	fru_ctx_t * prev;
+	bool rc;
+
+	if (!enter(ctx, &prev))
+		return false;
+
+	rc = fru_savefile(fname, fru);
+	leave(ctx, prev);
+
+	return rc;
+}
+#endif
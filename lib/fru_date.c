@@ -0,0 +1,217 @@
+/** @file
+ *  @brief Implementation of the board manufacturing date policies and conversions
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+//#define DEBUG
+#include "fru-private.h"
+#include "../fru_errno.h"
+
+#define SECS_PER_DAY (24 * 60 * 60)
+#define DAYS_PER_ERA 146097 // 400 Gregorian years
+#define DAYS_0000_TO_1970 719468 // From 0000-03-01, the start of era 0
+
+static fru__date_policy_t global_policy = { FRU_DATE_NOW, 0 };
+
+/*
+ * Validate the arguments of fru_set_date_policy() and
+ * turn them into \a out
+ */
+static
+bool make_policy(fru__date_policy_t * out, fru_date_policy_t policy, time_t date)
+{
+	switch (policy) {
+	case FRU_DATE_NOW:
+		date = 0;
+		break;
+	case FRU_DATE_SOURCE_EPOCH: {
+		/* See https://reproducible-builds.org/specs/source-date-epoch/ */
+		const char * env = getenv("SOURCE_DATE_EPOCH");
+		char * end;
+		long long val;
+
+		errno = 0;
+		val = env ? strtoll(env, &end, 10) : 0;
+		if (!env || !*env || *end || errno) {
+			fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+			errno = EINVAL;
+			return false;
+		}
+		date = (time_t)val;
+		policy = FRU_DATE_FIXED;
+		}
+		// fall-through
+	case FRU_DATE_FIXED:
+		if (date < FRU_DATE_BASE || date > FRU_DATE_MAX) {
+			fru__seterr(FEBDATE, FERR_LOC_CALLER, -1);
+			return false;
+		}
+		break;
+	default:
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EINVAL;
+		return false;
+	}
+
+	out->policy = policy;
+	out->date = date;
+	return true;
+}
+
+/** @cond PRIVATE */
+// See fru-private.h
+time_t fru__auto_date(void)
+{
+	const fru__date_policy_t * p = fru__ctx ? &fru__ctx->date : &global_policy;
+
+	return FRU_DATE_FIXED == p->policy ? p->date : time(NULL);
+}
+
+// See fru-private.h
+bool fru__encode_date(uint8_t * out, const struct timeval * tv, bool tv_auto)
+{
+	const struct timeval tv_unspecified = { 0 };
+	struct timeval tv_toset = *tv;
+	uint32_t fru_time;
+	union {
+		uint32_t val;
+		uint8_t arr[4];
+	} fru_time_le = { 0 }; // little-endian per FRU spec
+
+	if (tv_auto) {
+		tv_toset.tv_sec = fru__auto_date();
+		tv_toset.tv_usec = 0;
+	} else if (tv_toset.tv_sec < FRU_DATE_BASE) {
+		fru__seterr(FEBDATE, FERR_LOC_BOARD, -1);
+		return false;
+	}
+
+	/* Yes, there is an upper limit and it's soon */
+	if (tv_toset.tv_sec > FRU_DATE_MAX) {
+		fru__seterr(FEBDATE, FERR_LOC_BOARD, -1);
+		return false;
+	}
+
+	/*
+	 * UNIX time 0 (Jan 1st of 1970) can never actually happen in a system,
+	 * provided that this code is written in 2024.
+	 */
+	if (!memcmp(&tv_unspecified, &tv_toset, sizeof(struct timeval))) {
+		DEBUG("Using FRU__DATE_UNSPECIFIED\n");
+		fru_time = FRU__DATE_UNSPECIFIED;
+	}
+	else {
+		// FRU time is in minutes and we don't care about microseconds
+		fru_time = FRU__DATE_TO_MINUTES(tv_toset.tv_sec);
+	}
+	fru_time_le.val = htole32(fru_time);
+	// Save 32-bit LE integer into 24-bit LE integer, loose the MSB
+	// Source: 0 1 2 3 // MSB at offset 3
+	// Dest  : 0 1 2 X // MSB at offset 2
+	if (out) {
+		out[0] = fru_time_le.arr[0];
+		out[1] = fru_time_le.arr[1];
+		out[2] = fru_time_le.arr[2];
+	}
+
+	return true;
+}
+/** @endcond */
+
+// See fru.h
+bool fru_set_date_policy(fru_date_policy_t policy, time_t date)
+{
+	return make_policy(&global_policy, policy, date);
+}
+
+// See fru.h
+bool fru_ctx_set_date_policy(fru_ctx_t * ctx, fru_date_policy_t policy,
+                             time_t date)
+{
+	if (!ctx) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return false;
+	}
+
+	return make_policy(&ctx->date, policy, date);
+}
+
+/*
+ * The conversions below count the days in eras of 400 years that
+ * start on March 1st, so that the leap day is the last one of a year.
+ * See http://howardhinnant.github.io/date_algorithms.html
+ */
+
+// See fru.h
+time_t fru_date_from_tm(const struct tm * tm)
+{
+	long long year = tm->tm_year + 1900LL + tm->tm_mon / 12;
+	long long mon = tm->tm_mon % 12; // 0 is January
+	long long era, yoe, doy, doe, days;
+
+	if (mon < 0) {
+		mon += 12;
+		year--;
+	}
+	year -= mon < 2; // January and February end the previous year
+
+	era = (year >= 0 ? year : year - 399) / 400;
+	yoe = year - era * 400;
+	doy = (153 * ((mon + 10) % 12) + 2) / 5 + tm->tm_mday - 1;
+	doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	days = era * DAYS_PER_ERA + doe - DAYS_0000_TO_1970;
+
+	return (time_t)(days * SECS_PER_DAY
+	                + tm->tm_hour * 60 * 60
+	                + tm->tm_min * 60
+	                + tm->tm_sec);
+}
+
+// See fru.h
+struct tm * fru_date_to_tm(time_t date, struct tm * tm)
+{
+	long long days = date / SECS_PER_DAY;
+	long long secs = date % SECS_PER_DAY;
+	long long era, doe, yoe, doy, mp;
+
+	if (secs < 0) {
+		secs += SECS_PER_DAY;
+		days--;
+	}
+
+	tm->tm_hour = secs / (60 * 60);
+	tm->tm_min = secs / 60 % 60;
+	tm->tm_sec = secs % 60;
+	tm->tm_wday = (days % 7 + 11) % 7; // 1970-01-01 was a Thursday
+	tm->tm_isdst = 0;
+
+	days += DAYS_0000_TO_1970;
+	era = (days >= 0 ? days : days - DAYS_PER_ERA + 1) / DAYS_PER_ERA;
+	doe = days - era * DAYS_PER_ERA;
+	yoe = (doe - doe / 1460 + doe / 36524 - doe / (DAYS_PER_ERA - 1)) / 365;
+	doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	mp = (5 * doy + 2) / 153; // 0 is March
+
+	tm->tm_mday = doy - (153 * mp + 2) / 5 + 1;
+	tm->tm_mon = mp < 10 ? mp + 2 : mp - 10;
+	tm->tm_year = yoe + era * 400 + (tm->tm_mon < 2) - 1900;
+
+	/* Days since January 1st, accounting for the leap day */
+	tm->tm_yday = tm->tm_mon < 2
+	              ? doy - 306
+	              : doy + 59 + (yoe % 4 == 0 && (yoe % 100 != 0 || yoe == 0)
+	                            ? 1 : 0);
+
+	return tm;
+}
@@ -21,12 +21,13 @@
  * is handled by mr_operation() in fru_mr_ops.c along with
  * search by MR type, which is impossible here.
  *
+ * @param[in] fru     The owner of the list
  * @param[in] reclist A pointer to any record list
  * @param[in] index   The index of the record to find, 1-based
  * @returns A success status
  */
 static
-bool delete_reclist_entry(void * head_ptr, int index)
+bool delete_reclist_entry(fru_t * fru, void * head_ptr, int index)
 {
 	assert(head_ptr);
 
@@ -46,8 +47,7 @@ bool delete_reclist_entry(void * head_ptr, int index)
 	}
 
 	// `rec` is always the record we delete, free it
-	rec->next = NULL;
-	fru__free_reclist(&rec);
+	fru__free_entry(fru, rec);
 	return true;
 }
 
@@ -73,9 +73,12 @@ bool fru_delete_custom(fru_t * fru,
 		goto out;
 	}
 
+	if (!fru_unshare(fru, atype))
+		goto out;
+
 	fru__reclist_t ** cust = fru__get_customlist(fru, atype);
 
-	if (!delete_reclist_entry(cust, index)) {
+	if (!delete_reclist_entry(fru, cust, index)) {
 		DEBUG("Failed to delete reclist entry: %s\n", fru_strerr(ru_errno));
 		// Custom fields start at FRU_<atype>_FIELD_COUNT index
 		fru__seterr(FENOFIELD, atype, fru__fieldcount[atype] + index);
@@ -0,0 +1,167 @@
+/** @file
+ *  @brief Implementation of copy-on-write and cloned fru structures
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+//#define DEBUG
+#include "fru-private.h"
+#include "../fru_errno.h"
+
+/*
+ * Replace the list at \a head_ptr with its deep copy,
+ * each entry's data being \a recsize bytes long.
+ * The original list is left intact.
+ */
+static
+bool copy_reclist(void * head_ptr, size_t recsize)
+{
+	fru__genlist_t ** head = head_ptr;
+	fru__genlist_t * copy = NULL;
+	fru__genlist_t ** tail = &copy;
+
+	for (const fru__genlist_t * src = *head; src; src = src->next) {
+		fru__genlist_t * entry = fru__calloc(1, sizeof(*entry));
+
+		if (entry) {
+			*tail = entry;
+			tail = (fru__genlist_t **)&entry->next;
+			entry->data = fru__malloc(recsize);
+		}
+		if (!entry || !entry->data) {
+			fru__free_reclist(NULL, &copy);
+			fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+			return false;
+		}
+		memcpy(entry->data, src->data, recsize);
+	}
+
+	*head = copy;
+	return true;
+}
+
+/** @cond PRIVATE */
+// See fru-private.h
+void fru__drop_shared(fru_t * fru, fru_area_type_t atype)
+{
+	switch (atype) {
+	case FRU_INTERNAL_USE:
+		memset(&fru->internal, 0, sizeof(fru->internal));
+		break;
+	case FRU_MR:
+		fru->mr = NULL;
+		break;
+	default:
+		*fru__get_customlist(fru, atype) = NULL;
+		break;
+	}
+	fru->shared &= ~FRU__BIT(atype);
+}
+/** @endcond */
+
+// See fru.h
+fru_t * fru_derive(const fru_t * tmpl)
+{
+	fru_area_type_t atype;
+	fru_t * fru;
+
+	if (!tmpl) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return NULL;
+	}
+
+	fru = fru__malloc(sizeof(*fru));
+	if (!fru) {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		return NULL;
+	}
+
+	/*
+	 * The areas are embedded, so they are copied here, but for
+	 * the heap-allocated data only the pointers are.
+	 */
+	memcpy(fru, tmpl, sizeof(*fru));
+	fru->storage = NULL; // The copies go to the heap
+	FRU_FOREACH_AREA(atype) {
+		fru->shared |= FRU__BIT(atype);
+	}
+
+	return fru;
+}
+
+// See fru.h
+bool fru_unshare(fru_t * fru, fru_area_type_t atype)
+{
+	if (!fru) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return false;
+	}
+
+	if (!FRU_IS_VALID_AREA(atype)) {
+		fru__seterr(FEAREABADTYPE, FERR_LOC_CALLER, atype);
+		return false;
+	}
+
+	if (!FRU__IS_SHARED(fru, atype))
+		return true;
+
+	switch (atype) {
+	case FRU_INTERNAL_USE:
+		if (fru->internal.size) {
+			uint8_t * data = fru__malloc(fru->internal.size);
+
+			if (!data) {
+				fru__seterr(FEGENERIC, FERR_LOC_INTERNAL, -1);
+				return false;
+			}
+			memcpy(data, fru->internal.data, fru->internal.size);
+			fru->internal.data = data;
+		}
+		else {
+			fru->internal.data = NULL;
+		}
+		/* The copy is an allocated buffer even if the original is mapped */
+		fru->internal.mapped = 0;
+		break;
+	case FRU_MR:
+		if (!copy_reclist(&fru->mr, sizeof(fru_mr_rec_t)))
+			return false;
+		break;
+	default:
+		if (!copy_reclist(fru__get_customlist(fru, atype), sizeof(fru_field_t)))
+			return false;
+		break;
+	}
+
+	fru->shared &= ~FRU__BIT(atype);
+	DEBUG("Area %d unshared", atype);
+	return true;
+}
+
+// See fru.h
+fru_t * fru_clone(const fru_t * fru)
+{
+	fru_area_type_t atype;
+	fru_t * clone = fru_derive(fru);
+
+	if (!clone)
+		return NULL;
+
+	FRU_FOREACH_AREA(atype) {
+		if (!fru_unshare(clone, atype)) {
+			fru_free(clone); // Only frees what is already copied
+			return NULL;
+		}
+	}
+
+	return clone;
+}
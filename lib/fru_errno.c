@@ -43,6 +43,10 @@ static const char * const fru_errno_string[FETOTALCOUNT] = {
     [FEAENABLED]            = "Area is enabled",
     [FEADISABLED]           = "Areas is disabled",
     [FELIB]                 = "Internal library error (bug?)",
+    [FEBADARCH]             = "Not a FRU archive, or the archive is damaged",
+    [FEBADTMPL]             = "Not a compiled template, or it is damaged or incompatible",
+    [FENOSPACE]             = "No room left in the caller-provided storage",
+    [FEAREAGROW]            = "The area has to grow to fit the data",
 };
 
 const char * fru_strerr(fru_errno_t ferr)
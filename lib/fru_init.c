@@ -25,7 +25,7 @@
 fru_t * fru_init(fru_t * fru)
 {
 	if (!fru) {
-		fru = malloc(sizeof(fru_t));
+		fru = fru__malloc(sizeof(fru_t));
 	}
 
 	if (!fru) {
@@ -50,3 +50,24 @@ fru_t * fru_init(fru_t * fru)
 
 	return fru;
 }
+
+// See fru.h
+fru_t * fru_init_storage(fru_t * fru, fru_storage_t * storage)
+{
+	if (!fru || !storage) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return NULL;
+	}
+
+	fru_init(fru);
+
+	/* Mark all the slots free */
+	if (storage->custom)
+		memset(storage->custom, 0, storage->custom_count * sizeof(*storage->custom));
+	if (storage->mr)
+		memset(storage->mr, 0, storage->mr_count * sizeof(*storage->mr));
+
+	fru->storage = storage;
+	return fru;
+}
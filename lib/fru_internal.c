@@ -8,91 +8,90 @@
  */
 
 #include <assert.h>
-#include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 //#define DEBUG
 #include "fru-private.h"
 #include "../fru_errno.h"
 
-/**
- * Copy a hex string without delimiters
- *
- * Copies the source \a hexstr into the destination pointed to by \a outhexstr,
- * performing sanity check and skipping delimiters. Delimiters include:
- * space, dot, colon, and dash.
- *
- * \b Example:
- * ```
- * "11 22 33 44 55"
- * "DE-AD-C0-DE"
- * "13:37:C0:DE:BA:BE"
- * "45.67.89.AB"
- * ```
- *
- * The source string must contain only hex digits and delimiters, nothing more.
- * If anything else is found, the function aborts and no modifications to
- * \a outhexstring are performed.
- *
- * Allocates and reallocates (resizes) \a outhexstrg as necessary.
- *
- * @returns Success status
- * @retval true Data copied successfully
- * @retval false An error occured, \a outhexstr unmodified, see \ref fru_errno
+/** @cond PRIVATE */
+// See fru-private.h
+void fru__internal_release(fru_t * fru)
+{
+	assert(fru);
+
+	fru_internal_t * internal = &fru->internal;
+
+	if (internal->mapped) {
+		munmap(internal->data, internal->mapped);
+		internal->data = NULL;
+	}
+	else if (fru->storage && internal->data == fru->storage->internal) {
+		internal->data = NULL;
+	}
+	else {
+		fru__zfree(internal->data);
+	}
+	internal->size = 0;
+	internal->mapped = 0;
+}
+/** @endcond */
+
+/*
+ * Release the internal use area data of \a fru unless
+ * they are borrowed from a template, see fru_derive()
  */
 static
-bool hexcopy(char ** outhexstr, const char * hexstr)
+void internal_drop(fru_t * fru)
 {
-	assert(outhexstr);
-	assert(hexstr);
-
-	size_t i;
-	size_t len = 0;
-	char *newhexstr = *outhexstr;
-
-	// Check input string sanity, skip delimiters
-	for (i = 0; hexstr[i]; i++) {
-		if (!isxdigit(hexstr[i])) {
-			switch (hexstr[i]) {
-			case ' ':
-			case '-':
-			case ':':
-			case '.':
-				continue;
-			default:
-				fru__seterr(FENONHEX, FERR_LOC_INTERNAL, -1);
-				return false;
-			}
-		}
-		else {
-			len++;
-		}
-	}
+	if (FRU__IS_SHARED(fru, FRU_INTERNAL_USE))
+		fru__drop_shared(fru, FRU_INTERNAL_USE);
+	else
+		fru__internal_release(fru);
+}
 
-	if (len % 2) {
-		fru__seterr(FENOTEVEN, FERR_LOC_INTERNAL, -1);
+/*
+ * Get a buffer for \a size bytes of the internal use area data,
+ * from the caller-provided storage if \a fru has one
+ */
+static
+uint8_t * internal_alloc(fru_t * fru, size_t size)
+{
+	uint8_t * data;
+
+	if (fru->storage) {
+		if (size > fru->storage->internal_size) {
+			fru__seterr(FENOSPACE, FERR_LOC_INTERNAL, -1);
+			return NULL;
+		}
+		return fru->storage->internal;
 	}
 
-	newhexstr = realloc(newhexstr, len + 1);
-	if (!newhexstr) {
+	data = fru__malloc(size);
+	if (!data)
 		fru__seterr(FEGENERIC, FERR_LOC_INTERNAL, -1);
-		return false;
-	}
 
-	*outhexstr = newhexstr;
-	for (i = 0, len = 0; hexstr[i]; i++)
-		switch (hexstr[i]) {
-		case ' ':
-		case '-':
-		case ':':
-		case '.':
-			continue;
-		default:
-			newhexstr[len++] = hexstr[i];
-		}
+	return data;
+}
 
-	return true;
+/*
+ * Replace the internal use area data in \a fru with the given
+ * buffer and enable the area.
+ */
+static
+void internal_replace(fru_t * fru, void * data, size_t size, size_t mapped)
+{
+	internal_drop(fru);
+	fru->internal.data = data;
+	fru->internal.size = size;
+	fru->internal.mapped = mapped;
+	fru_enable_area(fru, FRU_INTERNAL_USE, FRU_APOS_AUTO);
 }
 
 // See fru.h
@@ -100,61 +99,195 @@ bool fru_set_internal_binary(fru_t * fru,
                              const void * buffer,
                              size_t size)
 {
-	char *hexstring;
-	/* The output is two hex digits per byte,
-	 * plus an extra byte for the string terminator. */
-	size_t out_len = size * 2 + 1;
-	bool rc = false;
+	uint8_t * data = NULL;
 
-	if (!fru || !buffer) {
+	if (!fru || (!buffer && size)) {
 		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
 		errno = EFAULT;
-		goto err;
+		return false;
 	}
 
-	hexstring = realloc(fru->internal, out_len);
-	if (!hexstring) {
-		fru__seterr(FEGENERIC, FERR_LOC_INTERNAL, -1);
-		goto err;
+	if (size > FRU__MAX_FILE_SIZE) {
+		fru__seterr(FE2BIG, FERR_LOC_INTERNAL, -1);
+		return false;
 	}
 
-	if (size * 2 + 1 > out_len) {
-		zfree(hexstring);
-		fru__seterr(FE2BIG, FERR_LOC_INTERNAL, -1);
-		goto err;
+	if (size) {
+		data = internal_alloc(fru, size);
+		if (!data)
+			return false;
+		/* The storage buffer may already hold these very data */
+		memmove(data, buffer, size);
 	}
 
-	fru__decode_raw_binary(buffer, size,
-	                       hexstring, out_len);
-	fru->internal = hexstring;
-	fru_enable_area(fru, FRU_INTERNAL_USE, FRU_APOS_AUTO);
-	rc = true;
-err:
-	return rc;
+	internal_replace(fru, data, size, 0);
+	return true;
 }
 
+#if FRU_WITH_INTERNAL_HEX
 // See fru.h
 bool fru_set_internal_hexstring(fru_t * fru, const void * hexstr)
 {
+	uint8_t * data = NULL;
+	size_t size = 0;
+
 	if (!fru || !hexstr) {
-		fru__seterr(FEGENERIC, FERR_LOC_INTERNAL, -1);
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
 		errno = EFAULT;
 		return false;
 	}
 
-	/* Don't touch presence flag if copying fails,
-	 * old data are preserved */
-	if(!hexcopy(&fru->internal, hexstr))
+	/* Validate and calculate the size first, so that the old data are
+	 * preserved and the presence flag is not touched on failure */
+	if (!fru__hexstr2bin(NULL, &size, FRU__HEX_RELAXED, hexstr)) {
+		fru_errno.src = (fru_error_source_t)FERR_LOC_INTERNAL;
 		return false;
+	}
 
-	fru_enable_area(fru, FRU_INTERNAL_USE, FRU_APOS_AUTO);
+	if (size > FRU__MAX_FILE_SIZE) {
+		fru__seterr(FE2BIG, FERR_LOC_INTERNAL, -1);
+		return false;
+	}
+
+	if (size) {
+		data = internal_alloc(fru, size);
+		if (!data)
+			return false;
+		/* Can't fail, the string has been checked above */
+		fru__hexstr2bin(data, &size, FRU__HEX_RELAXED, hexstr);
+	}
+
+	internal_replace(fru, data, size, 0);
 	return true;
 }
+#endif
 
-bool fru_delete_internal(fru_t * fru)
+// See fru.h
+bool fru_set_internal_fd(fru_t * fru, int fd)
+{
+	struct stat st;
+	void * data;
+
+	if (!fru || fd < 0) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return false;
+	}
+
+	if (fstat(fd, &st)) {
+		fru__seterr(FEGENERIC, FERR_LOC_INTERNAL, -1);
+		return false;
+	}
+
+	if (st.st_size > FRU__MAX_FILE_SIZE) {
+		fru__seterr(FE2BIG, FERR_LOC_INTERNAL, -1);
+		return false;
+	}
+
+	if (!st.st_size) {
+		internal_replace(fru, NULL, 0, 0);
+		return true;
+	}
+
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (MAP_FAILED == data) {
+		fru__seterr(FEGENERIC, FERR_LOC_INTERNAL, -1);
+		return false;
+	}
+
+	internal_replace(fru, data, st.st_size, st.st_size);
+	return true;
+}
+
+// See fru.h
+bool fru_set_internal_file(fru_t * fru, const char * filename)
 {
+	int fd;
+	bool rc;
+
+	if (!fru || !filename) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return false;
+	}
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		fru__seterr(FEGENERIC, FERR_LOC_INTERNAL, -1);
+		return false;
+	}
+
+	/* The mapping stays valid after the descriptor is closed */
+	rc = fru_set_internal_fd(fru, fd);
+	close(fd);
+
+	return rc;
+}
+
+// See fru.h
+const void * fru_get_internal_binary(const fru_t * fru, size_t * size)
+{
+	if (!fru || !size) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return NULL;
+	}
+
+	if (!fru->present[FRU_INTERNAL_USE]) {
+		fru__seterr(FEADISABLED, FERR_LOC_INTERNAL, -1);
+		return NULL;
+	}
+
+	if (!fru->internal.data) {
+		fru__seterr(FENODATA, FERR_LOC_INTERNAL, -1);
+		return NULL;
+	}
+
+	*size = fru->internal.size;
+	return fru->internal.data;
+}
+
+#if FRU_WITH_INTERNAL_HEX
+// See fru.h
+char * fru_get_internal_hexstring(const fru_t * fru)
+{
+	char * hexstr;
+	/* The output is two hex digits per byte,
+	 * plus an extra byte for the string terminator. */
+	size_t out_len;
+
 	if (!fru) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return NULL;
+	}
+
+	if (!fru->present[FRU_INTERNAL_USE]) {
+		fru__seterr(FEADISABLED, FERR_LOC_INTERNAL, -1);
+		return NULL;
+	}
+
+	out_len = fru->internal.size * 2 + 1;
+	hexstr = fru__malloc(out_len);
+	if (!hexstr) {
 		fru__seterr(FEGENERIC, FERR_LOC_INTERNAL, -1);
+		return NULL;
+	}
+
+	hexstr[0] = 0;
+	if (fru->internal.size)
+		fru__decode_raw_binary(fru->internal.data, fru->internal.size,
+		                       hexstr, out_len);
+
+	return hexstr;
+}
+#endif
+
+// See fru.h
+bool fru_delete_internal(fru_t * fru)
+{
+	if (!fru) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
 		errno = EFAULT;
 		return false;
 	}
@@ -165,7 +298,7 @@ bool fru_delete_internal(fru_t * fru)
 	}
 
 	fru->present[FRU_INTERNAL_USE] = false;
-	zfree(fru->internal);
+	internal_drop(fru);
 
 	return true;
 }
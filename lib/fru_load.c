@@ -31,6 +31,84 @@
 
 /** @cond PRIVATE */
 
+/* All the debug flags that matter for fru_loadbuffer() */
+#define DIAG_FLAGS (FRU_IGNFVER | FRU_IGNFHCKSUM | FRU_IGNAVER | FRU_IGNRVER \
+                    | FRU_IGNACKSUM | FRU_IGNRHCKSUM | FRU_IGNRDCKSUM \
+                    | FRU_IGNRNOEOL | FRU_IGNAEOF | FRU_IGNMRVER \
+                    | FRU_IGNMRDATALEN)
+
+/*
+ * The issues collected by fru_loadbuffer_diag() in this thread,
+ * NULL when it's not running
+ */
+typedef struct {
+	fru_diag_t * items;
+	size_t capacity;
+	size_t count;
+	const uint8_t * image;
+} diaglog_t;
+
+static __thread diaglog_t * diaglog;
+
+/*
+ * Record the error in fru_errno found at \a offset in the image
+ * if the diagnostics are being collected
+ */
+static
+void diag_at(size_t offset)
+{
+	if (!diaglog)
+		return;
+
+	DEBUG("Issue %zu at %zu: %s", diaglog->count, offset, fru_strerr(fru_errno));
+	if (diaglog->count < diaglog->capacity) {
+		diaglog->items[diaglog->count] = (fru_diag_t){
+			.err = fru_errno,
+			.errnum = FEGENERIC == fru_errno.code ? errno : 0,
+			.offset = offset,
+		};
+	}
+	diaglog->count++;
+}
+
+/*
+ * Same as diag_at() for a location given by a pointer into the image
+ */
+static
+void diag(const void * ptr)
+{
+	if (diaglog)
+		diag_at((const uint8_t *)ptr - diaglog->image);
+}
+
+/*
+ * Check if the error just set in fru_errno at \a ptr is ignored
+ * by \a ign in \a flags, and record it as an issue if so
+ */
+static
+bool ignored(fru_flags_t flags, fru_flags_t ign, const void * ptr)
+{
+	if (!(flags & ign))
+		return false;
+
+	diag(ptr);
+	return true;
+}
+
+/*
+ * The MR decoders don't know the record index,
+ * set it for all the issues recorded since \a from
+ */
+static
+void diag_set_index(size_t from, int index)
+{
+	if (!diaglog)
+		return;
+
+	for (size_t i = from; i < diaglog->count && i < diaglog->capacity; i++)
+		diaglog->items[i].err.index = index;
+}
+
 /**
  * @brief Find and validate FRU header in the byte buffer.
  *
@@ -52,7 +130,7 @@ fru__file_t * find_fru_header(const void * buffer, size_t size, fru_flags_t flag
 	    || (header->pad != 0))
 	{
 		fru__seterr(FEHDRVER, FERR_LOC_GENERAL, -1);
-		if (!(flags & FRU_IGNFVER))
+		if (!ignored(flags, FRU_IGNFVER, header))
 			return NULL;
 	}
 	/* Don't include the checksum byte into calculation */
@@ -60,7 +138,7 @@ fru__file_t * find_fru_header(const void * buffer, size_t size, fru_flags_t flag
 	if (cksum < 0 || header->hchecksum != (uint8_t)cksum) {
 		if (cksum >= 0) // Keep fru_errno if there was an error
 			fru__seterr(FEHDRCKSUM, FERR_LOC_GENERAL, -1);
-		if (!(flags & FRU_IGNFHCKSUM))
+		if (!ignored(flags, FRU_IGNFHCKSUM, &header->hchecksum))
 			return NULL;
 	}
 	return header;
@@ -177,7 +255,7 @@ bool decode_custom_fields(fru_t * fru,
 			      fru_strerr(fru_errno));
 			fru__reclist_t **cust = fru__get_customlist(fru, atype);
 			if (cust)
-				fru__free_reclist(cust);
+				fru__free_reclist(fru, cust);
 			fru_errno = err;
 			return false;
 		}
@@ -195,7 +273,7 @@ bool decode_custom_fields(fru_t * fru,
 	if (limit <= 0) {
 		DEBUG("Area doesn't contain an end-of-fields byte");
 		fru__seterr(FENOTERM, atype, -1);
-		if(!(flags & FRU_IGNAEOF))
+		if (!ignored(flags, FRU_IGNAEOF, data + limit))
 			return false;
 	}
 
@@ -205,7 +283,7 @@ bool decode_custom_fields(fru_t * fru,
 
 /**
  * A helper function to decode an internal use area.
- * This function just copies the data as a hex string.
+ * This function just copies the binary data.
 
  * @param[in,out] fru Pointer to the FRU information structure to fill in
  * @param[in] atype The area type
@@ -226,7 +304,7 @@ bool decode_iu_area(fru_t * fru,
 
 	if (iu_area->ver != FRU__VER) {
 		fru__seterr(FEHDRVER, FERR_LOC_INTERNAL, -1);
-		if(!(flags & FRU_IGNAVER))
+		if (!ignored(flags, FRU_IGNAVER, iu_area))
 			return false;
 	}
 
@@ -289,7 +367,7 @@ bool decode_info_area(fru_t * fru,
 	}
 	else if (cksum) {
 		fru__seterr(FEDATACKSUM, atype, -1);
-		if (!(flags & FRU_IGNACKSUM))
+		if (!ignored(flags, FRU_IGNACKSUM, data_in + bytes_left - 1))
 			return false;
 	}
 
@@ -327,7 +405,7 @@ bool decode_info_area(fru_t * fru,
 	if (file_area->ver != FRU__VER) {
 		DEBUG("Wrong area version %d for area %d", (int)file_area->ver, atype);
 		fru__seterr(FEHDRVER, atype, -1);
-		if (!(flags & FRU_IGNAVER))
+		if (!ignored(flags, FRU_IGNAVER, file_area))
 			return false;
 	}
 
@@ -359,8 +437,7 @@ bool decode_info_area(fru_t * fru,
 			fru_time_le.arr[2] = board->mfgdate[2];
 			uint32_t fru_time = le32toh(fru_time_le.val);
 
-			// The argument to mktime is zoneless
-			board_out->tv.tv_sec = fru__datetime_base() + 60 * fru_time;
+			board_out->tv.tv_sec = FRU__DATE_FROM_MINUTES(fru_time);
 
 			// If some specific manufacturing date/time is given in the file,
 			// disable automatic generation of timestamp on save
@@ -413,7 +490,7 @@ bool is_mr_rec_valid(const fru__file_mr_rec_t * rec, size_t limit, fru_flags_t f
 	 */
 	if (!FRU__IS_MR_VALID_VER(rec)) {
 		fru__seterr(FEHDRVER, FERR_LOC_MR, -1);
-		if (!(flags & FRU_IGNRVER))
+		if (!ignored(flags, FRU_IGNRVER, &rec->hdr.eol_ver))
 			return false;
 	}
 
@@ -421,7 +498,7 @@ bool is_mr_rec_valid(const fru__file_mr_rec_t * rec, size_t limit, fru_flags_t f
 	cksum = fru__calc_checksum(rec, sizeof(fru__file_mr_header_t));
 	if (cksum) {
 		fru__seterr(FEHDRCKSUM, FERR_LOC_MR, -1);
-		if (!(flags & FRU_IGNRHCKSUM))
+		if (!ignored(flags, FRU_IGNRHCKSUM, &rec->hdr.hdr_checksum))
 			return false;
 	}
 
@@ -435,13 +512,14 @@ bool is_mr_rec_valid(const fru__file_mr_rec_t * rec, size_t limit, fru_flags_t f
 	cksum = fru__calc_checksum(rec->data, rec->hdr.len);
 	if (cksum != (int)rec->hdr.rec_checksum) {
 		fru__seterr(FEDATACKSUM, FERR_LOC_MR, -1);
-		if (!(flags & FRU_IGNRDCKSUM))
+		if (!ignored(flags, FRU_IGNRDCKSUM, &rec->hdr.rec_checksum))
 			return false;
 	}
 
 	return true;
 }
 
+#if FRU_WITH_MR_MGMT
 /**
  * Convert a FRU file MR UUID Management record into an UUID user record
  */
@@ -484,7 +562,7 @@ bool decode_mr_mgmt(fru_mr_rec_t * rec,
                     const void * data,
                     fru_flags_t flags)
 {
-	size_t minsize, maxsize;
+	size_t minsize, maxsize, len;
 	const fru__file_mr_mgmt_rec_t *file_rec = data;
 
 	if (!FRU_MR_MGMT_IS_SUBTYPE_VALID(file_rec->subtype)) {
@@ -501,7 +579,7 @@ bool decode_mr_mgmt(fru_mr_rec_t * rec,
 
 	if (minsize > file_rec->hdr.len || file_rec->hdr.len > maxsize) {
 		fru__seterr(FESIZE, FERR_LOC_MR, -1);
-		if (!(flags & FRU_IGNMRDATALEN))
+		if (!ignored(flags, FRU_IGNMRDATALEN, &file_rec->hdr.len))
 			return false;
 	}
 
@@ -510,12 +588,225 @@ bool decode_mr_mgmt(fru_mr_rec_t * rec,
 		return decode_mr_mgmt_uuid(rec, file_rec);
 	}
 
-	/* All other records are just plain text */
-	memcpy(rec->mgmt.data, file_rec->data, file_rec->hdr.len);
+	/*
+	 * All other records are just plain text. The record length includes
+	 * the subtype, and may be anything if FRU_IGNMRDATALEN is set.
+	 */
+	len = 0;
+	if (file_rec->hdr.len > FRU__MGMT_MR_DATASIZE(0))
+		len = file_rec->hdr.len - FRU__MGMT_MR_DATASIZE(0);
+	len = FRU_MIN(len, (size_t)FRU_MR_MGMT_MAXDATA);
+	memcpy(rec->mgmt.data, file_rec->data, len);
+	rec->mgmt.data[len] = 0;
 	rec->mgmt.subtype = file_rec->subtype;
 
 	return true;
 }
+#endif
+
+#if FRU_WITH_MR_PSU || FRU_WITH_MR_NVME
+/*
+ * Copy fixed-size MR record payload into a local structure of \a size
+ * bytes, check the record data length. Unless \a exact is set, any
+ * extra (reserved) data in the record is ignored. The local structure
+ * is zero-padded if the record is shorter than expected and
+ * FRU_IGNMRDATALEN is set.
+ */
+static
+bool mr_payload(void * payload, size_t size,
+                const fru__file_mr_rec_t * file_rec,
+                bool exact,
+                fru_flags_t flags)
+{
+	memset(payload, 0, size);
+	if (file_rec->hdr.len < size || (exact && file_rec->hdr.len != size)) {
+		fru__seterr(FESIZE, FERR_LOC_MR, -1);
+		if (!ignored(flags, FRU_IGNMRDATALEN, &file_rec->hdr.len))
+			return false;
+	}
+	memcpy(payload, file_rec->data, FRU_MIN(size, file_rec->hdr.len));
+	return true;
+}
+#endif
+
+#if FRU_WITH_MR_PSU
+static
+bool decode_mr_psu(fru_mr_rec_t * rec,
+                   const void * data,
+                   fru_flags_t flags)
+{
+	fru__file_mr_psu_t psu;
+	uint16_t peak;
+
+	if (!mr_payload(&psu, sizeof(psu), data, true, flags))
+		return false;
+
+	rec->psu.overall_cap = le16toh(psu.overall_cap) & FRU__MR_PSU_OCAP_MASK;
+	rec->psu.peak_va = le16toh(psu.peak_va);
+	rec->psu.inrush_amp = psu.inrush_amp;
+	rec->psu.inrush_ms = psu.inrush_ms;
+	rec->psu.lo_vin1 = (int16_t)le16toh(psu.lo_vin1);
+	rec->psu.hi_vin1 = (int16_t)le16toh(psu.hi_vin1);
+	rec->psu.lo_vin2 = (int16_t)le16toh(psu.lo_vin2);
+	rec->psu.hi_vin2 = (int16_t)le16toh(psu.hi_vin2);
+	rec->psu.lo_freq = psu.lo_freq;
+	rec->psu.hi_freq = psu.hi_freq;
+	rec->psu.dropout_ms = psu.dropout_tolerance_ms;
+	rec->psu.flags = psu.flags & FRU_MR_PSU_FLAGS_MASK;
+	peak = le16toh(psu.peak_watts_holdup);
+	rec->psu.peak_watts = peak & FRU__MR_PSU_PEAK_WATTS_MASK;
+	rec->psu.holdup_s = peak >> FRU__MR_PSU_HOLDUP_SHIFT;
+	rec->psu.combined_v1 = (psu.combined_watts.per_range >> FRU__MR_PSU_WATTS_RANGE1_SHIFT)
+	                       & FRU__MR_PSU_WATTS_MASK;
+	rec->psu.combined_v2 = (psu.combined_watts.per_range >> FRU__MR_PSU_WATTS_RANGE2_SHIFT)
+	                       & FRU__MR_PSU_WATTS_MASK;
+	rec->psu.combined_watts = le16toh(psu.combined_watts.total);
+	rec->psu.prefail_tach_rps = psu.prefail_tach_rps;
+
+	return true;
+}
+
+/*
+ * Decode both DC Output and Extended DC Output records
+ */
+static
+bool decode_mr_dcout(fru_mr_rec_t * rec,
+                     const void * data,
+                     fru_flags_t flags)
+{
+	const fru__file_mr_rec_t * file_rec = data;
+	fru__file_mr_dcout_t dco;
+	/* The structures for both record types are the same */
+	fru_mr_dcout_t * out = &rec->dco;
+
+	if (!mr_payload(&dco, sizeof(dco), file_rec, true, flags))
+		return false;
+
+	out->standby = !!(dco.info & FRU__MR_DCOUT_STANDBY);
+	out->output = dco.info & FRU__MR_DC_OUTPUT_MASK;
+	out->current_100ma = (FRU_MR_EXT_DC_OUT == file_rec->hdr.type_id)
+	                     && (dco.info & FRU__MR_DCOUT_100MA);
+	out->nominal = (int16_t)le16toh(dco.nominal);
+	out->max_neg_dev = (int16_t)le16toh(dco.max_neg_dev);
+	out->max_pos_dev = (int16_t)le16toh(dco.max_pos_dev);
+	out->ripple = le16toh(dco.ripple);
+	out->min_current = le16toh(dco.min_current);
+	out->max_current = le16toh(dco.max_current);
+
+	return true;
+}
+
+/*
+ * Decode both DC Load and Extended DC Load records
+ */
+static
+bool decode_mr_dcload(fru_mr_rec_t * rec,
+                      const void * data,
+                      fru_flags_t flags)
+{
+	const fru__file_mr_rec_t * file_rec = data;
+	fru__file_mr_dcload_t dcl;
+	/* The structures for both record types are the same */
+	fru_mr_dcload_t * out = &rec->dcl;
+
+	if (!mr_payload(&dcl, sizeof(dcl), file_rec, true, flags))
+		return false;
+
+	out->output = dcl.info & FRU__MR_DC_OUTPUT_MASK;
+	out->current_100ma = (FRU_MR_EXT_DC_LOAD == file_rec->hdr.type_id)
+	                     && (dcl.info & FRU__MR_DCLOAD_100MA);
+	out->nominal = (int16_t)le16toh(dcl.nominal);
+	out->min_voltage = (int16_t)le16toh(dcl.min_voltage);
+	out->max_voltage = (int16_t)le16toh(dcl.max_voltage);
+	out->ripple = le16toh(dcl.ripple);
+	out->min_current = le16toh(dcl.min_current);
+	out->max_current = le16toh(dcl.max_current);
+
+	return true;
+}
+#endif
+
+#if FRU_WITH_MR_NVME
+static
+bool decode_mr_nvme(fru_mr_rec_t * rec,
+                    const void * data,
+                    fru_flags_t flags)
+{
+	fru__file_mr_nvme_t nvme;
+	fru_mr_nvme_info_t * out = &rec->nvme.info;
+
+	if (!mr_payload(&nvme, sizeof(nvme), data, false, flags))
+		return false;
+
+	out->version = nvme.version;
+	out->formfactor = nvme.formfactor;
+	out->p1v8_init = nvme.p1v8_init;
+	out->p1v8_max = nvme.p1v8_max;
+	out->p3v3_init = nvme.p3v3_init;
+	out->p3v3_max = nvme.p3v3_max;
+	out->p3v3_aux_max = nvme.p3v3_aux_max;
+	out->p5v_init = nvme.p5v_init;
+	out->p5v_max = nvme.p5v_max;
+	out->p12v_init = nvme.p12v_init;
+	out->p12v_max = nvme.p12v_max;
+	out->ptherm_max = nvme.ptherm_max;
+	out->capacity_lo = le64toh(nvme.capacity.lo);
+	out->capacity_mid = le32toh(nvme.capacity.mid);
+	out->capacity_hi = nvme.capacity.hi;
+
+	return true;
+}
+
+static
+bool decode_mr_nvme_pcie(fru_mr_rec_t * rec,
+                         const void * data,
+                         fru_flags_t flags)
+{
+	fru__file_mr_nvme_pcie_t pcie;
+	fru_mr_nvme_pcie_t * out = &rec->nvme.pcie;
+
+	if (!mr_payload(&pcie, sizeof(pcie), data, false, flags))
+		return false;
+
+	out->version = pcie.version;
+	out->port = pcie.port;
+	out->info = pcie.info;
+	out->speeds = pcie.speeds;
+	out->max_width = pcie.max_width;
+	out->mctp = pcie.mctp;
+	out->refclk = pcie.refclk;
+	out->port_id = pcie.port_id;
+
+	return true;
+}
+
+static
+bool decode_mr_nvme_topology(fru_mr_rec_t * rec,
+                             const void * data,
+                             fru_flags_t flags)
+{
+	const fru__file_mr_rec_t * file_rec = data;
+	const fru__file_mr_nvme_topo_t * topo = (const void *)file_rec->data;
+	fru_mr_nvme_topology_t * out = &rec->nvme.topology;
+
+	memset(out, 0, sizeof(*out));
+	if (file_rec->hdr.len < sizeof(*topo)) {
+		fru__seterr(FESIZE, FERR_LOC_MR, -1);
+		if (!ignored(flags, FRU_IGNMRDATALEN, &file_rec->hdr.len))
+			return false;
+		if (file_rec->hdr.len)
+			out->version = topo->version;
+		return true;
+	}
+
+	out->version = topo->version;
+	out->count = topo->count;
+	fru__decode_raw_binary(topo->data, file_rec->hdr.len - sizeof(*topo),
+	                       out->data, sizeof(out->data));
+
+	return true;
+}
+#endif
 
 /*
  * Decode any yet unsupported type of MR record
@@ -551,10 +842,43 @@ bool decode_mr_raw(fru_mr_rec_t * rec,
 	return true;
 }
 
+#if FRU_WITH_MR_OEM
+/*
+ * Decode an OEM record with a registered codec, or
+ * as a `raw` record if there is no such codec
+ */
 static
-bool decode_mr_record(fru_mr_rec_t * rec,
-                      const fru__file_mr_rec_t * srec,
-                      fru_flags_t flags)
+bool decode_mr_oem(fru_mr_rec_t * rec,
+                   const void * data,
+                   fru_flags_t flags)
+{
+	const fru__file_mr_oem_rec_t * file_rec = data;
+	const fru_mr_oem_codec_t * codec = NULL;
+	uint32_t mfg_id = 0;
+
+	if (file_rec->hdr.len >= FRU__FILE_MRR_OEM_MFGID_LEN) {
+		mfg_id = file_rec->mfg_id[0]
+		         | file_rec->mfg_id[1] << 8
+		         | file_rec->mfg_id[2] << 16;
+		codec = fru__mr_oem_codec(file_rec->hdr.type_id, mfg_id);
+	}
+
+	if (!codec)
+		return decode_mr_raw(rec, data, flags);
+
+	memset(&rec->oem, 0, sizeof(rec->oem));
+	rec->oem.mfg_id = mfg_id;
+	rec->oem.native = true;
+	return codec->decode(rec, file_rec->data,
+	                     file_rec->hdr.len - FRU__FILE_MRR_OEM_MFGID_LEN,
+	                     codec->arg);
+}
+#endif
+
+// See fru-private.h
+bool fru__decode_mr_record(fru_mr_rec_t * rec,
+                           const fru__file_mr_rec_t * srec,
+                           fru_flags_t flags)
 {
 	bool rc = false;
 	fru__seterr(FEMRNOTSUP, FERR_LOC_MR, -1);
@@ -564,8 +888,26 @@ bool decode_mr_record(fru_mr_rec_t * rec,
 	                                       const void *,
 	                                       fru_flags_t) =
 	{
+		// The records of the types compiled out are decoded as `raw`
+#if FRU_WITH_MR_PSU
+		[FRU_MR_PSU_INFO] = decode_mr_psu,
+		[FRU_MR_DC_OUT] = decode_mr_dcout,
+		[FRU_MR_DC_LOAD] = decode_mr_dcload,
+		[FRU_MR_EXT_DC_OUT] = decode_mr_dcout,
+		[FRU_MR_EXT_DC_LOAD] = decode_mr_dcload,
+#endif
+#if FRU_WITH_MR_MGMT
 		[FRU_MR_MGMT_ACCESS] = decode_mr_mgmt,
+#endif
+#if FRU_WITH_MR_NVME
+		[FRU_MR_NVME] = decode_mr_nvme,
+		[FRU_MR_NVME_PCIE_PORT] = decode_mr_nvme_pcie,
+		[FRU_MR_NVME_TOPOLOGY] = decode_mr_nvme_topology,
+#endif
 		// TODO: Implement other decoders, add them all here
+#if FRU_WITH_MR_OEM
+		[FRU_MR_OEM_START ... FRU_MR_OEM_END] = decode_mr_oem,
+#endif
 	};
 
 	if (type_id >= FRU_ARRAY_SZ(decode_rec)) {
@@ -573,10 +915,9 @@ bool decode_mr_record(fru_mr_rec_t * rec,
 	}
 
 	if (decode_rec[type_id]) {
+		/* Some decoders may fall back to `raw` and override the type */
+		rec->type = type_id;
 		rc = decode_rec[type_id](rec, srec, flags);
-		if (rc) {
-			rec->type = type_id;
-		}
 	}
 	else {
 		// Decode all unsupported types as `raw`
@@ -598,6 +939,7 @@ bool decode_mr_area(fru_t * fru,
 	fru_mr_rec_t *rec;
 	fru__mr_reclist_t ** reclist = NULL;
 	size_t total = 0;
+	size_t issues;
 	int count = -1;
 	bool rc = false;
 
@@ -612,10 +954,16 @@ bool decode_mr_area(fru_t * fru,
 
 	while (srec) {
 		size_t rec_sz = FRU__MR_REC_SZ(srec);
+		int index = count < 0 ? 0 : count;
+
+		issues = diaglog ? diaglog->count : 0;
 		if (!is_mr_rec_valid(srec, limit - total, flags)) {
 			fru_errno.index = count;
 			if (!(flags & FRU_IGNRNOEOL))
 				count = -1;
+			else if (count >= 0)
+				diag(srec); // The records before this one are kept
+			diag_set_index(issues, index);
 			break;
 		}
 
@@ -626,11 +974,17 @@ bool decode_mr_area(fru_t * fru,
 			break;
 		}
 
-		if (!decode_mr_record(rec, srec, flags)) {
+		if (!fru__decode_mr_record(rec, srec, flags)) {
 			fru_errno.index = count;
-			count = -1;
-			break;
+			if (!diaglog) {
+				count = -1;
+				break;
+			}
+			/* Keep going, the record data is still there */
+			diag(srec);
+			decode_mr_raw(rec, srec, flags);
 		}
+		diag_set_index(issues, index);
 
 		count = (count < 0) ? 1 : count + 1;
 		total += rec_sz;
@@ -648,7 +1002,7 @@ bool decode_mr_area(fru_t * fru,
 out:
 	if (count < 0) {
 		if (*reclist) {
-			fru__free_reclist(reclist);
+			fru__free_reclist(fru, reclist);
 			*reclist = NULL;
 		}
 	}
@@ -720,7 +1074,7 @@ fru_t * fru_loadbuffer(fru_t * init_fru,
 	}
 
 	if (!init_fru) {
-		fru = calloc(1, sizeof(fru_t));
+		fru = fru__calloc(1, sizeof(fru_t));
 		if (!fru) {
 			fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
 			goto out;
@@ -753,12 +1107,16 @@ fru_t * fru_loadbuffer(fru_t * init_fru,
 			continue;
 
 		size_t area_limit = get_area_limit(fru_file, size, atype);
-		if (!area_limit)
-			goto err;
-
 		const void * raw_area = buf + area_offset;
-		if (!decode_area[atype](fru, atype, raw_area, area_limit, flags))
-			goto err;
+		if (!area_limit
+		    || !decode_area[atype](fru, atype, raw_area, area_limit, flags))
+		{
+			if (!diaglog)
+				goto err;
+			/* Report the area as a whole and go on with the rest */
+			diag_at(area_offset);
+			continue;
+		}
 
 		/*
 		 * Don't use fru_enable_area() here to save on sorting that
@@ -778,16 +1136,49 @@ fru_t * fru_loadbuffer(fru_t * init_fru,
 
 	goto out;
 
-err:
+err: {
+	/* Free what has been decoded so far, the error must survive that */
+	fru_errno_t err = fru_errno;
+	fru_storage_t * storage = fru->storage;
+
+	fru_wipe(fru);
 	// Don't free the supplied init_fru in case
-	// it was staticaly allocated
+	// it was staticaly allocated, make it reusable instead
 	if (!init_fru)
-		zfree(fru);
+		fru__zfree(fru);
+	else if (storage)
+		fru_init_storage(init_fru, storage);
+	else
+		fru_init(init_fru);
+	fru_errno = err;
 	fru = NULL;
+	}
 out:
 	return fru;
 }
 
+// See fru.h
+fru_t * fru_loadbuffer_diag(fru_t * init_fru, const void * buf, size_t size,
+                            fru_diag_t * diags, size_t * count)
+{
+	diaglog_t log = {
+		.items = diags,
+		.capacity = diags && count ? *count : 0,
+		.image = buf,
+	};
+	fru_t * fru;
+
+	diaglog = &log;
+	fru = fru_loadbuffer(init_fru, buf, size, DIAG_FLAGS);
+	if (!fru)
+		diag_at(0); // Nothing decoded, that's the reason
+	diaglog = NULL;
+
+	if (count)
+		*count = log.count;
+	return fru;
+}
+
 // See fru.h
 fru_t * fru_loadfile(fru_t * init_fru,
                      const char *filename,
@@ -839,3 +1230,79 @@ err:
 out:
 	return fru;
 }
+
+// See fru.h
+bool fru_foreach_mr(const void * buf, size_t size, fru_mr_type_t type,
+                    fru_flags_t flags, fru_mr_visitor_t visit, void * arg)
+{
+	fru__file_t * fru_file;
+	const fru__file_mr_rec_t * srec;
+	size_t limit, total = 0, index = 0;
+
+	if (!buf || !visit) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return false;
+	}
+
+	// This is wider than FRU_MR_IS_VALID_TYPE()
+	if (!FRU_MR_IS_VALID_TYPE(type)
+	    && FRU_MR_RAW != type
+	    && FRU_MR_ANY != type)
+	{
+		fru__seterr(FEMRNOTSUP, FERR_LOC_CALLER, -1);
+		return false;
+	}
+
+	fru_file = find_fru_header(buf, size, flags);
+	if (!fru_file)
+		return false;
+
+	/* No MR area is not an error, there is just nothing to visit */
+	if (!fru_file->multirec)
+		return true;
+
+	limit = get_area_limit(fru_file, size, FRU_MR);
+	if (!limit)
+		return false;
+
+	srec = buf + FRU__BYTES(fru_file->multirec);
+	while (true) {
+		if (!is_mr_rec_valid(srec, limit - total, flags)) {
+			fru_errno.index = index;
+			return false;
+		}
+
+		/*
+		 * Only decode the records that are requested. For `raw` we
+		 * can't tell in advance, so we decode all of them.
+		 */
+		if (FRU_MR_ANY == type
+		    || FRU_MR_RAW == type
+		    || srec->hdr.type_id == type)
+		{
+			fru_mr_rec_t rec = {};
+
+			if (!fru__decode_mr_record(&rec, srec, flags)) {
+				fru_errno.index = index;
+				return false;
+			}
+
+			if ((FRU_MR_RAW != type || FRU_MR_RAW == rec.type)
+			    && !visit(&rec, index, arg))
+			{
+				break;
+			}
+		}
+
+		if (FRU__IS_MR_END(srec))
+			break;
+
+		total += FRU__MR_REC_SZ(srec);
+		srec = (void *)srec + FRU__MR_REC_SZ(srec);
+		index++;
+	}
+
+	fru_clearerr();
+	return true;
+}
@@ -0,0 +1,105 @@
+/** @file
+ *  @brief Implementation of MR area aggregate query functions
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+
+#include <errno.h>
+#include <stddef.h>
+
+//#define DEBUG
+#include "fru-private.h"
+#include "../fru_errno.h"
+
+#if FRU_WITH_MR_PSU
+static
+bool sum_psu_watts(const fru_mr_rec_t * rec,
+                   size_t index __attribute__((unused)),
+                   void * arg)
+{
+	uint64_t * watts = arg;
+
+	*watts += rec->psu.overall_cap;
+	return true;
+}
+
+// See fru.h
+uint64_t fru_mr_psu_total_watts(const void * const * bufs, const size_t * sizes,
+                                size_t count, fru_flags_t flags, size_t * failed)
+{
+	uint64_t total = 0;
+	size_t nfailed = 0;
+
+	if (count && (!bufs || !sizes)) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		nfailed = count;
+		goto out;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		/* Don't let a broken image spoil the total */
+		uint64_t watts = 0;
+
+		if (!fru_foreach_mr(bufs[i], sizes[i], FRU_MR_PSU_INFO, flags,
+		                    sum_psu_watts, &watts))
+		{
+			DEBUG("Image %zu failed to decode", i);
+			nfailed++;
+			continue;
+		}
+		total += watts;
+	}
+
+out:
+	if (failed)
+		*failed = nfailed;
+
+	return total;
+}
+#endif
+
+#if FRU_WITH_MR_NVME
+struct nvme_info_s {
+	fru_mr_nvme_info_t * info;
+	bool found;
+};
+
+static
+bool get_nvme_info(const fru_mr_rec_t * rec,
+                   size_t index __attribute__((unused)),
+                   void * arg)
+{
+	struct nvme_info_s * ni = arg;
+
+	*ni->info = rec->nvme.info;
+	ni->found = true;
+	return false; // Only the first record is needed
+}
+
+// See fru.h
+bool fru_mr_nvme_info(const void * buf, size_t size, fru_flags_t flags,
+                      fru_mr_nvme_info_t * info)
+{
+	struct nvme_info_s ni = { .info = info };
+
+	if (!info) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return false;
+	}
+
+	if (!fru_foreach_mr(buf, size, FRU_MR_NVME, flags, get_nvme_info, &ni))
+		return false;
+
+	if (!ni.found) {
+		fru__seterr(FENOREC, FERR_LOC_MR, -1);
+		return false;
+	}
+
+	return true;
+}
+#endif
@@ -0,0 +1,234 @@
+/** @file
+ *  @brief Implementation of the OEM MR record codec registry
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+//#define DEBUG
+#include "fru-private.h"
+#include "../fru_errno.h"
+
+typedef struct fru__oem_entry_s {
+	uint32_t mfg_id;
+	fru_mr_oem_codec_t codec;
+} oem_entry_t;
+
+/*
+ * The global codecs, one table per OEM record type, each
+ * is sorted by mfg_id so that lookups are a binary search
+ */
+static fru__oem_registry_t oem_registry;
+
+static
+int cmp_mfg_id(const void * key, const void * entry)
+{
+	uint32_t mfg_id = *(const uint32_t *)key;
+	const oem_entry_t * e = entry;
+
+	return (mfg_id > e->mfg_id) - (mfg_id < e->mfg_id);
+}
+
+/*
+ * Find the position of \a mfg_id in the sorted table,
+ * or the position where it must be inserted.
+ */
+static
+size_t find_pos(const fru__oem_registry_t * reg, size_t idx,
+                uint32_t mfg_id, bool * found)
+{
+	size_t lo = 0, hi = reg->type[idx].count;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		int c = cmp_mfg_id(&mfg_id, &reg->type[idx].entries[mid]);
+
+		if (!c) {
+			*found = true;
+			return mid;
+		}
+		if (c > 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	*found = false;
+	return lo;
+}
+
+static
+bool check_args(fru_mr_type_t type, uint32_t mfg_id)
+{
+	if (type < FRU_MR_OEM_START || type > FRU_MR_OEM_END) {
+		fru__seterr(FEMRNOTSUP, FERR_LOC_CALLER, -1);
+		return false;
+	}
+
+	if (mfg_id > FRU__OEM_MFGID_MAX) {
+		fru__seterr(FERANGE, FERR_LOC_CALLER, -1);
+		return false;
+	}
+
+	return true;
+}
+
+static
+const fru_mr_oem_codec_t * find_codec(const fru__oem_registry_t * reg,
+                                      size_t idx, uint32_t mfg_id)
+{
+	const oem_entry_t * e;
+
+	if (!reg->type[idx].count)
+		return NULL;
+
+	e = bsearch(&mfg_id, reg->type[idx].entries, reg->type[idx].count,
+	            sizeof(*e), cmp_mfg_id);
+
+	return e ? &e->codec : NULL;
+}
+
+static
+bool register_codec(fru__oem_registry_t * reg, fru_mr_type_t type,
+                    uint32_t mfg_id, const fru_mr_oem_codec_t * codec)
+{
+	size_t idx, pos;
+	bool found;
+
+	if (!codec || !codec->decode || !codec->encode) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return false;
+	}
+
+	if (!check_args(type, mfg_id))
+		return false;
+
+	idx = type - FRU_MR_OEM_START;
+	pos = find_pos(reg, idx, mfg_id, &found);
+	if (!found) {
+		oem_entry_t * entries = fru__realloc(reg->type[idx].entries,
+		                                     (reg->type[idx].count + 1)
+		                                     * sizeof(*entries));
+		if (!entries) {
+			fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+			return false;
+		}
+		memmove(&entries[pos + 1], &entries[pos],
+		        (reg->type[idx].count - pos) * sizeof(*entries));
+		reg->type[idx].entries = entries;
+		reg->type[idx].count++;
+	}
+
+	DEBUG("%s OEM codec for type 0x%02X, mfg 0x%06X at %zu",
+	      found ? "Replacing" : "Adding", type, mfg_id, pos);
+	reg->type[idx].entries[pos].mfg_id = mfg_id;
+	reg->type[idx].entries[pos].codec = *codec;
+
+	return true;
+}
+
+static
+bool unregister_codec(fru__oem_registry_t * reg, fru_mr_type_t type,
+                      uint32_t mfg_id)
+{
+	size_t idx, pos;
+	bool found;
+
+	if (!check_args(type, mfg_id))
+		return false;
+
+	idx = type - FRU_MR_OEM_START;
+	pos = find_pos(reg, idx, mfg_id, &found);
+	if (!found) {
+		fru__seterr(FENOREC, FERR_LOC_CALLER, -1);
+		return false;
+	}
+
+	memmove(&reg->type[idx].entries[pos], &reg->type[idx].entries[pos + 1],
+	        (reg->type[idx].count - pos - 1) * sizeof(oem_entry_t));
+	if (!--reg->type[idx].count)
+		fru__zfree(reg->type[idx].entries);
+
+	return true;
+}
+
+/** @cond PRIVATE */
+// See fru-private.h
+const fru_mr_oem_codec_t * fru__mr_oem_codec(uint8_t type, uint32_t mfg_id)
+{
+	size_t idx = type - FRU_MR_OEM_START;
+	const fru_mr_oem_codec_t * codec = NULL;
+
+	if (type < FRU_MR_OEM_START)
+		return NULL;
+
+	if (fru__ctx)
+		codec = find_codec(&fru__ctx->oem, idx, mfg_id);
+
+	return codec ? codec : find_codec(&oem_registry, idx, mfg_id);
+}
+
+// See fru-private.h
+void fru__oem_registry_clear(fru__oem_registry_t * reg)
+{
+	for (size_t idx = 0; idx < FRU_MR_OEM_COUNT; idx++) {
+		fru__zfree(reg->type[idx].entries);
+		reg->type[idx].count = 0;
+	}
+}
+/** @endcond */
+
+// See fru.h
+bool fru_register_mr_oem(fru_mr_type_t type, uint32_t mfg_id,
+                         const fru_mr_oem_codec_t * codec)
+{
+	return register_codec(&oem_registry, type, mfg_id, codec);
+}
+
+// See fru.h
+bool fru_unregister_mr_oem(fru_mr_type_t type, uint32_t mfg_id)
+{
+	return unregister_codec(&oem_registry, type, mfg_id);
+}
+
+// See fru.h
+bool fru_ctx_register_mr_oem(fru_ctx_t * ctx, fru_mr_type_t type,
+                             uint32_t mfg_id, const fru_mr_oem_codec_t * codec)
+{
+	fru_ctx_t * prev;
+	bool rc;
+
+	if (!ctx) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return false;
+	}
+
+	/* The tables are global memory, they don't keep the context busy */
+	prev = fru_ctx_use(NULL);
+	rc = register_codec(&ctx->oem, type, mfg_id, codec);
+	fru_ctx_use(prev);
+
+	return rc;
+}
+
+// See fru.h
+bool fru_ctx_unregister_mr_oem(fru_ctx_t * ctx, fru_mr_type_t type,
+                               uint32_t mfg_id)
+{
+	if (!ctx) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return false;
+	}
+
+	return unregister_codec(&ctx->oem, type, mfg_id);
+}
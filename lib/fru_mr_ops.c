@@ -49,6 +49,9 @@ fru_mr_rec_t * mr_operation(fru_t * fru,
 		return NULL;
 	}
 
+	if (MR_OP_REPLACE == op && !fru_unshare(fru, FRU_MR))
+		return NULL;
+
 	fru__mr_reclist_t * entry = fru->mr;
 	fru__mr_reclist_t * prev_entry = NULL;
 	size_t count = 0;
@@ -78,14 +81,13 @@ fru_mr_rec_t * mr_operation(fru_t * fru,
 					/* Empty rec means they want to delete the record */
 					fru__mr_reclist_t ** mr_head = (fru__mr_reclist_t **)&fru->mr;
 					fru__mr_reclist_t ** prevptr = mr_head;
-					zfree(entry->rec);
 
 					if (prev_entry)
 						prevptr = &prev_entry->next;
 
 					(*prevptr) = entry->next;
 
-					zfree(entry);
+					fru__free_entry(fru, entry);
 
 					/* If there are no more entries in MR list, this means the area
 					 * is emtpy, mark it as not present */
@@ -0,0 +1,403 @@
+/** @file
+ *  @brief Implementation of the in-place patching and repair of encoded FRU images
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+
+//#define DEBUG
+#include "fru-private.h"
+#include "../fru_errno.h"
+
+/*
+ * Find the info area of type \a atype in the FRU image \a buf
+ * of \a size bytes and check its integrity, so that a patched
+ * area doesn't get a valid checksum over damaged data.
+ * Stores the area size in \a areasize.
+ */
+static
+uint8_t * find_info_area(void * buf, size_t size, fru_area_type_t atype,
+                         size_t * areasize)
+{
+	fru__file_t * header = buf;
+	fru__file_area_t * area;
+	size_t offset;
+
+	if (!buf) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return NULL;
+	}
+
+	if (!FRU_IS_INFO_AREA(atype)) {
+		fru__seterr(FEAREANOTSUP, FERR_LOC_CALLER, atype);
+		return NULL;
+	}
+
+	if (size < sizeof(fru__file_t)) {
+		fru__seterr(FE2SMALL, FERR_LOC_GENERAL, -1);
+		return NULL;
+	}
+
+	if (header->ver != FRU__VER || header->rsvd || header->pad) {
+		fru__seterr(FEHDRVER, FERR_LOC_GENERAL, -1);
+		return NULL;
+	}
+
+	/* Don't include the checksum byte into calculation */
+	if (header->hchecksum != fru__calc_checksum(header, sizeof(*header) - 1)) {
+		fru__seterr(FEHDRCKSUM, FERR_LOC_GENERAL, -1);
+		return NULL;
+	}
+
+	offset = FRU__BYTES((&header->internal)[atype]);
+	if (!offset) {
+		fru__seterr(FEADISABLED, (fru_error_source_t)atype, -1);
+		return NULL;
+	}
+
+	area = buf + offset;
+	if (offset + FRU__INFO_AREA_HEADER_SZ > size
+	    || offset + FRU__BYTES(area->blocks) > size)
+	{
+		fru__seterr(FEHDRBADPTR, (fru_error_source_t)atype, -1);
+		return NULL;
+	}
+
+	*areasize = FRU__BYTES(area->blocks);
+	if (!*areasize) {
+		fru__seterr(FE2SMALL, (fru_error_source_t)atype, -1);
+		return NULL;
+	}
+
+	if (area->ver != FRU__VER) {
+		fru__seterr(FEHDRVER, (fru_error_source_t)atype, -1);
+		return NULL;
+	}
+
+	if (fru__calc_checksum(area, *areasize)) {
+		fru__seterr(FEDATACKSUM, (fru_error_source_t)atype, -1);
+		return NULL;
+	}
+
+	return (uint8_t *)area;
+}
+
+/*
+ * The fixed checksums as reported by fru_fix_checksums()
+ */
+typedef struct {
+	fru_checksum_fix_t * fixes;
+	size_t capacity;
+	size_t count;
+} fixlog_t;
+
+/*
+ * Replace the checksum byte at \a offset in \a image if it's not
+ * \a cksum already, and log the replacement
+ */
+static
+void fix_checksum(fixlog_t * log, uint8_t * image, size_t offset,
+                  uint8_t cksum, fru_checksum_kind_t kind,
+                  fru_area_type_t atype, size_t index)
+{
+	if (image[offset] == cksum)
+		return;
+
+	DEBUG("Fixing checksum %d of area %d (%zu) at %zu: 0x%02X -> 0x%02X",
+	      kind, atype, index, offset, image[offset], cksum);
+
+	if (log->count < log->capacity) {
+		log->fixes[log->count] = (fru_checksum_fix_t){
+			.kind = kind,
+			.atype = atype,
+			.index = index,
+			.offset = offset,
+			.was = image[offset],
+			.now = cksum,
+		};
+	}
+	log->count++;
+	image[offset] = cksum;
+}
+
+/*
+ * Check that the MR records starting at \a offset in \a image are all
+ * within the image and end with an end-of-list record
+ */
+static
+bool check_mr_layout(const uint8_t * image, size_t size, size_t offset)
+{
+	for (int index = 0; ; index++) {
+		const fru__file_mr_rec_t * rec = (const fru__file_mr_rec_t *)(image + offset);
+
+		if (offset + sizeof(rec->hdr) > size) {
+			fru__seterr(FENOTERM, FERR_LOC_MR, -1);
+			return false;
+		}
+
+		if (!FRU__IS_MR_VALID_VER(rec)) {
+			fru__seterr(FEHDRVER, FERR_LOC_MR, index);
+			return false;
+		}
+
+		if (offset + FRU__MR_REC_SZ(rec) > size) {
+			fru__seterr(FEGENERIC, FERR_LOC_MR, index);
+			errno = ENOBUFS;
+			return false;
+		}
+
+		if (FRU__IS_MR_END(rec))
+			return true;
+
+		offset += FRU__MR_REC_SZ(rec);
+	}
+}
+
+/*
+ * Check everything fru_fix_checksums() relies upon except the checksums,
+ * so that nothing is written into an image that isn't a FRU image at all
+ */
+static
+bool check_layout(const uint8_t * image, size_t size)
+{
+	const fru__file_t * header = (const fru__file_t *)image;
+	fru_area_type_t atype;
+
+	if (size < sizeof(fru__file_t)) {
+		fru__seterr(FE2SMALL, FERR_LOC_GENERAL, -1);
+		return false;
+	}
+
+	if (header->ver != FRU__VER || header->rsvd || header->pad) {
+		fru__seterr(FEHDRVER, FERR_LOC_GENERAL, -1);
+		return false;
+	}
+
+	FRU_FOREACH_AREA(atype) {
+		size_t offset = FRU__BYTES((&header->internal)[atype]);
+		const fru__file_area_t * area = (const fru__file_area_t *)(image + offset);
+		size_t areasize;
+
+		if (!offset)
+			continue;
+
+		if (offset >= size) {
+			fru__seterr(FEHDRBADPTR, (fru_error_source_t)atype, -1);
+			return false;
+		}
+
+		if (FRU_MR == atype) {
+			if (!check_mr_layout(image, size, offset))
+				return false;
+			continue;
+		}
+
+		/* The internal use area has a version, but no length */
+		if (area->ver != FRU__VER) {
+			fru__seterr(FEHDRVER, (fru_error_source_t)atype, -1);
+			return false;
+		}
+
+		if (FRU_INTERNAL_USE == atype)
+			continue;
+
+		if (offset + FRU__INFO_AREA_HEADER_SZ > size
+		    || !(areasize = FRU__BYTES(area->blocks))
+		    || offset + areasize > size)
+		{
+			fru__seterr(FEHDRBADPTR, (fru_error_source_t)atype, -1);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Fix the checksums of all the MR records starting at \a offset in \a image,
+ * the layout must be checked by check_mr_layout() beforehand
+ */
+static
+void fix_mr_checksums(fixlog_t * log, uint8_t * image, size_t offset)
+{
+	for (size_t index = 0; ; index++) {
+		fru__file_mr_rec_t * rec = (fru__file_mr_rec_t *)(image + offset);
+
+		/* The data checksum is in the header, so it goes first */
+		fix_checksum(log, image,
+		             offset + offsetof(fru__file_mr_header_t, rec_checksum),
+		             fru__calc_checksum(rec->data, rec->hdr.len),
+		             FRU_CHECKSUM_MR_DATA, FRU_MR, index);
+		fix_checksum(log, image,
+		             offset + offsetof(fru__file_mr_header_t, hdr_checksum),
+		             fru__calc_checksum(&rec->hdr, FRU__FILE_MR_HDR_CHECKED_SIZE),
+		             FRU_CHECKSUM_MR_HEADER, FRU_MR, index);
+
+		if (FRU__IS_MR_END(rec))
+			return;
+
+		offset += FRU__MR_REC_SZ(rec);
+	}
+}
+
+/*
+ * The last byte of an info area is its checksum
+ */
+static
+void update_checksum(uint8_t * area, size_t areasize)
+{
+	area[areasize - 1] = fru__calc_checksum(area, areasize - 1);
+}
+
+// See fru.h
+bool fru_patch_field(void * buf, size_t size,
+                     fru_area_type_t atype, size_t index,
+                     fru_field_enc_t enc, const char * value)
+{
+	uint8_t fieldbuf[FRU__FILE_FIELD_MAXSIZE];
+	fru__file_field_t * field = (fru__file_field_t *)fieldbuf;
+	size_t areasize, end, pos, fieldpos = 0, count = 0;
+	size_t oldsize, newsize, room;
+	uint8_t * area;
+
+	area = find_info_area(buf, size, atype, &areasize);
+	if (!area)
+		return false;
+
+	/*
+	 * Walk the fields up to the terminator to find the one to patch
+	 * and the end of the data. Everything after the terminator, except
+	 * for the checksum in the last byte, is the padding we can use.
+	 */
+	end = areasize - 1;
+	pos = FRU__AREA_HAS_DATE(atype) ? FRU__DATE_AREA_HEADER_SZ
+	                                : FRU__INFO_AREA_HEADER_SZ;
+	while (pos < end && area[pos] != FRU__FIELD_TERMINATOR) {
+		if (count++ == index)
+			fieldpos = pos;
+		pos += FRU__FIELDSIZE(area[pos]);
+	}
+
+	if (pos >= end) {
+		fru__seterr(FENOTERM, (fru_error_source_t)atype, -1);
+		return false;
+	}
+
+	if (index >= count) {
+		fru__seterr(FENOFIELD, (fru_error_source_t)atype, index);
+		return false;
+	}
+
+	if (FRU_FE_PRESERVE == enc) {
+		// Can't preserve the encoding of an empty field, it's always text
+		enc = FRU__FIELDLEN(area[fieldpos])
+		      ? FRU__FIELD_ENC_T(area[fieldpos])
+		      : FRU_FE_AUTO;
+	}
+
+	if (!fru__encode_field(field, enc, value)) {
+		fru_errno.src = (fru_error_source_t)atype;
+		fru_errno.index = index;
+		return false;
+	}
+
+	oldsize = FRU__FIELDSIZE(area[fieldpos]);
+	newsize = FRU__FIELDSIZE(field->typelen);
+	room = end - (pos + 1);
+	if (newsize > oldsize && newsize - oldsize > room) {
+		fru__seterr(FEAREAGROW, (fru_error_source_t)atype, index);
+		return false;
+	}
+
+	DEBUG("Patching field %zu of area %d at %zu: %zu -> %zu bytes",
+	      index, atype, fieldpos, oldsize, newsize);
+
+	/* Shift the following fields and the terminator, then clear the rest */
+	memmove(area + fieldpos + newsize, area + fieldpos + oldsize,
+	        pos + 1 - (fieldpos + oldsize));
+	memcpy(area + fieldpos, field, newsize);
+	if (newsize < oldsize)
+		memset(area + pos + 1 - (oldsize - newsize), 0, oldsize - newsize);
+
+	update_checksum(area, areasize);
+	return true;
+}
+
+// See fru.h
+bool fru_patch_board_date(void * buf, size_t size, const struct timeval * tv)
+{
+	const struct timeval tv_auto = { 0 };
+	fru__file_board_t * board;
+	size_t areasize;
+
+	board = (fru__file_board_t *)find_info_area(buf, size, FRU_BOARD_INFO,
+	                                            &areasize);
+	if (!board)
+		return false;
+
+	if (!fru__encode_date(board->mfgdate, tv ? tv : &tv_auto, !tv))
+		return false;
+
+	update_checksum((uint8_t *)board, areasize);
+	return true;
+}
+
+// See fru.h
+bool fru_fix_checksums(void * buf, size_t size,
+                       fru_checksum_fix_t * fixes, size_t * count)
+{
+	fixlog_t log = { fixes, fixes && count ? *count : 0, 0 };
+	fru__file_t * header = buf;
+	uint8_t * image = buf;
+	fru_area_type_t atype;
+
+	if (count)
+		*count = 0;
+
+	if (!buf) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return false;
+	}
+
+	/* Don't stamp a checksum onto something that isn't a FRU image at all */
+	if (!check_layout(image, size))
+		return false;
+
+	/* Don't include the checksum byte into calculation */
+	fix_checksum(&log, image, offsetof(fru__file_t, hchecksum),
+	             fru__calc_checksum(header, sizeof(*header) - 1),
+	             FRU_CHECKSUM_HEADER, FRU_INTERNAL_USE, 0);
+
+	FRU_FOREACH_AREA(atype) {
+		size_t offset = FRU__BYTES((&header->internal)[atype]);
+		fru__file_area_t * area = (fru__file_area_t *)(image + offset);
+		size_t areasize = FRU__BYTES(area->blocks);
+
+		/* The internal use area has no checksum */
+		if (!offset || FRU_INTERNAL_USE == atype)
+			continue;
+
+		if (FRU_MR == atype) {
+			fix_mr_checksums(&log, image, offset);
+			continue;
+		}
+
+		fix_checksum(&log, image, offset + areasize - 1,
+		             fru__calc_checksum(area, areasize - 1),
+		             FRU_CHECKSUM_AREA, atype, 0);
+	}
+
+	if (count)
+		*count = log.count;
+	return true;
+}
@@ -28,6 +28,7 @@
  */
 /** @cond PRIVATE */
 
+#if FRU_WITH_MR_PSU || FRU_WITH_MR_MGMT || FRU_WITH_MR_NVME || FRU_WITH_MR_OEM
 /*
  * Save blob data into an MR record, update record header.
  *
@@ -70,7 +71,9 @@ bool mr_blob2rec(fru__file_mr_rec_t * rec,
 
 	return true;
 }
+#endif
 
+#if FRU_WITH_MR_MGMT
 /*
  * Save blob data into an MR Management Access record, update record header
  */
@@ -172,6 +175,230 @@ bool encode_mr_mgmt_record(void * outbuf, size_t * size, fru_mr_rec_t * rec)
 	return mgmt_blob2rec(outbuf, size, rec->mgmt.data,
 	                     strlen(rec->mgmt.data), subtype);
 }
+#endif
+
+#if FRU_WITH_MR_PSU
+static
+bool encode_mr_psu_record(void * outbuf, size_t * size, fru_mr_rec_t * rec)
+{
+	fru__file_mr_psu_t psu = {};
+
+	assert(rec);
+
+	if (rec->psu.overall_cap > FRU_MR_PSU_CAP_MAX
+	    || rec->psu.peak_watts > FRU_MR_PSU_CAP_MAX
+	    || rec->psu.holdup_s > FRU_MR_PSU_HOLDUP_MAX
+	    || rec->psu.combined_v1 > FRU_MR_PSU_VMAX
+	    || rec->psu.combined_v2 > FRU_MR_PSU_VMAX
+	    || rec->psu.flags & ~FRU_MR_PSU_FLAGS_MASK)
+	{
+		fru__seterr(FERANGE, FERR_LOC_MR, -1);
+		return false;
+	}
+
+	psu.overall_cap = htole16(rec->psu.overall_cap);
+	psu.peak_va = htole16(rec->psu.peak_va);
+	psu.inrush_amp = rec->psu.inrush_amp;
+	psu.inrush_ms = rec->psu.inrush_ms;
+	psu.lo_vin1 = (int16_t)htole16(rec->psu.lo_vin1);
+	psu.hi_vin1 = (int16_t)htole16(rec->psu.hi_vin1);
+	psu.lo_vin2 = (int16_t)htole16(rec->psu.lo_vin2);
+	psu.hi_vin2 = (int16_t)htole16(rec->psu.hi_vin2);
+	psu.lo_freq = rec->psu.lo_freq;
+	psu.hi_freq = rec->psu.hi_freq;
+	psu.dropout_tolerance_ms = rec->psu.dropout_ms;
+	psu.flags = rec->psu.flags;
+	psu.peak_watts_holdup = htole16(rec->psu.peak_watts
+	                                | rec->psu.holdup_s << FRU__MR_PSU_HOLDUP_SHIFT);
+	psu.combined_watts.per_range = rec->psu.combined_v1 << FRU__MR_PSU_WATTS_RANGE1_SHIFT
+	                               | rec->psu.combined_v2 << FRU__MR_PSU_WATTS_RANGE2_SHIFT;
+	psu.combined_watts.total = htole16(rec->psu.combined_watts);
+	psu.prefail_tach_rps = rec->psu.prefail_tach_rps;
+
+	return mr_blob2rec(outbuf, size, &psu, sizeof(psu), FRU_MR_PSU_INFO);
+}
+
+/*
+ * Encode both DC Output and Extended DC Output records
+ */
+static
+bool encode_mr_dcout_record(void * outbuf, size_t * size, fru_mr_rec_t * rec)
+{
+	fru__file_mr_dcout_t dco = {};
+	const fru_mr_dcout_t * in = &rec->dco;
+	bool extended = (FRU_MR_EXT_DC_OUT == rec->type);
+
+	if (in->output > FRU_MR_DC_OUTPUT_MAX
+	    || (in->current_100ma && !extended))
+	{
+		fru__seterr(FERANGE, FERR_LOC_MR, -1);
+		return false;
+	}
+
+	dco.info = in->output
+	           | (in->standby ? FRU__MR_DCOUT_STANDBY : 0)
+	           | (in->current_100ma ? FRU__MR_DCOUT_100MA : 0);
+	dco.nominal = (int16_t)htole16(in->nominal);
+	dco.max_neg_dev = (int16_t)htole16(in->max_neg_dev);
+	dco.max_pos_dev = (int16_t)htole16(in->max_pos_dev);
+	dco.ripple = htole16(in->ripple);
+	dco.min_current = htole16(in->min_current);
+	dco.max_current = htole16(in->max_current);
+
+	return mr_blob2rec(outbuf, size, &dco, sizeof(dco), rec->type);
+}
+
+/*
+ * Encode both DC Load and Extended DC Load records
+ */
+static
+bool encode_mr_dcload_record(void * outbuf, size_t * size, fru_mr_rec_t * rec)
+{
+	fru__file_mr_dcload_t dcl = {};
+	const fru_mr_dcload_t * in = &rec->dcl;
+	bool extended = (FRU_MR_EXT_DC_LOAD == rec->type);
+
+	if (in->output > FRU_MR_DC_OUTPUT_MAX
+	    || (in->current_100ma && !extended))
+	{
+		fru__seterr(FERANGE, FERR_LOC_MR, -1);
+		return false;
+	}
+
+	dcl.info = in->output
+	           | (in->current_100ma ? FRU__MR_DCLOAD_100MA : 0);
+	dcl.nominal = (int16_t)htole16(in->nominal);
+	dcl.min_voltage = (int16_t)htole16(in->min_voltage);
+	dcl.max_voltage = (int16_t)htole16(in->max_voltage);
+	dcl.ripple = htole16(in->ripple);
+	dcl.min_current = htole16(in->min_current);
+	dcl.max_current = htole16(in->max_current);
+
+	return mr_blob2rec(outbuf, size, &dcl, sizeof(dcl), rec->type);
+}
+#endif
+
+#if FRU_WITH_MR_NVME
+static
+bool encode_mr_nvme_record(void * outbuf, size_t * size, fru_mr_rec_t * rec)
+{
+	fru__file_mr_nvme_t nvme = {};
+	const fru_mr_nvme_info_t * in = &rec->nvme.info;
+
+	if ((unsigned)in->formfactor > UINT8_MAX) {
+		fru__seterr(FERANGE, FERR_LOC_MR, -1);
+		return false;
+	}
+
+	nvme.version = in->version;
+	nvme.formfactor = in->formfactor;
+	nvme.p1v8_init = in->p1v8_init;
+	nvme.p1v8_max = in->p1v8_max;
+	nvme.p3v3_init = in->p3v3_init;
+	nvme.p3v3_max = in->p3v3_max;
+	nvme.p3v3_aux_max = in->p3v3_aux_max;
+	nvme.p5v_init = in->p5v_init;
+	nvme.p5v_max = in->p5v_max;
+	nvme.p12v_init = in->p12v_init;
+	nvme.p12v_max = in->p12v_max;
+	nvme.ptherm_max = in->ptherm_max;
+	nvme.capacity.lo = htole64(in->capacity_lo);
+	nvme.capacity.mid = htole32(in->capacity_mid);
+	nvme.capacity.hi = in->capacity_hi;
+
+	return mr_blob2rec(outbuf, size, &nvme, sizeof(nvme), FRU_MR_NVME);
+}
+
+static
+bool encode_mr_nvme_pcie_record(void * outbuf, size_t * size, fru_mr_rec_t * rec)
+{
+	fru__file_mr_nvme_pcie_t pcie = {};
+	const fru_mr_nvme_pcie_t * in = &rec->nvme.pcie;
+
+	pcie.version = in->version;
+	pcie.port = in->port;
+	pcie.info = in->info;
+	pcie.speeds = in->speeds;
+	pcie.max_width = in->max_width;
+	pcie.mctp = in->mctp;
+	pcie.refclk = in->refclk;
+	pcie.port_id = in->port_id;
+
+	return mr_blob2rec(outbuf, size, &pcie, sizeof(pcie), FRU_MR_NVME_PCIE_PORT);
+}
+
+static
+bool encode_mr_nvme_topology_record(void * outbuf, size_t * size, fru_mr_rec_t * rec)
+{
+	uint8_t topo[sizeof(fru__file_mr_nvme_topo_t) + FRU_MR_NVME_TOPO_MAXDATA];
+	fru__file_mr_nvme_topo_t * out = (void *)topo;
+	const fru_mr_nvme_topology_t * in = &rec->nvme.topology;
+	size_t len = FRU_MR_NVME_TOPO_MAXDATA;
+
+	if (!fru__hexstr2bin(out->data, &len, FRU__HEX_RELAXED, in->data))
+		return false;
+
+	out->version = in->version;
+	out->count = in->count;
+
+	return mr_blob2rec(outbuf, size, topo, sizeof(*out) + len,
+	                   FRU_MR_NVME_TOPOLOGY);
+}
+#endif
+
+#if FRU_WITH_MR_OEM
+/*
+ * Encode an OEM record either with a registered codec
+ * for native records, or as text/binary data
+ */
+static
+bool encode_mr_oem_record(void * outbuf, size_t * size, fru_mr_rec_t * rec)
+{
+	uint8_t oem[FRU__FILE_MRR_MAXDATA];
+	uint8_t * payload = oem + FRU__FILE_MRR_OEM_MFGID_LEN;
+	size_t len = sizeof(oem) - FRU__FILE_MRR_OEM_MFGID_LEN;
+
+	if (rec->oem.mfg_id > FRU__OEM_MFGID_MAX) {
+		fru__seterr(FERANGE, FERR_LOC_MR, -1);
+		return false;
+	}
+
+	oem[0] = rec->oem.mfg_id;
+	oem[1] = rec->oem.mfg_id >> 8;
+	oem[2] = rec->oem.mfg_id >> 16;
+
+	if (rec->oem.native) {
+		const fru_mr_oem_codec_t * codec;
+
+		codec = fru__mr_oem_codec(rec->type, rec->oem.mfg_id);
+		if (!codec) {
+			fru__seterr(FEMRNOTSUP, FERR_LOC_MR, -1);
+			return false;
+		}
+		if (!codec->encode(rec, payload, &len, codec->arg))
+			return false;
+	}
+	else if (FRU_FE_TEXT == rec->oem.enc) {
+		len = strlen(rec->oem.data);
+		if (len > sizeof(oem) - FRU__FILE_MRR_OEM_MFGID_LEN) {
+			fru__seterr(FE2BIG, FERR_LOC_MR, -1);
+			return false;
+		}
+		memcpy(payload, rec->oem.data, len);
+	}
+	else if (FRU_FE_BINARY == rec->oem.enc) {
+		if (!fru__hexstr2bin(payload, &len, FRU__HEX_RELAXED, rec->oem.data))
+			return false;
+	}
+	else {
+		fru__seterr(FEBADENC, FERR_LOC_MR, -1);
+		return false;
+	}
+
+	return mr_blob2rec(outbuf, size, oem, FRU__FILE_MRR_OEM_MFGID_LEN + len,
+	                   rec->type);
+}
+#endif
 
 static
 bool encode_mr_raw_record(void * outbuf, size_t * size, fru_mr_rec_t * rec)
@@ -187,11 +414,15 @@ bool encode_mr_raw_record(void * outbuf, size_t * size, fru_mr_rec_t * rec)
 		file_rec->hdr.type_id = rec->raw.type;
 	}
 	if (FRU_FE_TEXT == rec->raw.enc) {
-		size_t len = strlen(rec->raw.data);
-		memcpy(file_rec->data, rec->raw.data, len);
-		if (file_rec)
-			// Length can never be exceeded due to definition of fru_mr_rec_t
-			file_rec->hdr.len = (uint8_t)len;
+		bytes = strlen(rec->raw.data);
+		if (bytes > FRU__FILE_MRR_MAXDATA) {
+			fru__seterr(FE2BIG, FERR_LOC_MR, -1);
+			return false;
+		}
+		if (file_rec) {
+			memcpy(file_rec->data, rec->raw.data, bytes);
+			file_rec->hdr.len = (uint8_t)bytes;
+		}
 	}
 	else {
 		DEBUG("Calling hexstr2bin(%p, %p = %zu, ...)", outbuf ? file_rec->data : NULL, size, *size);
@@ -224,12 +455,29 @@ bool encode_mr_record(void * outbuf, size_t * size, fru_mr_rec_t * rec, bool las
 	                                       size_t *,
 	                                       fru_mr_rec_t *) =
 	{
+#if FRU_WITH_MR_PSU
+		[FRU_MR_PSU_INFO] = encode_mr_psu_record,
+		[FRU_MR_DC_OUT] = encode_mr_dcout_record,
+		[FRU_MR_DC_LOAD] = encode_mr_dcload_record,
+		[FRU_MR_EXT_DC_OUT] = encode_mr_dcout_record,
+		[FRU_MR_EXT_DC_LOAD] = encode_mr_dcload_record,
+#endif
+#if FRU_WITH_MR_MGMT
 		[FRU_MR_MGMT_ACCESS] = encode_mr_mgmt_record,
+#endif
+#if FRU_WITH_MR_NVME
+		[FRU_MR_NVME] = encode_mr_nvme_record,
+		[FRU_MR_NVME_PCIE_PORT] = encode_mr_nvme_pcie_record,
+		[FRU_MR_NVME_TOPOLOGY] = encode_mr_nvme_topology_record,
+#endif
 		// TODO: Implement encoders for other MR types, add them all here
+#if FRU_WITH_MR_OEM
+		[FRU_MR_OEM_START ... FRU_MR_OEM_END] = encode_mr_oem_record,
+#endif
 		[FRU_MR_RAW] = encode_mr_raw_record,
 	};
 
-	if (!encode_rec[rec->type]) {
+	if (rec->type >= FRU_MR_TYPE_COUNT || !encode_rec[rec->type]) {
 		DEBUG("MR Record type 0x%02X is not supported yet\n", rec->type);
 		fru__seterr(FEMRNOTSUP, FERR_LOC_MR, -1);
 		return false;
@@ -271,26 +519,16 @@ bool encode_iu_area(void * area_out, size_t * size,
                     const fru_t * fru)
 {
 	fru__file_internal_t * internal = area_out;
-	size_t bytesize = 0;
+	size_t bytesize = fru->internal.size;
 
-	if (internal) {
-		if (!fru__hexstr2bin(internal->data, &bytesize, FRU__HEX_RELAXED, fru->internal)) {
-			fru_errno.src = (fru_error_source_t)FERR_LOC_INTERNAL;
-			return false;
-		}
-		internal->ver = FRU__VER;
-	}
-	else {
-		/* Just calculate the size */
-		if(!fru__hexstr2bin(NULL, &bytesize, FRU__HEX_RELAXED, fru->internal)) {
-			fru_errno.src = (fru_error_source_t)FERR_LOC_INTERNAL;
-			return false;
-		}
-	}
 	*size = FRU__BLOCK_ALIGN(bytesize + sizeof(internal->ver));
 	if (internal) {
+		internal->ver = FRU__VER;
+		if (bytesize)
+			memcpy(internal->data, fru->internal.data, bytesize);
 		// Ensure the unused tail of the area is not some garbage
-		memset(internal->data + bytesize, 0, *size - bytesize);
+		memset(internal->data + bytesize, 0,
+		       *size - bytesize - sizeof(internal->ver));
 	}
 	return true;
 }
@@ -384,51 +622,11 @@ bool encode_info_area(void * area_out, size_t * size,
 	}
 
 	if (FRU__AREA_HAS_DATE(atype)) {
-		const struct timeval tv_unspecified = { 0 };
-		struct timeval tv_toset = fru->board.tv;
-		time_t fru_time_base = fru__datetime_base();
-		uint32_t fru_time;
-		union {
-			uint32_t val;
-			uint8_t arr[4];
-		} fru_time_le = { 0 }; // little-endian per FRU spec
-
-		if (fru->board.tv_auto) {
-			tzset();
-			gettimeofday(&tv_toset, NULL);
-			tv_toset.tv_sec += timezone;
-		} else if (tv_toset.tv_sec < fru_time_base) {
-			fru__seterr(FEBDATE, FERR_LOC_BOARD, -1);
-			return false;
-		}
-
-		/* Yes, there is an upper limit and it's soon */
-		if (tv_toset.tv_sec > FRU_DATETIME_MAX) {
-			fru__seterr(FEBDATE, FERR_LOC_BOARD, -1);
+		if (!fru__encode_date(board ? board->mfgdate : NULL,
+		                      &fru->board.tv, fru->board.tv_auto))
+		{
 			return false;
 		}
-
-		/*
-		 * UNIX time 0 (Jan 1st of 1970) can never actually happen in a system,
-		 * provided that this code is written in 2024.
-		 */
-		if (!memcmp(&tv_unspecified, &tv_toset, sizeof(struct timeval))) {
-			DEBUG("Using FRU__DATE_UNSPECIFIED\n");
-			fru_time = FRU__DATE_UNSPECIFIED;
-		}
-		else {
-			// FRU time is in minutes and we don't care about microseconds
-			fru_time = (tv_toset.tv_sec - fru__datetime_base()) / 60;
-		}
-		fru_time_le.val = htole32(fru_time);
-		// Save 32-bit LE integer into 24-bit LE integer, loose the MSB
-		// Source: 0 1 2 3 // MSB at offset 3
-		// Dest  : 0 1 2 X // MSB at offset 2
-		if (board) {
-			board->mfgdate[0] = fru_time_le.arr[0];
-			board->mfgdate[1] = fru_time_le.arr[1];
-			board->mfgdate[2] = fru_time_le.arr[2];
-		}
 		bytes = FRU__DATE_AREA_HEADER_SZ; // Expand the header size
 	}
 
@@ -456,6 +654,7 @@ bool encode_info_area(void * area_out, size_t * size,
 		}
 
 		cust = cust->next;
+		i++;
 	}
 
 // We don't yet increase bytes to account for the terminator
@@ -467,6 +666,12 @@ bool encode_info_area(void * area_out, size_t * size,
 	size_t padding_size;
 	padding_size = FRU__BLOCK_ALIGN(CKSUMMED_SIZE) - TERMINATED_SIZE;
 
+	/* The area size is a single byte in the area header */
+	if (FRU__BLOCKS(CKSUMMED_SIZE) > UINT8_MAX) {
+		fru__seterr(FE2BIG, atype, -1);
+		return false;
+	}
+
 	/* Add the custom field list terminator, then add padding and checksum */
 	if (area_out) {
 		fru__file_field_t * out_field = TERMINATOR_PTR;
@@ -572,6 +777,12 @@ static bool create_frufile(fru__file_t * frufile, size_t * size, const fru_t * f
 		if (!fru->present[type])
 			continue;
 
+		/* The area offset is a single byte in the header */
+		if (FRU__BLOCKS(totalsize) > UINT8_MAX) {
+			fru__seterr(FE2BIG, type, -1);
+			return false;
+		}
+
 		// Encode the area and get back its encoded size in bytes (block-aligned)
 		size_t area_size;
 		if (!encode_area[type](area_out, &area_size, type, fru))
@@ -588,6 +799,12 @@ static bool create_frufile(fru__file_t * frufile, size_t * size, const fru_t * f
 		totalsize += area_size;
 	}
 
+	/* Don't produce what fru_loadbuffer() would refuse to load */
+	if (totalsize > FRU__MAX_FILE_SIZE) {
+		fru__seterr(FE2BIG, FERR_LOC_GENERAL, -1);
+		return false;
+	}
+
 	if (frufile) {
 		frufile->ver = FRU__VER;
 		int cksum = fru__calc_checksum(frufile, sizeof(*frufile));
@@ -613,6 +830,31 @@ static bool create_frufile(fru__file_t * frufile, size_t * size, const fru_t * f
  * =========================================================================
  */
 
+// See fru.h
+bool fru_mr_encode(const fru_mr_rec_t * rec, void * buf, size_t * size)
+{
+	uint8_t out[sizeof(fru__file_mr_rec_t) + FRU__FILE_MRR_MAXDATA];
+	fru__file_mr_rec_t * file_rec = (fru__file_mr_rec_t *)out;
+	/* The encoders may normalize the record */
+	fru_mr_rec_t copy;
+	size_t bytes = 0;
+
+	if (!rec || !buf || !size) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return false;
+	}
+
+	copy = *rec;
+	if (!encode_mr_record(out, &bytes, &copy, true))
+		return false;
+
+	memcpy(buf, file_rec->data, file_rec->hdr.len);
+	*size = file_rec->hdr.len;
+
+	return true;
+}
+
 // See fru.h
 bool fru_savebuffer(void ** bufptr, size_t * size, const fru_t * fru)
 {
@@ -636,14 +878,21 @@ bool fru_savebuffer(void ** bufptr, size_t * size, const fru_t * fru)
 	}
 
 	if (!*bufptr) {
+#ifdef FRU_EMBEDDED
+		/* Only the caller's buffer may be used, see fru.h */
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EINVAL;
+		goto err;
+#else
 		DEBUG("Allocating %zu bytes for FRU file buffer", realsize);
-		*bufptr = calloc(1, realsize);
+		*bufptr = fru__calloc(1, realsize);
 		if (!*bufptr) {
 			fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
 			goto err;
 		}
 		DEBUG("Got a buffer from %p to %p", *bufptr, (void *)*bufptr + realsize - 1);
 		allocated = true;
+#endif
 	}
 	else {
 		if (*size < realsize) {
@@ -661,12 +910,110 @@ bool fru_savebuffer(void ** bufptr, size_t * size, const fru_t * fru)
 
 err:
 	if (allocated) {
-		zfree(*bufptr);
+		fru__zfree(*bufptr);
 		*size = 0;
 	}
 	return false;
 }
 
+// See fru.h
+bool fru_validate(const fru_t * fru)
+{
+	if (!fru) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return false;
+	}
+
+	/* The sizing pass of the encoder performs all the checks */
+	return create_frufile(NULL, NULL, fru);
+}
+
+#if FRU_WITH_LOAD
+/*
+ * Encode a field and decode it back in place
+ */
+static
+bool normalize_field(fru_field_t * field)
+{
+	uint8_t buf[FRU__FILE_FIELD_MAXSIZE];
+	fru__file_field_t * encoded = (fru__file_field_t *)buf;
+
+	return fru__encode_field(encoded, field->enc, field->val)
+	       && fru__decode_field(field, encoded);
+}
+
+/*
+ * Encode an MR record and decode it back in place
+ */
+static
+bool normalize_mr(fru_mr_rec_t * rec)
+{
+	uint8_t buf[sizeof(fru__file_mr_header_t) + UINT8_MAX] = {};
+	fru_mr_rec_t out = {};
+	size_t size;
+
+	if (!encode_mr_record(buf, &size, rec, true)
+	    || !fru__decode_mr_record(&out, (fru__file_mr_rec_t *)buf, FRU_NOFLAGS))
+	{
+		return false;
+	}
+
+	memcpy(rec, &out, sizeof(out));
+	return true;
+}
+
+static
+bool normalize_area(fru_t * fru, fru_area_type_t atype)
+{
+	size_t i = 0;
+	bool rc = true;
+
+	if (FRU_MR == atype) {
+		const fru__mr_reclist_t * entry = fru->mr;
+
+		for (; rc && entry; entry = entry->next, i++)
+			rc = normalize_mr(entry->rec);
+	}
+	else {
+		const fru__reclist_t * cust = *fru__get_customlist(fru, atype);
+
+		for (; rc && i < fru__fieldcount[atype]; i++)
+			rc = normalize_field(fru_getfield(fru, atype, i));
+		for (; rc && cust; cust = cust->next, i++)
+			rc = normalize_field(cust->rec);
+	}
+
+	if (!rc) {
+		fru_errno.src = (fru_error_source_t)atype;
+		fru_errno.index = i - 1;
+	}
+	return rc;
+}
+
+// See fru.h
+bool fru_normalize(fru_t * fru)
+{
+	fru_area_type_t atype;
+
+	if (!fru) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return false;
+	}
+
+	FRU_FOREACH_AREA(atype) {
+		if (FRU_INTERNAL_USE == atype || !fru->present[atype])
+			continue;
+
+		if (!fru_unshare(fru, atype) || !normalize_area(fru, atype))
+			return false;
+	}
+
+	return true;
+}
+#endif
+
 bool fru_savefile(const char * fname, const fru_t * fru)
 {
 	fru__file_t * frufile = NULL;
@@ -708,7 +1055,7 @@ bool fru_savefile(const char * fname, const fru_t * fru)
 		written += rc;
 	}
 
-	free(frufile);
+	fru__free(frufile);
 	close(fd);
 	return true;
 }
@@ -78,6 +78,7 @@ bool fru__hexstr2bin(void * out,
 	return true;
 }
 
+#if FRU_WITH_ENC_BINARY
 /** Validate and encode the input hex string into the output buffer as binary.
  *
  * If \a out is not NULL, puts the encoded data into that buffer along with
@@ -116,7 +117,9 @@ bool encode_binary(fru__file_field_t * out,
 
 	return true;
 }
+#endif
 
+#if FRU_WITH_ENC_6BIT
 /** Validate and encode the input string into the output buffer as 6-bit ASCII
  *
  * If \a out is not NULL, puts the encoded data into that buffer along with
@@ -185,7 +188,9 @@ bool encode_6bit(fru__file_field_t * out,
 
 	return true;
 }
+#endif
 
+#if FRU_WITH_ENC_BCDPLUS
 /** Validate and encode the input string into the output buffer as BCD+
  *
  * If \a out is not NULL, puts the encoded data into that buffer along with
@@ -252,6 +257,7 @@ bool encode_bcdplus(fru__file_field_t * out,
 
 	return true;
 }
+#endif
 
 /** Validate and encode the input string into the output buffer as plain text
  *
@@ -326,9 +332,15 @@ bool fru__encode_field(fru__file_field_t * out_field,
 	                                  fru__hex_mode_t,
 	                                  const char *) =
 	{
+#if FRU_WITH_ENC_BINARY
 		[FRU_REAL_FE(FRU_FE_BINARY)] = encode_binary,
+#endif
+#if FRU_WITH_ENC_BCDPLUS
 		[FRU_REAL_FE(FRU_FE_BCDPLUS)] = encode_bcdplus,
+#endif
+#if FRU_WITH_ENC_6BIT
 		[FRU_REAL_FE(FRU_FE_6BITASCII)] = encode_6bit,
+#endif
 		[FRU_REAL_FE(FRU_FE_TEXT)] = encode_text,
 	};
 
@@ -342,7 +354,9 @@ bool fru__encode_field(fru__file_field_t * out_field,
 		s = "";
 		encoding = FRU_FE_TEXT;
 	}
-	else if (FRU_FE_AUTO != encoding && !FRU_FE_IS_REAL(encoding)) {
+	else if (FRU_FE_AUTO != encoding
+	         && (!FRU_FE_IS_REAL(encoding) || !encode[FRU_REAL_FE(encoding)]))
+	{
 		fru__seterr(FEBADENC, FERR_LOC_GENERAL, 0);
 		goto out;
 	}
@@ -368,6 +382,9 @@ bool fru__encode_field(fru__file_field_t * out_field,
 		else {
 			size_t i = 0;
 			for (; i < FRU_FE_REALCOUNT; i++) {
+				// Skip the encodings compiled out of the library
+				if (!encode[FRU_REAL_FE(auto_encs[i])])
+					continue;
 				// For automatic selection of encdong we must use strict hex
 				// mode to prevent possible delimiters from affecting the detection
 				if (encode[FRU_REAL_FE(auto_encs[i])](local_outfield, FRU__HEX_STRICT, s))
@@ -0,0 +1,271 @@
+/** @file
+ *  @brief Implementation of string pools
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+//#define DEBUG
+#include "fru-private.h"
+#include "../fru_errno.h"
+
+/* An interned string, the users only get pointers to `str` */
+typedef struct {
+	uint32_t hash;
+	fru_strid_t id;
+	char str[];
+} pooled_t;
+
+#define POOLED(s) ((const pooled_t *)((s) - offsetof(pooled_t, str)))
+
+/// Size of the memory blocks the strings are allocated from
+#define BLOCK_SIZE (64 * 1024)
+
+/*
+ * The strings are stored in blocks that are never reallocated, so
+ * the pointers stay valid. Full blocks are linked into a list.
+ */
+typedef struct block_s {
+	struct block_s * next;
+	size_t used;
+	size_t size;
+	char data[];
+} block_t;
+
+struct fru_strpool_s {
+	block_t * blocks; ///< The current block first
+	const pooled_t ** strs; ///< By ID
+	size_t count;
+	size_t cap;
+	fru_strid_t * hash; ///< IDs + 1, 0 for empty slots
+	size_t hsize;
+};
+
+static
+uint32_t hash_str(const char * str)
+{
+	uint32_t h = 2166136261u; // FNV-1a
+
+	while (*str)
+		h = (h ^ (uint8_t)*str++) * 16777619u;
+	return h;
+}
+
+/*
+ * Find the hash table slot of \a str, either with its ID or empty
+ */
+static
+size_t find_slot(const fru_strpool_t * pool, const char * str, uint32_t hash)
+{
+	size_t i = hash & (pool->hsize - 1);
+
+	/* Only compare the strings with the same full hash */
+	while (pool->hash[i]) {
+		const pooled_t * p = pool->strs[pool->hash[i] - 1];
+
+		if (p->hash == hash && !strcmp(p->str, str))
+			break;
+		i = (i + 1) & (pool->hsize - 1);
+	}
+
+	return i;
+}
+
+static
+bool rehash(fru_strpool_t * pool)
+{
+	size_t hsize = pool->hsize ? pool->hsize * 2 : 256;
+	fru_strid_t * hash = fru__calloc(hsize, sizeof(*hash));
+
+	if (!hash) {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		return false;
+	}
+
+	for (size_t id = 0; id < pool->count; id++) {
+		size_t i = pool->strs[id]->hash & (hsize - 1);
+
+		while (hash[i])
+			i = (i + 1) & (hsize - 1);
+		hash[i] = id + 1;
+	}
+
+	fru__free(pool->hash);
+	pool->hash = hash;
+	pool->hsize = hsize;
+
+	return true;
+}
+
+/*
+ * Allocate \a size bytes for a new string
+ */
+static
+pooled_t * alloc_str(fru_strpool_t * pool, size_t size)
+{
+	block_t * b = pool->blocks;
+
+	size = (size + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+	if (!b || b->used + size > b->size) {
+		size_t bsize = size > BLOCK_SIZE ? size : BLOCK_SIZE;
+
+		b = fru__malloc(sizeof(*b) + bsize);
+		if (!b) {
+			fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+			return NULL;
+		}
+		b->used = 0;
+		b->size = bsize;
+		b->next = pool->blocks;
+		pool->blocks = b;
+	}
+
+	b->used += size;
+	return (pooled_t *)(b->data + b->used - size);
+}
+
+// See fru.h
+fru_strpool_t * fru_strpool_new(void)
+{
+	fru_strpool_t * pool = fru__calloc(1, sizeof(*pool));
+
+	if (!pool) {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		return NULL;
+	}
+
+	if (!fru_strpool_intern(pool, "")) {
+		fru_strpool_free(pool);
+		return NULL;
+	}
+
+	return pool;
+}
+
+// See fru.h
+void fru_strpool_free(fru_strpool_t * pool)
+{
+	if (!pool)
+		return;
+
+	while (pool->blocks) {
+		block_t * next = pool->blocks->next;
+
+		fru__free(pool->blocks);
+		pool->blocks = next;
+	}
+	fru__free(pool->strs);
+	fru__free(pool->hash);
+	fru__free(pool);
+}
+
+// See fru.h
+const char * fru_strpool_intern(fru_strpool_t * pool, const char * str)
+{
+	uint32_t hash;
+	size_t i, len;
+	pooled_t * p;
+
+	if (!pool || !str) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return NULL;
+	}
+
+	/* Keep the load factor under 1/2 */
+	if (2 * (pool->count + 1) > pool->hsize && !rehash(pool))
+		return NULL;
+
+	hash = hash_str(str);
+	i = find_slot(pool, str, hash);
+	if (pool->hash[i])
+		return pool->strs[pool->hash[i] - 1]->str;
+
+	if (pool->count >= FRU_STRID_NONE - 1) {
+		fru__seterr(FE2BIG, FERR_LOC_GENERAL, -1);
+		return NULL;
+	}
+
+	if (pool->count == pool->cap) {
+		size_t cap = pool->cap ? pool->cap * 2 : 256;
+		const pooled_t ** strs = fru__realloc(pool->strs, cap * sizeof(*strs));
+
+		if (!strs) {
+			fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+			return NULL;
+		}
+		pool->strs = strs;
+		pool->cap = cap;
+	}
+
+	len = strlen(str) + 1;
+	p = alloc_str(pool, sizeof(*p) + len);
+	if (!p)
+		return NULL;
+
+	p->hash = hash;
+	p->id = pool->count;
+	memcpy(p->str, str, len);
+
+	pool->strs[pool->count++] = p;
+	pool->hash[i] = pool->count;
+
+	return p->str;
+}
+
+// See fru.h
+const char * fru_strpool_find(const fru_strpool_t * pool, const char * str)
+{
+	size_t i;
+
+	if (!pool || !str) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return NULL;
+	}
+
+	i = find_slot(pool, str, hash_str(str));
+	return pool->hash[i] ? pool->strs[pool->hash[i] - 1]->str : NULL;
+}
+
+// See fru.h
+const char * fru_strpool_str(const fru_strpool_t * pool, fru_strid_t id)
+{
+	if (!pool) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return NULL;
+	}
+
+	if (id >= pool->count) {
+		fru__seterr(FENODATA, FERR_LOC_CALLER, -1);
+		return NULL;
+	}
+
+	return pool->strs[id]->str;
+}
+
+// See fru.h
+uint32_t fru_strpool_hash(const char * str)
+{
+	return POOLED(str)->hash;
+}
+
+// See fru.h
+fru_strid_t fru_strpool_id(const char * str)
+{
+	return POOLED(str)->id;
+}
+
+// See fru.h
+size_t fru_strpool_count(const fru_strpool_t * pool)
+{
+	return pool ? pool->count : 0;
+}
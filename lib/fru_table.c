@@ -0,0 +1,541 @@
+/** @file
+ *  @brief Implementation of inventory tables
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+//#define DEBUG
+#include "fru-private.h"
+#include "../fru_errno.h"
+
+struct fru_table_s {
+	size_t rows;
+	size_t cap; ///< Allocated rows in all the row columns
+
+	/* Row columns */
+	fru_strid_t * fields[FRU_TOTAL_AREAS][FRU_MAX_FIELD_COUNT];
+	uint8_t * areas;
+	time_t * dates;
+	uint8_t * chassis_types;
+
+	/* Custom fields side table */
+	size_t ncustom;
+	size_t custom_cap;
+	uint32_t * custom_rows;
+	uint8_t * custom_areas;
+	fru_strid_t * custom_values;
+
+	/* MR records side table */
+	size_t nmr;
+	size_t mr_cap;
+	uint32_t * mr_rows;
+	uint8_t * mr_types;
+	fru_mr_rec_t * mr_recs;
+
+	fru_strpool_t * pool;
+	bool own_pool; ///< The pool is freed along with the table
+};
+
+#define CHECK_TABLE(t, ret) do { \
+	if (!(t)) { \
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1); \
+		errno = EFAULT; \
+		return ret; \
+	} \
+} while(0)
+
+/*
+ * Grow an array of \a size byte elements to hold at least
+ * \a want elements, keep the capacity in \a cap
+ */
+static
+bool grow(void * arrayp, size_t size, size_t want, size_t cap)
+{
+	void ** array = arrayp;
+	void * p;
+
+	if (want <= cap)
+		return true;
+
+	p = fru__realloc(*array, want * size);
+	if (!p) {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		return false;
+	}
+	*array = p;
+	return true;
+}
+
+static inline
+size_t next_cap(size_t cap, size_t want)
+{
+	while (cap < want)
+		cap = cap ? cap * 2 : 64;
+	return cap;
+}
+
+/*
+ * Get the ID of a string, intern it if needed
+ */
+static
+fru_strid_t intern(fru_table_t * t, const char * str)
+{
+	const char * s = fru_strpool_intern(t->pool, str);
+
+	return s ? fru_strpool_id(s) : FRU_STRID_NONE;
+}
+
+// See fru.h
+fru_table_t * fru_table_new_shared(fru_strpool_t * pool)
+{
+	fru_table_t * t;
+
+	if (!pool) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return NULL;
+	}
+
+	t = fru__calloc(1, sizeof(*t));
+	if (!t) {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		return NULL;
+	}
+	t->pool = pool;
+
+	return t;
+}
+
+// See fru.h
+fru_table_t * fru_table_new(void)
+{
+	fru_strpool_t * pool = fru_strpool_new();
+	fru_table_t * t;
+
+	if (!pool)
+		return NULL;
+
+	t = fru_table_new_shared(pool);
+	if (!t) {
+		fru_strpool_free(pool);
+		return NULL;
+	}
+	t->own_pool = true;
+
+	return t;
+}
+
+// See fru.h
+fru_strpool_t * fru_table_strpool(const fru_table_t * t)
+{
+	CHECK_TABLE(t, NULL);
+	return t->pool;
+}
+
+// See fru.h
+void fru_table_free(fru_table_t * t)
+{
+	fru_area_type_t atype;
+
+	if (!t)
+		return;
+
+	FRU_FOREACH_AREA(atype) {
+		for (size_t i = 0; i < FRU_MAX_FIELD_COUNT; i++)
+			fru__free(t->fields[atype][i]);
+	}
+	fru__free(t->areas);
+	fru__free(t->dates);
+	fru__free(t->chassis_types);
+	fru__free(t->custom_rows);
+	fru__free(t->custom_areas);
+	fru__free(t->custom_values);
+	fru__free(t->mr_rows);
+	fru__free(t->mr_types);
+	fru__free(t->mr_recs);
+	if (t->own_pool)
+		fru_strpool_free(t->pool);
+	fru__free(t);
+}
+
+/*
+ * Make room for one more row in all the row columns
+ */
+static
+bool grow_rows(fru_table_t * t)
+{
+	size_t cap = next_cap(t->cap, t->rows + 1);
+	fru_area_type_t atype;
+
+	if (t->rows >= UINT32_MAX) {
+		fru__seterr(FE2BIG, FERR_LOC_GENERAL, -1);
+		return false;
+	}
+
+	FRU_FOREACH_AREA(atype) {
+		for (size_t i = 0; i < fru__fieldcount[atype]; i++) {
+			if (!grow(&t->fields[atype][i], sizeof(fru_strid_t), cap, t->cap))
+				return false;
+		}
+	}
+	if (!grow(&t->areas, sizeof(*t->areas), cap, t->cap)
+	    || !grow(&t->dates, sizeof(*t->dates), cap, t->cap)
+	    || !grow(&t->chassis_types, sizeof(*t->chassis_types), cap, t->cap))
+	{
+		return false;
+	}
+
+	t->cap = cap;
+	return true;
+}
+
+static
+bool add_custom(fru_table_t * t, fru_area_type_t atype, const char * val)
+{
+	size_t cap = next_cap(t->custom_cap, t->ncustom + 1);
+	fru_strid_t id;
+
+	if (!grow(&t->custom_rows, sizeof(*t->custom_rows), cap, t->custom_cap)
+	    || !grow(&t->custom_areas, sizeof(*t->custom_areas), cap, t->custom_cap)
+	    || !grow(&t->custom_values, sizeof(*t->custom_values), cap, t->custom_cap))
+	{
+		return false;
+	}
+	t->custom_cap = cap;
+
+	id = intern(t, val);
+	if (FRU_STRID_NONE == id)
+		return false;
+
+	t->custom_rows[t->ncustom] = t->rows;
+	t->custom_areas[t->ncustom] = atype;
+	t->custom_values[t->ncustom] = id;
+	t->ncustom++;
+
+	return true;
+}
+
+static
+bool add_mr(fru_table_t * t, const fru_mr_rec_t * rec)
+{
+	size_t cap = next_cap(t->mr_cap, t->nmr + 1);
+
+	if (!grow(&t->mr_rows, sizeof(*t->mr_rows), cap, t->mr_cap)
+	    || !grow(&t->mr_types, sizeof(*t->mr_types), cap, t->mr_cap)
+	    || !grow(&t->mr_recs, sizeof(*t->mr_recs), cap, t->mr_cap))
+	{
+		return false;
+	}
+	t->mr_cap = cap;
+
+	t->mr_rows[t->nmr] = t->rows;
+	t->mr_types[t->nmr] = (FRU_MR_RAW == rec->type) ? rec->raw.type : rec->type;
+	t->mr_recs[t->nmr] = *rec;
+	t->nmr++;
+
+	return true;
+}
+
+// See fru.h
+bool fru_table_add_fru(fru_table_t * t, const fru_t * fru)
+{
+	size_t ncustom, nmr;
+	fru_area_type_t atype;
+	uint8_t areas = 0;
+
+	CHECK_TABLE(t, false);
+	if (!fru) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return false;
+	}
+
+	if (!grow_rows(t))
+		return false;
+
+	/* Roll the side tables back on failures */
+	ncustom = t->ncustom;
+	nmr = t->nmr;
+
+	FRU_FOREACH_AREA(atype) {
+		const fru_field_t * field;
+
+		if (fru->present[atype])
+			areas |= 1 << atype;
+
+		if (!FRU_IS_INFO_AREA(atype))
+			continue;
+
+		for (size_t i = 0; i < fru__fieldcount[atype]; i++) {
+			fru_strid_t id = FRU_STRID_EMPTY;
+
+			if (fru->present[atype]) {
+				field = fru_getfield(fru, atype, i);
+				id = field ? intern(t, field->val) : FRU_STRID_NONE;
+				if (FRU_STRID_NONE == id)
+					goto err;
+			}
+			t->fields[atype][i][t->rows] = id;
+		}
+
+		if (!fru->present[atype])
+			continue;
+
+		for (size_t idx = FRU_LIST_HEAD; (field = fru_get_custom(fru, atype, idx)); idx++) {
+			if (!add_custom(t, atype, field->val))
+				goto err;
+		}
+	}
+
+	if (fru->present[FRU_MR]) {
+		const fru_mr_rec_t * rec;
+
+		for (size_t idx = FRU_LIST_HEAD; (rec = fru_get_mr(fru, idx)); idx++) {
+			if (!add_mr(t, rec))
+				goto err;
+		}
+	}
+
+	t->areas[t->rows] = areas;
+	t->dates[t->rows] = fru->board.tv.tv_sec;
+	t->chassis_types[t->rows] = fru->chassis.type;
+	t->rows++;
+
+	fru_clearerr();
+	return true;
+
+err:
+	t->ncustom = ncustom;
+	t->nmr = nmr;
+	return false;
+}
+
+#if FRU_WITH_LOAD
+// See fru.h
+bool fru_table_add(fru_table_t * t, const void * buf, size_t size,
+                   fru_flags_t flags)
+{
+	fru_t * fru;
+	bool ok;
+
+	CHECK_TABLE(t, false);
+
+	fru = fru_loadbuffer(NULL, buf, size, flags);
+	if (!fru)
+		return false;
+
+	ok = fru_table_add_fru(t, fru);
+	fru_free(fru);
+
+	return ok;
+}
+#endif
+
+// See fru.h
+size_t fru_table_rows(const fru_table_t * t)
+{
+	CHECK_TABLE(t, 0);
+	return t->rows;
+}
+
+/*
+ * Get a standard field column, set fru_errno on bad arguments
+ */
+static
+const fru_strid_t * get_column(const fru_table_t * t, fru_area_type_t atype, int field)
+{
+	CHECK_TABLE(t, NULL);
+
+	if (!FRU_IS_INFO_AREA(atype)) {
+		fru__seterr(FEAREANOTSUP, FERR_LOC_CALLER, atype);
+		return NULL;
+	}
+	if (field < 0 || (size_t)field >= fru__fieldcount[atype]) {
+		fru__seterr(FENOFIELD, FERR_LOC_CALLER, field);
+		return NULL;
+	}
+
+	return t->fields[atype][field];
+}
+
+// See fru.h
+const fru_strid_t * fru_table_column(const fru_table_t * t,
+                                     fru_area_type_t atype, int field)
+{
+	return get_column(t, atype, field);
+}
+
+// See fru.h
+const uint8_t * fru_table_areas(const fru_table_t * t)
+{
+	CHECK_TABLE(t, NULL);
+	return t->areas;
+}
+
+// See fru.h
+const time_t * fru_table_dates(const fru_table_t * t)
+{
+	CHECK_TABLE(t, NULL);
+	return t->dates;
+}
+
+// See fru.h
+const uint8_t * fru_table_chassis_types(const fru_table_t * t)
+{
+	CHECK_TABLE(t, NULL);
+	return t->chassis_types;
+}
+
+// See fru.h
+size_t fru_table_custom(const fru_table_t * t, const uint32_t ** rows,
+                        const uint8_t ** areas, const fru_strid_t ** values)
+{
+	CHECK_TABLE(t, 0);
+
+	if (rows)
+		*rows = t->custom_rows;
+	if (areas)
+		*areas = t->custom_areas;
+	if (values)
+		*values = t->custom_values;
+
+	return t->ncustom;
+}
+
+// See fru.h
+size_t fru_table_mr(const fru_table_t * t, const uint32_t ** rows,
+                    const uint8_t ** types, const fru_mr_rec_t ** recs)
+{
+	CHECK_TABLE(t, 0);
+
+	if (rows)
+		*rows = t->mr_rows;
+	if (types)
+		*types = t->mr_types;
+	if (recs)
+		*recs = t->mr_recs;
+
+	return t->nmr;
+}
+
+// See fru.h
+fru_strid_t fru_table_strid(const fru_table_t * t, const char * str)
+{
+	const char * s;
+
+	CHECK_TABLE(t, FRU_STRID_NONE);
+
+	s = fru_strpool_find(t->pool, str);
+	return s ? fru_strpool_id(s) : FRU_STRID_NONE;
+}
+
+// See fru.h
+const char * fru_table_str(const fru_table_t * t, fru_strid_t id)
+{
+	CHECK_TABLE(t, NULL);
+	return fru_strpool_str(t->pool, id);
+}
+
+// See fru.h
+size_t fru_table_strcount(const fru_table_t * t)
+{
+	CHECK_TABLE(t, 0);
+	return fru_strpool_count(t->pool);
+}
+
+// See fru.h
+size_t fru_table_select(const fru_table_t * t, fru_area_type_t atype,
+                        int field, fru_strid_t id,
+                        const uint32_t * in, size_t count, uint32_t * out)
+{
+	const fru_strid_t * col = get_column(t, atype, field);
+	size_t n = 0;
+
+	if (!col)
+		return 0;
+	if (!out) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return 0;
+	}
+
+	/* Store every row and only advance on matches, that has no branches */
+	if (!in) {
+		for (size_t row = 0; row < t->rows; row++) {
+			out[n] = row;
+			n += (col[row] == id);
+		}
+	}
+	else {
+		for (size_t i = 0; i < count; i++) {
+			out[n] = in[i];
+			n += (col[in[i]] == id);
+		}
+	}
+
+	return n;
+}
+
+// See fru.h
+size_t fru_table_select_dates(const fru_table_t * t, time_t from, time_t to,
+                              const uint32_t * in, size_t count, uint32_t * out)
+{
+	size_t n = 0;
+
+	CHECK_TABLE(t, 0);
+	if (!out) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return 0;
+	}
+
+	if (!in) {
+		for (size_t row = 0; row < t->rows; row++) {
+			out[n] = row;
+			n += (from <= t->dates[row] && t->dates[row] < to);
+		}
+	}
+	else {
+		for (size_t i = 0; i < count; i++) {
+			time_t date = t->dates[in[i]];
+
+			out[n] = in[i];
+			n += (from <= date && date < to);
+		}
+	}
+
+	return n;
+}
+
+// See fru.h
+bool fru_table_count(const fru_table_t * t, fru_area_type_t atype, int field,
+                     const uint32_t * rows, size_t count, size_t * counts)
+{
+	const fru_strid_t * col = get_column(t, atype, field);
+
+	if (!col)
+		return false;
+	if (!counts) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return false;
+	}
+
+	if (!rows) {
+		for (size_t row = 0; row < t->rows; row++)
+			counts[col[row]]++;
+	}
+	else {
+		for (size_t i = 0; i < count; i++)
+			counts[col[rows[i]]]++;
+	}
+
+	return true;
+}
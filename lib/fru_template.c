@@ -0,0 +1,439 @@
+/** @file
+ *  @brief Implementation of compiled FRU templates
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//#define DEBUG
+#include "fru-private.h"
+#include "../fru_errno.h"
+
+#define TEMPLATE_PAD(x) (((x) + FRU__TEMPLATE_ALIGN - 1) & ~(size_t)(FRU__TEMPLATE_ALIGN - 1))
+
+/*
+ * Get a mandatory field of an info area regardless of the area presence
+ */
+static
+fru_field_t * std_field(const fru_t * fru, fru_area_type_t atype, size_t index)
+{
+	const fru_field_t * fields[FRU_INFO_AREAS][FRU_MAX_FIELD_COUNT] = {
+		[FRU_INFOIDX(CHASSIS)] = {
+			&fru->chassis.pn,
+			&fru->chassis.serial,
+		},
+		[FRU_INFOIDX(BOARD)] = {
+			&fru->board.mfg,
+			&fru->board.pname,
+			&fru->board.serial,
+			&fru->board.pn,
+			&fru->board.file,
+		},
+		[FRU_INFOIDX(PRODUCT)] = {
+			&fru->product.mfg,
+			&fru->product.pname,
+			&fru->product.pn,
+			&fru->product.ver,
+			&fru->product.serial,
+			&fru->product.atag,
+			&fru->product.file,
+		}
+	};
+
+	return (fru_field_t *)fields[FRU_ATYPE_TO_INFOIDX(atype)][index];
+}
+
+/*
+ * Append a field to the template buffer, or just count
+ * its size if \a out is NULL. Returns the field size.
+ */
+static
+size_t put_field(uint8_t * out, const fru_field_t * field)
+{
+	fru__template_field_t tf = { .enc = field->enc };
+	size_t len = strnlen(field->val, sizeof(field->val) - 1);
+
+	if (out) {
+		tf.len = len;
+		memcpy(out, &tf, sizeof(tf));
+		memcpy(out + sizeof(tf), field->val, len);
+	}
+
+	return sizeof(tf) + len;
+}
+
+/*
+ * Serialize the structure into \a out, or only calculate
+ * the size when \a out is NULL. Returns the template size.
+ */
+static
+size_t build_template(uint8_t * out, const fru_t * fru)
+{
+	fru__template_hdr_t hdr = {
+		.magic = FRU__TEMPLATE_MAGIC,
+		.version = htole16(FRU__TEMPLATE_VERSION),
+		.byteorder = FRU__TEMPLATE_BYTEORDER,
+		.recsize = htole32(sizeof(fru_mr_rec_t)),
+		.chassis_type = fru->chassis.type,
+		.board_lang = fru->board.lang,
+		.product_lang = fru->product.lang,
+		.tv_auto = fru->board.tv_auto,
+		.tv_sec = htole64(fru->board.tv.tv_sec),
+		.tv_usec = htole32(fru->board.tv.tv_usec),
+		.internal = htole32(fru->internal.data ? fru->internal.size : 0),
+	};
+	size_t pos = sizeof(hdr);
+	fru_area_type_t atype;
+	uint16_t mrcount = 0;
+
+	FRU_FOREACH_AREA(atype) {
+		hdr.present[atype] = fru->present[atype];
+		hdr.order[atype] = fru->order[atype];
+	}
+
+	if (out && fru->internal.data)
+		memcpy(out + pos, fru->internal.data, fru->internal.size);
+	pos += le32toh(hdr.internal);
+
+	for (atype = FRU_CHASSIS_INFO; atype <= FRU_PRODUCT_INFO; atype++) {
+		const fru__reclist_t * entry = *fru__get_customlist(fru, atype);
+		uint16_t count = 0;
+
+		for (size_t i = 0; i < fru__fieldcount[atype]; i++)
+			pos += put_field(out ? out + pos : NULL, std_field(fru, atype, i));
+
+		for (; entry; entry = entry->next) {
+			if (!entry->rec)
+				continue;
+			pos += put_field(out ? out + pos : NULL, entry->rec);
+			count++;
+		}
+		hdr.custom[atype] = htole16(count);
+	}
+
+	for (const fru__mr_reclist_t * entry = fru->mr; entry; entry = entry->next) {
+		if (!entry->rec)
+			continue;
+		pos = TEMPLATE_PAD(pos);
+		if (out)
+			memcpy(out + pos, entry->rec, sizeof(fru_mr_rec_t));
+		pos += sizeof(fru_mr_rec_t);
+		mrcount++;
+	}
+
+	if (out) {
+		hdr.mrcount = htole16(mrcount);
+		hdr.size = htole32(pos);
+		hdr.crc = htole32(fru__crc32(0, out + sizeof(hdr), pos - sizeof(hdr)));
+		memcpy(out, &hdr, sizeof(hdr));
+	}
+
+	return pos;
+}
+
+// See fru.h
+bool fru_template_savebuffer(void ** out, size_t * size, const fru_t * fru)
+{
+	size_t len;
+	uint8_t * buf;
+
+	if (!out || !size || !fru) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return false;
+	}
+
+	len = build_template(NULL, fru);
+	if (len > UINT32_MAX) {
+		fru__seterr(FE2BIG, FERR_LOC_GENERAL, -1);
+		return false;
+	}
+
+	/* Zero the padding, templates must be reproducible */
+	buf = fru__calloc(1, len);
+	if (!buf) {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		return false;
+	}
+
+	build_template(buf, fru);
+	*out = buf;
+	*size = len;
+
+	return true;
+}
+
+// See fru.h
+bool fru_template_save(const char * filename, const fru_t * fru)
+{
+	void * buf;
+	size_t size;
+	bool rc;
+	int fd;
+
+	if (!filename || !fru) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return false;
+	}
+
+	if (!fru_template_savebuffer(&buf, &size, fru))
+		return false;
+
+	fd = open(filename, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+	if (fd < 0) {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		fru__free(buf);
+		return false;
+	}
+
+	rc = fru__write_all(fd, buf, size);
+	if (close(fd) && rc) {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		rc = false;
+	}
+	fru__free(buf);
+
+	DEBUG("Saved a %zu bytes template to %s", size, filename);
+	return rc;
+}
+
+// See fru.h
+bool fru_is_template(const void * buf, size_t size)
+{
+	const fru__template_hdr_t * hdr = buf;
+
+	return hdr && size >= sizeof(*hdr)
+	       && !memcmp(hdr->magic, FRU__TEMPLATE_MAGIC, sizeof(hdr->magic));
+}
+
+/*
+ * Read a field from the template at \a *pos, advance \a *pos
+ */
+static
+bool get_field(fru_field_t * field, const uint8_t * buf, size_t size, size_t * pos)
+{
+	fru__template_field_t tf;
+
+	if (*pos + sizeof(tf) > size)
+		return false;
+	memcpy(&tf, buf + *pos, sizeof(tf));
+	*pos += sizeof(tf);
+
+	if (*pos + tf.len > size || tf.len >= sizeof(field->val)
+	    || tf.enc >= FRU_FE_TOTALCOUNT)
+	{
+		return false;
+	}
+
+	field->enc = tf.enc;
+	memcpy(field->val, buf + *pos, tf.len);
+	field->val[tf.len] = 0;
+	*pos += tf.len;
+
+	return true;
+}
+
+/*
+ * Allocate a list entry with a copy of \a data and link
+ * it after \a *tail, \a tail is then updated
+ */
+static
+bool append_entry(void * head_ptr, fru__genlist_t ** tail,
+                  const void * data, size_t size)
+{
+	fru__genlist_t * entry = fru__calloc(1, sizeof(*entry));
+
+	if (!entry)
+		return false;
+
+	entry->data = fru__malloc(size);
+	if (!entry->data) {
+		fru__free(entry);
+		return false;
+	}
+	memcpy(entry->data, data, size);
+
+	if (*tail)
+		(*tail)->next = entry;
+	else
+		*(fru__genlist_t **)head_ptr = entry;
+	*tail = entry;
+
+	return true;
+}
+
+// See fru.h
+fru_t * fru_template_loadbuffer(fru_t * init_fru, const void * buf, size_t size)
+{
+	const uint8_t * data = buf;
+	fru__template_hdr_t hdr;
+	fru_area_type_t atype;
+	fru_t * fru;
+	size_t pos;
+
+	if (!buf) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return NULL;
+	}
+
+	if (!fru_is_template(buf, size))
+		goto bad;
+
+	memcpy(&hdr, buf, sizeof(hdr));
+	if (le16toh(hdr.version) != FRU__TEMPLATE_VERSION
+	    || hdr.byteorder != FRU__TEMPLATE_BYTEORDER
+	    || le32toh(hdr.recsize) != sizeof(fru_mr_rec_t)
+	    || le32toh(hdr.size) != size
+	    || le32toh(hdr.crc) != fru__crc32(0, data + sizeof(hdr), size - sizeof(hdr)))
+	{
+		DEBUG("Template version %u, record size %u, is incompatible or damaged",
+		      le16toh(hdr.version), le32toh(hdr.recsize));
+		goto bad;
+	}
+
+	fru = init_fru ? init_fru : fru__malloc(sizeof(fru_t));
+	if (!fru) {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		return NULL;
+	}
+	memset(fru, 0, sizeof(fru_t));
+
+	FRU_FOREACH_AREA(atype) {
+		if (hdr.order[atype] >= FRU_TOTAL_AREAS)
+			goto err;
+		fru->present[atype] = hdr.present[atype];
+		fru->order[atype] = hdr.order[atype];
+	}
+	fru->chassis.type = hdr.chassis_type;
+	fru->board.lang = hdr.board_lang;
+	fru->product.lang = hdr.product_lang;
+	fru->board.tv_auto = hdr.tv_auto;
+	fru->board.tv.tv_sec = (int64_t)le64toh(hdr.tv_sec);
+	fru->board.tv.tv_usec = (int32_t)le32toh(hdr.tv_usec);
+
+	pos = sizeof(hdr);
+	if (hdr.internal) {
+		size_t isize = le32toh(hdr.internal);
+
+		if (pos + isize > size || isize > FRU__MAX_FILE_SIZE)
+			goto err;
+		fru->internal.data = fru__malloc(isize);
+		if (!fru->internal.data)
+			goto nomem;
+		memcpy(fru->internal.data, data + pos, isize);
+		fru->internal.size = isize;
+		pos += isize;
+	}
+
+	for (atype = FRU_CHASSIS_INFO; atype <= FRU_PRODUCT_INFO; atype++) {
+		fru__genlist_t * tail = NULL;
+		fru_field_t field;
+
+		for (size_t i = 0; i < fru__fieldcount[atype]; i++) {
+			if (!get_field(std_field(fru, atype, i), data, size, &pos))
+				goto err;
+		}
+
+		for (size_t i = 0; i < le16toh(hdr.custom[atype]); i++) {
+			if (!get_field(&field, data, size, &pos))
+				goto err;
+			if (!append_entry(fru__get_customlist(fru, atype), &tail,
+			                  &field, sizeof(field)))
+			{
+				goto nomem;
+			}
+		}
+	}
+
+	fru__genlist_t * tail = NULL;
+	for (size_t i = 0; i < le16toh(hdr.mrcount); i++) {
+		pos = TEMPLATE_PAD(pos);
+		if (pos + sizeof(fru_mr_rec_t) > size)
+			goto err;
+		if (!append_entry(&fru->mr, &tail, data + pos, sizeof(fru_mr_rec_t)))
+			goto nomem;
+		pos += sizeof(fru_mr_rec_t);
+	}
+
+	if (pos != size)
+		goto err;
+
+	return fru;
+
+nomem:
+	fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+	goto cleanup;
+err:
+	fru__seterr(FEBADTMPL, FERR_LOC_GENERAL, -1);
+cleanup:
+	fru_wipe(fru);
+	// Don't free the supplied init_fru in case
+	// it was staticaly allocated
+	if (!init_fru)
+		fru__free(fru);
+	return NULL;
+
+bad:
+	fru__seterr(FEBADTMPL, FERR_LOC_GENERAL, -1);
+	return NULL;
+}
+
+// See fru.h
+fru_t * fru_template_load(fru_t * init_fru, const char * filename)
+{
+	fru_t * fru = NULL;
+	struct stat st;
+	void * map;
+	int fd, err;
+
+	if (!filename) {
+		fru__seterr(FEGENERIC, FERR_LOC_CALLER, -1);
+		errno = EFAULT;
+		return NULL;
+	}
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		return NULL;
+	}
+
+	if (fstat(fd, &st)) {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		goto out;
+	}
+	if ((size_t)st.st_size < sizeof(fru__template_hdr_t)
+	    || st.st_size > UINT32_MAX)
+	{
+		fru__seterr(FEBADTMPL, FERR_LOC_GENERAL, -1);
+		goto out;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (MAP_FAILED == map) {
+		fru__seterr(FEGENERIC, FERR_LOC_GENERAL, -1);
+		goto out;
+	}
+
+	fru = fru_template_loadbuffer(init_fru, map, st.st_size);
+	munmap(map, st.st_size);
+
+out:
+	err = errno;
+	close(fd);
+	errno = err;
+	return fru;
+}
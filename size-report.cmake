@@ -0,0 +1,94 @@
+# Report the code and data size of libfru per subsystem (feature)
+#
+# Usage: cmake -DNM=<nm> -DLIB=<libfru.a> -P size-report.cmake
+#
+# The symbols are attributed to the LIBFRU_* features by their names,
+# the rest go to the features or the core by the object they come from.
+# The objects that are neither are reported under their own names,
+# so that nothing new is silently counted as the core.
+
+CMAKE_POLICY(SET CMP0057 NEW) # IN_LIST
+
+IF(NOT NM OR NOT LIB)
+	MESSAGE(FATAL_ERROR "Usage: cmake -DNM=<nm> -DLIB=<libfru.a> -P size-report.cmake")
+ENDIF()
+
+EXECUTE_PROCESS(COMMAND ${NM} -A -S -t d --size-sort ${LIB}
+                OUTPUT_VARIABLE NM_OUTPUT
+                RESULT_VARIABLE NM_RESULT)
+IF(NOT NM_RESULT EQUAL 0)
+	MESSAGE(FATAL_ERROR "Failed to list the symbols of ${LIB}")
+ENDIF()
+
+SET(SUBSYSTEMS core ENC_BINARY ENC_BCDPLUS ENC_6BIT
+               MR_PSU MR_MGMT MR_NVME MR_OEM INTERNAL_HEX LOAD SAVE
+               ARCHIVE TEMPLATE TABLE COMPARE)
+# The objects of the basic fru_t handling that every build has
+SET(CORE_OBJECTS fru__decode fru_enable_area fru_errno fru_add_custom
+                 fru_add_mr fru_common fru_delete_custom fru_get_custom
+                 fru_init fru_internal fru_mr_ops fru_setfield
+                 fru_setfield_binary fru_getfield)
+FOREACH(S ${SUBSYSTEMS})
+	SET(SIZE_${S} 0)
+ENDFOREACH()
+SET(TOTAL 0)
+
+STRING(REGEX REPLACE ";" "\\\\;" NM_OUTPUT "${NM_OUTPUT}")
+STRING(REGEX REPLACE "\n" ";" NM_LINES "${NM_OUTPUT}")
+FOREACH(LINE ${NM_LINES})
+	# archive:object:value size type name
+	IF(NOT LINE MATCHES "([^:]+)\\.o[bj]*:[0-9]+ ([0-9]+) [bBdDrRtT] (.+)$")
+		CONTINUE()
+	ENDIF()
+	SET(OBJ ${CMAKE_MATCH_1})
+	SET(SIZE ${CMAKE_MATCH_2})
+	SET(SYM ${CMAKE_MATCH_3})
+
+	IF(SYM MATCHES "^(decode|encode)_binary$|^fru_setfield_binary$")
+		SET(S ENC_BINARY)
+	ELSEIF(SYM MATCHES "bcdplus")
+		SET(S ENC_BCDPLUS)
+	ELSEIF(SYM MATCHES "6bit")
+		SET(S ENC_6BIT)
+	ELSEIF(SYM MATCHES "psu|dcout|dcload")
+		SET(S MR_PSU)
+	ELSEIF(SYM MATCHES "mgmt|uuid")
+		SET(S MR_MGMT)
+	ELSEIF(SYM MATCHES "nvme")
+		SET(S MR_NVME)
+	ELSEIF(SYM MATCHES "oem" OR OBJ MATCHES "fru_mr_oem")
+		SET(S MR_OEM)
+	ELSEIF(SYM MATCHES "internal_hexstring")
+		SET(S INTERNAL_HEX)
+	ELSEIF(OBJ MATCHES "fru_load|fru_mr_aggregate")
+		SET(S LOAD)
+	ELSEIF(OBJ MATCHES "fru_save|fru_patch")
+		SET(S SAVE)
+	ELSEIF(OBJ MATCHES "fru_archive")
+		SET(S ARCHIVE)
+	ELSEIF(OBJ MATCHES "fru_template")
+		SET(S TEMPLATE)
+	ELSEIF(OBJ MATCHES "fru_table|fru_strpool")
+		SET(S TABLE)
+	ELSEIF(OBJ MATCHES "fru_compare")
+		SET(S COMPARE)
+	ELSE()
+		GET_FILENAME_COMPONENT(S ${OBJ} NAME_WE)
+		IF(S IN_LIST CORE_OBJECTS)
+			SET(S core)
+		ELSEIF(NOT S IN_LIST SUBSYSTEMS)
+			LIST(APPEND SUBSYSTEMS ${S})
+			SET(SIZE_${S} 0)
+		ENDIF()
+	ENDIF()
+
+	MATH(EXPR SIZE_${S} "${SIZE_${S}} + ${SIZE}")
+	MATH(EXPR TOTAL "${TOTAL} + ${SIZE}")
+ENDFOREACH()
+
+FOREACH(S ${SUBSYSTEMS})
+	IF(SIZE_${S} GREATER 0)
+		MESSAGE("${S}: ${SIZE_${S}}")
+	ENDIF()
+ENDFOREACH()
+MESSAGE("Total: ${TOTAL}")
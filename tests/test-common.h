@@ -0,0 +1,73 @@
+/** @file
+ *  @brief Helpers shared by the libfru tests
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fru.h"
+#include "fru_errno.h"
+
+/* Report a failed check with its location and exit */
+#define TEST_FAIL(fmt, args...) do { \
+	fprintf(stderr, "%s:%d: " fmt "\n", __FILE__, __LINE__, ##args); \
+	exit(1); \
+} while(0)
+
+/* Check a condition, report it and the current fru_errno if it's false */
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) \
+		TEST_FAIL("%s failed (%s)", #cond, fru_strerr(fru_errno)); \
+} while(0)
+
+/* The number of custom fields test_fill_fru() adds */
+#define TEST_CUSTOM_COUNT 3
+/* The number of MR records test_fill_fru() adds */
+#define TEST_MR_COUNT 2
+
+/*
+ * Fill an initialized \a fru with the data of a typical board:
+ * all the mandatory board and product fields, some custom fields
+ * and some management access records. The board date is fixed,
+ * so that the encoded image doesn't depend on the time of the save.
+ */
+static inline
+void test_fill_fru(fru_t * fru)
+{
+	fru_mr_rec_t rec = { .type = FRU_MR_MGMT_ACCESS };
+	char custom[] = "Custom field 0";
+
+	TEST_ASSERT(fru_setfield(&fru->board.mfg, FRU_FE_AUTO, "Acme Corp."));
+	TEST_ASSERT(fru_setfield(&fru->board.pname, FRU_FE_AUTO, "Test Board"));
+	TEST_ASSERT(fru_setfield(&fru->board.serial, FRU_FE_AUTO, "SN0123456789"));
+	TEST_ASSERT(fru_setfield(&fru->board.pn, FRU_FE_AUTO, "PN-42"));
+	fru->board.tv_auto = false;
+	fru->board.tv.tv_sec = FRU_DATE_BASE + 600 * 24 * 3600;
+	TEST_ASSERT(fru_enable_area(fru, FRU_BOARD_INFO, FRU_APOS_AUTO));
+
+	TEST_ASSERT(fru_setfield(&fru->product.mfg, FRU_FE_AUTO, "Acme Corp."));
+	TEST_ASSERT(fru_setfield(&fru->product.pname, FRU_FE_AUTO, "Test Product"));
+	TEST_ASSERT(fru_setfield(&fru->product.ver, FRU_FE_AUTO, "1.0"));
+	TEST_ASSERT(fru_enable_area(fru, FRU_PRODUCT_INFO, FRU_APOS_AUTO));
+
+	for (int i = 0; i < TEST_CUSTOM_COUNT; i++) {
+		custom[strlen(custom) - 1] = '0' + i;
+		TEST_ASSERT(fru_add_custom(fru, FRU_BOARD_INFO, FRU_LIST_TAIL,
+		                           FRU_FE_AUTO, custom));
+	}
+
+	rec.mgmt.subtype = FRU_MR_MGMT_SYS_NAME;
+	strcpy(rec.mgmt.data, "test-system");
+	TEST_ASSERT(fru_add_mr(fru, FRU_LIST_TAIL, &rec));
+	rec.mgmt.subtype = FRU_MR_MGMT_SYS_UUID;
+	strcpy(rec.mgmt.data, "0123456789ABCDEF0123456789ABCDEF");
+	TEST_ASSERT(fru_add_mr(fru, FRU_LIST_TAIL, &rec));
+}
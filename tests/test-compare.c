@@ -0,0 +1,142 @@
+/** @file
+ *  @brief Test of fru_compare() on multirecord area records
+ *
+ *  Checks that the records that encode the same are equal no matter
+ *  how they were built, that is, the padding and whatever is left
+ *  in the string buffers after the terminator don't count, and that
+ *  FRU_CMP_IGNENC applies to the record data.
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+
+#include "test-common.h"
+
+/* The index of the first record added by add_records() */
+#define FIRST_MR TEST_MR_COUNT
+
+/*
+ * Add a PSU, a management access and an OEM record to \a fru.
+ * The records are built in memory filled with \a junk, the strings
+ * are written over longer ones.
+ */
+static
+void add_records(fru_t * fru, int junk, const char * uuid,
+                 fru_field_enc_t oem_enc, const char * oem_data)
+{
+	fru_mr_rec_t rec;
+
+	memset(&rec, junk, sizeof(rec));
+	rec.type = FRU_MR_PSU_INFO;
+	rec.psu.overall_cap = 500;
+	rec.psu.peak_va = FRU_MR_PSU_PEAK_VA_UNSPEC;
+	rec.psu.inrush_amp = FRU_MR_PSU_INRUSH_AMP_UNSPEC;
+	rec.psu.inrush_ms = 5;
+	rec.psu.lo_vin1 = 10000;
+	rec.psu.hi_vin1 = 24000;
+	rec.psu.lo_vin2 = FRU_MR_PSU_VIN_SINGLE_RANGE;
+	rec.psu.hi_vin2 = FRU_MR_PSU_VIN_SINGLE_RANGE;
+	rec.psu.lo_freq = 47;
+	rec.psu.hi_freq = 63;
+	rec.psu.dropout_ms = 20;
+	rec.psu.flags = FRU_MR_PSU_FLAGS_HOTSWAP;
+	rec.psu.peak_watts = FRU_MR_PSU_PEAK_WATTS_UNSPEC;
+	rec.psu.holdup_s = 1;
+	rec.psu.combined_v1 = FRU_MR_PSU_V12;
+	rec.psu.combined_v2 = FRU_MR_PSU_V5;
+	rec.psu.combined_watts = 0;
+	rec.psu.prefail_tach_rps = FRU_MR_PSU_PREFAIL_BINARY;
+	TEST_ASSERT(fru_add_mr(fru, FRU_LIST_TAIL, &rec));
+
+	memset(&rec, junk, sizeof(rec));
+	rec.type = FRU_MR_MGMT_ACCESS;
+	rec.mgmt.subtype = FRU_MR_MGMT_SYS_UUID;
+	strcpy(rec.mgmt.data, "A much longer string that is overwritten");
+	strcpy(rec.mgmt.data, uuid);
+	TEST_ASSERT(fru_add_mr(fru, FRU_LIST_TAIL, &rec));
+
+	memset(&rec, junk, sizeof(rec));
+	rec.type = FRU_MR_OEM_START;
+	rec.oem.mfg_id = 0x001234;
+	rec.oem.native = false;
+	rec.oem.enc = oem_enc;
+	strcpy(rec.oem.data, "Some longer OEM data to overwrite");
+	strcpy(rec.oem.data, oem_data);
+	TEST_ASSERT(fru_add_mr(fru, FRU_LIST_TAIL, &rec));
+}
+
+static
+fru_t * new_fru(int junk, const char * uuid,
+                fru_field_enc_t oem_enc, const char * oem_data)
+{
+	fru_t * fru = fru_init(NULL);
+
+	TEST_ASSERT(fru);
+	test_fill_fru(fru);
+	add_records(fru, junk, uuid, oem_enc, oem_data);
+	return fru;
+}
+
+/* Check that \a a and \a b save into the same image */
+static
+void check_same_image(const fru_t * a, const fru_t * b)
+{
+	void * abuf = NULL, * bbuf = NULL;
+	size_t asize = 0, bsize = 0;
+
+	TEST_ASSERT(fru_savebuffer(&abuf, &asize, a));
+	TEST_ASSERT(fru_savebuffer(&bbuf, &bsize, b));
+	if (asize != bsize || memcmp(abuf, bbuf, asize))
+		TEST_FAIL("The structures don't save the same");
+	fru_mem_free(abuf);
+	fru_mem_free(bbuf);
+}
+
+int main(void)
+{
+	static const char uuid[] = "0123456789ABCDEF0123456789ABCDEF";
+	static const char uuid_lower[] = "0123456789abcdef0123456789abcdef";
+	fru_t * a, * b;
+	fru_mr_rec_t * rec;
+	fru_diff_t diff;
+
+	/* Built in clean and in dirty memory, with the same values */
+	a = new_fru(0, uuid, FRU_FE_TEXT, "OEM");
+	b = new_fru(0xA5, uuid, FRU_FE_TEXT, "OEM");
+	check_same_image(a, b);
+	if (!fru_equal(a, b, FRU_CMP_DEFAULT))
+		TEST_FAIL("Records built differently don't compare equal");
+	fru_free(b);
+
+	/* The hex case and the OEM data encoding only count by default */
+	b = new_fru(0xA5, uuid_lower, FRU_FE_BINARY, "4F454D");
+	check_same_image(a, b);
+	if (fru_equal(a, b, FRU_CMP_DEFAULT))
+		TEST_FAIL("Different encodings compare equal by default");
+	if (!fru_equal(a, b, FRU_CMP_IGNENC))
+		TEST_FAIL("Same data in different encodings don't compare equal");
+
+	/* A real difference is found and located */
+	rec = fru_get_mr(b, FIRST_MR);
+	TEST_ASSERT(rec);
+	rec->psu.peak_va = 600;
+	if (fru_compare(a, b, FRU_CMP_IGNENC, &diff) <= 0)
+		TEST_FAIL("A bigger PSU peak VA doesn't compare greater");
+	if (FRU_MR != diff.atype || FIRST_MR != diff.index)
+		TEST_FAIL("Wrong difference location: area %d, index %d",
+		          diff.atype, diff.index);
+
+	rec->psu.peak_va = FRU_MR_PSU_PEAK_VA_UNSPEC;
+	rec = fru_get_mr(b, FIRST_MR + 2);
+	TEST_ASSERT(rec);
+	strcpy(rec->oem.data, "4F454E");
+	if (fru_equal(a, b, FRU_CMP_IGNENC))
+		TEST_FAIL("Different OEM data compare equal");
+
+	fru_free(a);
+	fru_free(b);
+
+	return 0;
+}
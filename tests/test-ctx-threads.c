@@ -0,0 +1,185 @@
+/** @file
+ *  @brief Stress test of libfru contexts used by many threads at once
+ *
+ *  Checks the thread safety guarantees documented for fru_ctx_t:
+ *  - Threads with their own contexts and allocators may load and save
+ *    at the same time, every allocation goes to the allocator of the
+ *    context of the thread that made it.
+ *  - A fru structure may be saved by many threads at once.
+ *  - The last error of each context is that of its own thread.
+ *  - A context can be freed as soon as its memory is, even after
+ *    failed loads.
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "test-common.h"
+
+#define THREADS 8
+#define ITERATIONS 500
+/* The FRU image blocks are 8 bytes long */
+#define BYTES(blocks) ((size_t)(blocks) * 8)
+
+/* The per-thread allocator state, only ever touched by its own thread */
+typedef struct {
+	pthread_t thread;
+	pthread_t self; ///< Set by the thread itself before it allocates
+	size_t allocs;
+	size_t frees;
+	size_t live;
+	bool failed;
+} worker_t;
+
+/* The images shared by all the threads, read only */
+static const fru_t * shared_fru;
+static const void * good_image;
+static size_t good_size;
+static uint8_t bad_image[64 * 1024];
+
+/*
+ * The hooks are deliberately not thread-safe,
+ * so that any cross-thread use is caught by the counters
+ */
+static
+void * worker_malloc(size_t size, void * data)
+{
+	worker_t * w = data;
+
+	if (!pthread_equal(pthread_self(), w->self))
+		w->failed = true;
+	w->allocs++;
+	w->live++;
+	return malloc(size);
+}
+
+static
+void worker_free(void * ptr, void * data)
+{
+	worker_t * w = data;
+
+	if (!pthread_equal(pthread_self(), w->self))
+		w->failed = true;
+	w->frees++;
+	w->live--;
+	free(ptr);
+}
+
+/*
+ * Load, save and compare the images over and over in a context of
+ * its own with an allocator of its own
+ */
+static
+void * worker(void * arg)
+{
+	worker_t * w = arg;
+	const fru_allocator_t allocator = {
+		.malloc = worker_malloc,
+		.free = worker_free,
+		.data = w,
+	};
+	fru_ctx_t * ctx;
+
+	w->self = pthread_self();
+	ctx = fru_ctx_new();
+	TEST_ASSERT(ctx);
+	TEST_ASSERT(fru_ctx_set_allocator(ctx, &allocator));
+
+	for (int i = 0; i < ITERATIONS; i++) {
+		void * image = NULL;
+		size_t size = 0;
+		fru_t * fru;
+
+		fru = fru_loadbuffer_r(ctx, NULL, good_image, good_size, FRU_NOFLAGS);
+		if (!fru)
+			TEST_FAIL("Load failed: %s", fru_strerr(fru_ctx_errno(ctx)));
+
+		TEST_ASSERT(fru_savebuffer_r(ctx, &image, &size, fru));
+		if (size != good_size || memcmp(image, good_image, size))
+			TEST_FAIL("The loaded image doesn't save the same");
+		fru_mem_free(image);
+		fru_free(fru);
+
+		/* The structure shared by all the threads */
+		image = NULL;
+		TEST_ASSERT(fru_savebuffer_r(ctx, &image, &size, shared_fru));
+		if (size != good_size || memcmp(image, good_image, size))
+			TEST_FAIL("The shared structure doesn't save the same");
+		fru_mem_free(image);
+
+		/* A failure half way must not leave anything allocated */
+		fru = fru_loadbuffer_r(ctx, NULL, bad_image, good_size, FRU_NOFLAGS);
+		if (fru)
+			TEST_FAIL("A damaged image loaded");
+		if (FEDATACKSUM != fru_ctx_errno(ctx).code)
+			TEST_FAIL("Wrong error for a damaged image: %s",
+			          fru_strerr(fru_ctx_errno(ctx)));
+	}
+
+	if (!fru_ctx_free(ctx))
+		TEST_FAIL("The context is still in use: %s", fru_strerr(fru_errno));
+
+	return NULL;
+}
+
+int main(void)
+{
+	worker_t workers[THREADS] = {};
+	fru_mem_stats_t before, after;
+	void * image = NULL;
+	size_t offset;
+	size_t size = 0;
+	fru_t * fru;
+
+	fru = fru_init(NULL);
+	TEST_ASSERT(fru);
+	test_fill_fru(fru);
+	TEST_ASSERT(fru_savebuffer(&image, &size, fru));
+	shared_fru = fru;
+	good_image = image;
+	good_size = size;
+
+	/*
+	 * Break the board area checksum, the custom fields are decoded
+	 * before it is checked. The pointer to the board area is byte 3.
+	 */
+	TEST_ASSERT(size <= sizeof(bad_image));
+	memcpy(bad_image, image, size);
+	offset = BYTES(bad_image[3]);
+	bad_image[offset + BYTES(bad_image[offset + 1]) - 1] ^= 0xFF;
+
+	fru_mem_stats(&before);
+
+	for (int i = 0; i < THREADS; i++) {
+		errno = pthread_create(&workers[i].thread, NULL, worker, &workers[i]);
+		if (errno)
+			TEST_FAIL("Failed to start a thread: %m");
+	}
+	for (int i = 0; i < THREADS; i++)
+		pthread_join(workers[i].thread, NULL);
+
+	for (int i = 0; i < THREADS; i++) {
+		if (workers[i].failed)
+			TEST_FAIL("Thread %d allocator was used by another thread", i);
+		if (!workers[i].allocs || workers[i].live)
+			TEST_FAIL("Thread %d: %zu allocations, %zu still live",
+			          i, workers[i].allocs, workers[i].live);
+	}
+
+	fru_mem_stats(&after);
+	if (after.bytes != before.bytes || after.allocs != before.allocs)
+		TEST_FAIL("Leaked %zd bytes in %zd blocks",
+		          (ssize_t)(after.bytes - before.bytes),
+		          (ssize_t)(after.allocs - before.allocs));
+
+	fru_mem_free(image);
+	fru_free(fru);
+
+	return 0;
+}
@@ -0,0 +1,125 @@
+/** @file
+ *  @brief Test of the embedded libfru that must never use the heap
+ *
+ *  Built against a copy of libfru configured with ENABLE_EMBEDDED.
+ *  The installed allocator aborts, so any heap use left in the
+ *  decoding and encoding paths fails the test.
+ *
+ *  @copyright
+ *  Copyright (C) 2016-2024 Alexander Amelkin <alexander@amelkin.msk.ru>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later OR Apache-2.0
+ */
+
+#include <errno.h>
+
+#include "test-common.h"
+
+#ifndef FRU_EMBEDDED
+#error "This test needs the embedded build of libfru"
+#endif
+
+#define IMAGE_SIZE 512
+
+static
+void * abort_malloc(size_t size, void * data __attribute__((unused)))
+{
+	fprintf(stderr, "Attempted to allocate %zu bytes\n", size);
+	abort();
+}
+
+static
+void abort_free(void * ptr __attribute__((unused)),
+                void * data __attribute__((unused)))
+{
+	fprintf(stderr, "Attempted to free heap memory\n");
+	abort();
+}
+
+/*
+ * Save \a fru into \a image that holds IMAGE_SIZE bytes,
+ * fail the test if that doesn't work
+ */
+static
+size_t save(uint8_t * image, const fru_t * fru)
+{
+	void * buf = image;
+	size_t size = IMAGE_SIZE;
+
+	TEST_ASSERT(fru_savebuffer(&buf, &size, fru));
+	TEST_ASSERT(buf == image);
+	return size;
+}
+
+int main(void)
+{
+	const fru_allocator_t allocator = {
+		.malloc = abort_malloc,
+		.free = abort_free,
+	};
+	fru_custom_slot_t custom[TEST_CUSTOM_COUNT];
+	fru_mr_slot_t mr[TEST_MR_COUNT];
+	/* The decoded internal use data include the padding of the area */
+	uint8_t internal[16];
+	fru_storage_t storage = {
+		.custom = custom,
+		.custom_count = TEST_CUSTOM_COUNT,
+		.mr = mr,
+		.mr_count = TEST_MR_COUNT,
+		.internal = internal,
+		.internal_size = sizeof(internal),
+	};
+	fru_custom_slot_t small_custom[TEST_CUSTOM_COUNT - 1];
+	fru_storage_t small = {
+		.custom = small_custom,
+		.custom_count = TEST_CUSTOM_COUNT - 1,
+		.mr = mr,
+		.mr_count = TEST_MR_COUNT,
+	};
+	const uint8_t iu[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	uint8_t image[IMAGE_SIZE], copy[IMAGE_SIZE];
+	size_t size, copy_size;
+	void * buf = NULL;
+	fru_t fru, loaded;
+
+	TEST_ASSERT(fru_set_allocator(&allocator));
+
+	/* Fill the storage up, then one more must not fit */
+	TEST_ASSERT(fru_init_storage(&fru, &storage));
+	test_fill_fru(&fru);
+	TEST_ASSERT(fru_set_internal_binary(&fru, iu, sizeof(iu)));
+	TEST_ASSERT(!fru_add_custom(&fru, FRU_BOARD_INFO, FRU_LIST_TAIL,
+	                            FRU_FE_AUTO, "One too many"));
+	TEST_ASSERT(FENOSPACE == fru_errno.code);
+
+	/* Only the caller's buffer can be used for encoding */
+	TEST_ASSERT(!fru_savebuffer(&buf, &size, &fru));
+	size = save(image, &fru);
+	fru_wipe(&fru);
+
+	/* Decode into the storage, then encode the same image again */
+	TEST_ASSERT(fru_init_storage(&loaded, &storage));
+	TEST_ASSERT(fru_loadbuffer(&loaded, image, size, FRU_NOFLAGS));
+	copy_size = save(copy, &loaded);
+	if (copy_size != size || memcmp(copy, image, size))
+		TEST_FAIL("The loaded image doesn't save the same");
+	fru_wipe(&loaded);
+
+	/* Not enough storage for the custom fields */
+	TEST_ASSERT(fru_init_storage(&loaded, &small));
+	TEST_ASSERT(!fru_loadbuffer(&loaded, image, size, FRU_NOFLAGS));
+	TEST_ASSERT(FENOSPACE == fru_errno.code);
+
+	/* No storage for the internal use area */
+	TEST_ASSERT(!fru_set_internal_binary(&loaded, iu, sizeof(iu)));
+	TEST_ASSERT(FENOSPACE == fru_errno.code);
+
+	/* The failed load has freed the slots, the storage is still usable */
+	for (int i = 0; i < TEST_CUSTOM_COUNT - 1; i++) {
+		TEST_ASSERT(fru_add_custom(&loaded, FRU_BOARD_INFO, FRU_LIST_TAIL,
+		                           FRU_FE_AUTO, "Custom"));
+	}
+	fru_wipe(&loaded);
+
+	return 0;
+}